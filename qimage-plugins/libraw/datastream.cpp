@@ -20,10 +20,15 @@
 #include "datastream.h"
 
 #include <QIODevice>
-#include <QTextStream>
+
+#include <stdio.h>
+#include <string.h>
 
 Datastream::Datastream(QIODevice *device):
-    m_device(device)
+    m_device(device),
+    m_bufferStart(0),
+    m_pos(0),
+    m_size(device->size())
 {
 }
 
@@ -36,6 +41,30 @@ int Datastream::valid()
     return m_device->isReadable();
 }
 
+/**
+ * @return 当前读取位置是否在缓存数据中
+ */
+bool Datastream::inBuffer() const
+{
+    return m_pos >= m_bufferStart && m_pos < m_bufferStart + m_buffer.size();
+}
+
+/**
+ * @brief 从当前读取位置开始缓存一块设备数据
+ * @return 是否读取到数据
+ */
+bool Datastream::fillBuffer()
+{
+    m_buffer.clear();
+    m_bufferStart = m_pos;
+    if (m_pos >= m_size || !m_device->seek(m_pos)) {
+        return false;
+    }
+
+    m_buffer = m_device->read(BlockSize);
+    return !m_buffer.isEmpty();
+}
+
 /**
  * @brief 按块读取数据，参数和返回值方式与 fread(ptr,size,nmemb,file) 相似。
  * @param ptr   读取数据写入指针
@@ -45,7 +74,40 @@ int Datastream::valid()
  */
 int Datastream::read(void *ptr, size_t size, size_t nmemb)
 {
-    qint64 readDataLen = m_device->read(static_cast<char *>(ptr), qint64(size * nmemb));
+    char *dest = static_cast<char *>(ptr);
+    qint64 remain = qint64(size * nmemb);
+    qint64 readDataLen = 0;
+
+    while (remain > 0) {
+        if (inBuffer()) {
+            qint64 offset = m_pos - m_bufferStart;
+            qint64 len = qMin(remain, m_buffer.size() - offset);
+            memcpy(dest, m_buffer.constData() + offset, static_cast<size_t>(len));
+            dest += len;
+            remain -= len;
+            readDataLen += len;
+            m_pos += len;
+            continue;
+        }
+
+        if (remain >= BlockSize) {
+            // 大块数据直接读取，无需经过缓存
+            if (!m_device->seek(m_pos)) {
+                break;
+            }
+            qint64 len = m_device->read(dest, remain);
+            if (len <= 0) {
+                break;
+            }
+            dest += len;
+            remain -= len;
+            readDataLen += len;
+            m_pos += len;
+        } else if (!fillBuffer()) {
+            break;
+        }
+    }
+
     // 返回读取文本块数量而非读取数据总长度
     return static_cast<int>(readDataLen / qint64(size > 0 ? size : 1));
 }
@@ -60,10 +122,10 @@ int Datastream::seek(INT64 offset, int whence)
         pos = offset;
         break;
     case SEEK_CUR:
-        pos = m_device->pos() + offset;
+        pos = m_pos + offset;
         break;
     case SEEK_END:
-        pos = m_device->size();
+        pos = m_size + offset;
         break;
     default:
         return -1;
@@ -71,53 +133,92 @@ int Datastream::seek(INT64 offset, int whence)
 
     if (pos < 0) pos = 0;
 
-    if (m_device->bytesAvailable() < pos) return -1;
+    if (pos > m_size) return -1;
 
-    return m_device->seek(pos) ? 0 : -1;
+    // 仅记录读取位置，读取时再访问设备
+    m_pos = pos;
+    return 0;
 }
 
 INT64 Datastream::tell()
 {
-    return m_device->pos();
+    return m_pos;
 }
 
 INT64 Datastream::size()
 {
-    return m_device->size();
+    return m_size;
 }
 
 int Datastream::get_char()
 {
-    char c;
-    return m_device->getChar(&c) ? (unsigned char)c : -1;
+    if (!inBuffer() && !fillBuffer()) {
+        return -1;
+    }
+    return static_cast<unsigned char>(m_buffer.at(static_cast<int>(m_pos++ - m_bufferStart)));
 }
 
+/**
+ * @brief 读取一行数据，方式与 fgets(s,n,file) 相似
+ */
 char *Datastream::gets(char *s, int n)
 {
-    return m_device->readLine(s, n) >= 0 ? s : nullptr;
+    if (n <= 0) {
+        return nullptr;
+    }
+
+    int count = 0;
+    while (count < n - 1) {
+        int c = get_char();
+        if (c < 0) {
+            break;
+        }
+        s[count++] = static_cast<char>(c);
+        if ('\n' == c) {
+            break;
+        }
+    }
+    s[count] = '\0';
+    return count > 0 ? s : nullptr;
 }
 
+/**
+ * @brief 读取一个数值，处理方式与 LibRaw_buffer_datastream::scanf_one 一致
+ */
 int Datastream::scanf_one(const char *fmt, void *val)
 {
-    QTextStream stream(m_device);
     /* This is only used for %d or %f */
-    if (qstrcmp(fmt, "%d") == 0) {
-        int d;
-        stream >> d;
-        *(static_cast<int *>(val)) = d;
-    } else if (qstrcmp(fmt, "%f") == 0) {
-        float f;
-        stream >> f;
-        *(static_cast<float *>(val)) = f;
-    } else {
+    if (qstrcmp(fmt, "%d") != 0 && qstrcmp(fmt, "%f") != 0) {
         return 0;
     }
-    return (stream.status() == QTextStream::Ok) ? 1 : EOF;
+    if (m_pos >= m_size) {
+        return EOF;
+    }
+
+    // 数值字符串不会超过 24 个字符，读取后回退到数值结尾
+    char text[32];
+    const qint64 start = m_pos;
+    int len = read(text, 1, sizeof(text) - 1);
+    text[len] = '\0';
+
+    int ret = sscanf(text, fmt, val);
+    int skip = 0;
+    if (ret > 0) {
+        while (skip < len) {
+            skip++;
+            char c = text[skip];
+            if (0 == c || ' ' == c || '\t' == c || '\n' == c || skip > 24) {
+                break;
+            }
+        }
+    }
+    m_pos = start + skip;
+    return ret > 0 ? ret : EOF;
 }
 
 int Datastream::eof()
 {
-    return m_device->atEnd();
+    return m_pos >= m_size;
 }
 
 void *Datastream::make_jas_stream()
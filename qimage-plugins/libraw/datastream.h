@@ -26,6 +26,12 @@
 
 class QIODevice;
 
+/**
+ * @brief 基于 QIODevice 的 LibRaw 数据流
+ *      LibRaw 解码时会大量调用 get_char()/read() 读取少量数据，
+ *      按块缓存设备数据，避免每次调用都经过 QIODevice 的虚函数读取。
+ *      QFile 等可映射的文件应优先使用 LibRaw_buffer_datastream 直接读取映射内存。
+ */
 class Datastream: public LibRaw_abstract_datastream
 {
 public:
@@ -45,7 +51,17 @@ public:
     virtual void *make_jas_stream();
 
 private:
+    bool fillBuffer();
+    bool inBuffer() const;
+
+private:
+    enum { BlockSize = 64 * 1024 };     // 缓存块大小
+
     QIODevice *m_device;
+    QByteArray m_buffer;                // 缓存的设备数据
+    qint64 m_bufferStart;               // 缓存数据在设备中的起始位置
+    qint64 m_pos;                       // 当前读取位置
+    qint64 m_size;                      // 设备数据大小
 };
 
 #endif // DATASTREAM_H
@@ -11,10 +11,14 @@ PKGCONFIG += \
 
 HEADERS += \
     datastream.h \
+    rawcache.h \
+    rawscaler.h \
     rawiohandler.h
 SOURCES += \
     datastream.cpp \
     main.cpp \
+    rawcache.cpp \
+    rawscaler.cpp \
     rawiohandler.cpp
 OTHER_FILES += \
     raw.json
@@ -27,19 +27,7 @@ public:
 
 QStringList FreeimageQt5Plugin::keys() const
 {
-
-    const QStringList raws = QStringList()
-                             << QLatin1String("CR2") << QLatin1String("CRW")   // Canon cameras
-                             << QLatin1String("DCR") << QLatin1String("KDC")   // Kodak cameras
-                             << QLatin1String("MRW")            // Minolta cameras
-                             << QLatin1String("NEF")            // Nikon cameras
-                             << QLatin1String("ORF")            // Olympus cameras
-                             << QLatin1String("PEF")            // Pentax cameras
-                             << QLatin1String("RAF")            // Fuji cameras
-                             << QLatin1String("SRF")            // Sony cameras
-                             << QLatin1String("DNG")            //
-                             << QLatin1String("RAW");           // RAW formats.
-    return raws;
+    return RawIOHandler::formats();
 }
 
 QImageIOPlugin::Capabilities
@@ -49,7 +37,7 @@ FreeimageQt5Plugin::capabilities(QIODevice *device, const QByteArray &format) co
     if (keys().contains(format.toUpper()) ||
             format == "tif" ||
             format == "tiff") {
-        if (device->isReadable() && RawIOHandler::canRead(device))
+        if (device->isReadable() && RawIOHandler::canRead(device, format))
             cap |= CanRead;
     }
 
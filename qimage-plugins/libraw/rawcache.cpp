@@ -0,0 +1,232 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "rawcache.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileDevice>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QThreadPool>
+
+#include <atomic>
+#include <limits>
+
+#include <string.h>
+#include <sys/stat.h>
+#include <utime.h>
+
+// 缓存文件格式标识及版本，格式变更时需要更新
+static const quint32 s_cacheMagic = 0x44524331;    // "DRC1"
+static const char *const s_cacheSuffix = ".rawc";
+
+// 宿主程序设置的缓存目录及大小上限属性
+static const char *const s_dirProperty = "rawCacheDirectory";
+static const char *const s_sizeProperty = "rawCacheSizeMB";
+
+// 等待或正在写入的缓存数
+static std::atomic<int> s_pendingSaves(0);
+
+/**
+ * @return 宿主程序设置的缓存目录，未设置时返回空(禁用缓存)
+ */
+static QString cacheDir()
+{
+    QCoreApplication *app = QCoreApplication::instance();
+    return app ? app->property(s_dirProperty).toString() : QString();
+}
+
+/**
+ * @return 缓存大小上限(字节)，0 表示禁用缓存
+ */
+static qint64 maxCacheSize()
+{
+    QCoreApplication *app = QCoreApplication::instance();
+    if (!app || cacheDir().isEmpty()) {
+        return 0;
+    }
+
+    bool ok = false;
+    qint64 sizeMB = app->property(s_sizeProperty).toLongLong(&ok);
+    if (!ok || sizeMB < 0) {
+        sizeMB = RawCache::DefaultMaxSizeMB;
+    }
+    return sizeMB * 1024 * 1024;
+}
+
+/**
+ * @return 写入缓存使用的单线程线程池
+ */
+static QThreadPool *savePool()
+{
+    static QThreadPool *pool = []() {
+        static QThreadPool savePool;
+        savePool.setMaxThreadCount(1);
+        return &savePool;
+    }();
+    return pool;
+}
+
+static QString cacheFilePath(const QByteArray &key)
+{
+    return cacheDir() + "/" + QString::fromLatin1(key) + s_cacheSuffix;
+}
+
+bool RawCache::isEnabled()
+{
+    return maxCacheSize() > 0;
+}
+
+QByteArray RawCache::cacheKey(QIODevice *device, const libraw_output_params_t &params)
+{
+    if (!isEnabled()) {
+        return QByteArray();
+    }
+
+    QFileDevice *file = qobject_cast<QFileDevice *>(device);
+    if (!file || file->fileName().isEmpty()) {
+        return QByteArray();
+    }
+
+    struct stat st;
+    if (0 != stat(QFile::encodeName(file->fileName()).constData(), &st)) {
+        return QByteArray();
+    }
+
+    QByteArray identity;
+    QDataStream stream(&identity, QIODevice::WriteOnly);
+    // 文件标识
+    stream << quint64(st.st_dev) << quint64(st.st_ino) << qint64(st.st_size)
+           << qint64(st.st_mtim.tv_sec) << qint64(st.st_mtim.tv_nsec);
+    // 影响处理结果的参数
+    stream << s_cacheMagic << QByteArray(LIBRAW_VERSION_STR)
+           << params.half_size << params.output_bps << params.output_color << params.user_flip
+           << params.use_camera_wb << params.use_auto_wb << params.user_qual << params.no_auto_bright
+           << params.bright << params.gamm[0] << params.gamm[1] << params.highlight;
+
+    return QCryptographicHash::hash(identity, QCryptographicHash::Md5).toHex();
+}
+
+bool RawCache::load(const QByteArray &key, QImage *image)
+{
+    const QString path = cacheFilePath(key);
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    qint32 width = 0;
+    qint32 height = 0;
+    qint32 format = 0;
+    qint32 bytesPerLine = 0;
+    QByteArray data;
+    stream >> magic >> width >> height >> format >> bytesPerLine >> data;
+    file.close();
+    if (stream.status() != QDataStream::Ok || magic != s_cacheMagic) {
+        QFile::remove(path);
+        return false;
+    }
+
+    data = qUncompress(data);
+    QImage result(width, height, static_cast<QImage::Format>(format));
+    if (result.isNull() || result.bytesPerLine() != bytesPerLine
+            || data.size() != qint64(bytesPerLine) * height) {
+        QFile::remove(path);
+        return false;
+    }
+    memcpy(result.bits(), data.constData(), static_cast<size_t>(data.size()));
+
+    // 更新修改时间作为最近访问时间，用于淘汰缓存
+    utime(QFile::encodeName(path).constData(), nullptr);
+
+    *image = result;
+    return true;
+}
+
+/**
+ * @brief 压缩并写入缓存文件，在后台线程中执行
+ */
+static void writeCache(const QString &dir, qint64 maxSize, const QByteArray &key, const QImage &image)
+{
+    if (!QDir().mkpath(dir)) {
+        return;
+    }
+
+    QSaveFile file(dir + "/" + QString::fromLatin1(key) + s_cacheSuffix);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    // 使用最低压缩等级，在压缩速度和空间之间取舍
+    const QByteArray data = qCompress(image.constBits(), static_cast<int>(image.sizeInBytes()), 1);
+    QDataStream stream(&file);
+    stream << s_cacheMagic << qint32(image.width()) << qint32(image.height())
+           << qint32(image.format()) << qint32(image.bytesPerLine()) << data;
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        qWarning() << "RawCache: save cache failed," << file.fileName();
+        return;
+    }
+
+    // 按修改时间由新到旧排序，超出上限的缓存被移除
+    QDir cacheDir(dir);
+    const QFileInfoList infos = cacheDir.entryInfoList(QStringList() << QString("*") + s_cacheSuffix,
+                                                       QDir::Files, QDir::Time);
+    qint64 totalSize = 0;
+    for (const QFileInfo &info : infos) {
+        totalSize += info.size();
+        if (totalSize > maxSize) {
+            QFile::remove(info.absoluteFilePath());
+        }
+    }
+}
+
+class SaveTask : public QRunnable
+{
+public:
+    SaveTask(const QString &dir, qint64 maxSize, const QByteArray &key, const QImage &image)
+        : dir(dir), maxSize(maxSize), key(key), image(image)
+    {
+    }
+
+    void run() override
+    {
+        writeCache(dir, maxSize, key, image);
+        s_pendingSaves--;
+    }
+
+private:
+    QString dir;
+    qint64 maxSize;
+    QByteArray key;
+    QImage image;
+};
+
+void RawCache::save(const QByteArray &key, const QImage &image)
+{
+    // qCompress 仅支持 int 范围内的数据
+    if (key.isEmpty() || image.isNull() || image.sizeInBytes() > std::numeric_limits<int>::max()) {
+        return;
+    }
+
+    const QString dir = cacheDir();
+    const qint64 maxSize = maxCacheSize();
+    if (dir.isEmpty() || maxSize <= 0) {
+        return;
+    }
+
+    // 待写入的图片占用完整的解码内存，已有等待写入的图片时放弃本次缓存
+    int expected = 0;
+    if (!s_pendingSaves.compare_exchange_strong(expected, 1)) {
+        return;
+    }
+    // QImage 隐式共享，调用方修改图片时分离，不影响写入的数据
+    savePool()->start(new SaveTask(dir, maxSize, key, image));
+}
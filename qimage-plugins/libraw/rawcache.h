@@ -0,0 +1,47 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef RAW_CACHE_H
+#define RAW_CACHE_H
+
+#include <QByteArray>
+#include <QImage>
+
+#include <libraw.h>
+
+class QIODevice;
+
+/**
+ * @brief RAW 图片解码结果的磁盘缓存
+ *      RAW 图片去马赛克处理耗时较长，缓存 dcraw_process() 处理后的图片数据，
+ *      再次打开相同参数的图片时直接读取。缓存以 inode 、修改时间、文件大小及 LibRaw 处理参数
+ *      作为标识，文件变更或参数不同(如 half_size)时自动失效。
+ *      缓存默认禁用，由宿主程序在 QCoreApplication 上设置动态属性启用：
+ *      rawCacheDirectory 为缓存目录(未设置或为空时禁用)，rawCacheSizeMB 为大小上限(未设置时为 DefaultMaxSizeMB)。
+ *      属性需在读取图片前设置，缓存按最近访问时间淘汰。
+ *      写入缓存(压缩及写文件)在后台线程中进行，不延迟 read() 的返回，同一时间最多有一个等待写入的图片。
+ */
+class RawCache
+{
+public:
+    enum {
+        DefaultMaxSizeMB = 512,     // 未设置上限时使用 512MB
+    };
+
+    // 是否启用缓存
+    static bool isEnabled();
+
+    /**
+     * @brief 根据设备 \a device 对应的文件信息及处理参数 \a params 生成缓存标识
+     * @return 缓存标识，非本地文件或缓存未启用时返回空
+     */
+    static QByteArray cacheKey(QIODevice *device, const libraw_output_params_t &params);
+
+    // 读取缓存标识 \a key 对应的图片，读取成功时更新缓存的访问时间
+    static bool load(const QByteArray &key, QImage *image);
+    // 在后台保存图片 \a image 到缓存，超出大小上限时移除最久未访问的缓存
+    static void save(const QByteArray &key, const QImage &image);
+};
+
+#endif // RAW_CACHE_H
@@ -18,14 +18,49 @@
  */
 
 #include "datastream.h"
+#include "rawcache.h"
 #include "rawiohandler.h"
+#include "rawscaler.h"
 
 #include <QDebug>
+#include <QFileDevice>
 #include <QImage>
+#include <QPointer>
+#include <QThread>
+#include <QtMath>
 #include <QVariant>
 
 #include <libraw.h>
 
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define RAW_HAS_SSSE3_PATH
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RAW_HAS_NEON_PATH
+#endif
+
+// Qt 5.12 起支持 16 位每通道的图片格式
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+#define RAW_HAS_16BIT_OUTPUT
+#endif
+
+// 读取方通过 QImageReader::setSubType() 请求 16 位输出时使用的子类型，默认输出 8 位
+static const QByteArray s_subType8Bit("8bit");
+static const QByteArray s_subType16Bit("16bit");
+
+static QList<QByteArray> supportedSubTypes()
+{
+    QList<QByteArray> subTypes;
+    subTypes << s_subType8Bit;
+#ifdef RAW_HAS_16BIT_OUTPUT
+    subTypes << s_subType16Bit;
+#endif
+    return subTypes;
+}
+
 class RawIOHandlerPrivate
 {
 public:
@@ -38,39 +73,376 @@ public:
     ~RawIOHandlerPrivate();
 
     bool load(QIODevice *device);
+    bool open(QIODevice *device);
+    void release();
+    QSize requiredSize() const;
+    QImage::Format outputFormat(QIODevice *device);
+    int selectThumbnail(const QSize &target) const;
+    bool unpackThumbnail(int index);
+    bool canCrop() const;
+    QRect mapToSensor(const QRect &rect) const;
+    QRect mapFromSensor(const QRect &rect) const;
+    void takeFrom(RawIOHandlerPrivate *other);
 
     LibRaw *raw;
-    Datastream *stream;
+    LibRaw_abstract_datastream *stream;
+    QPointer<QFileDevice> mappedFile;   // 映射到内存的文件
+    uchar *mappedData = nullptr;        // 文件映射的内存地址
     QSize            defaultSize;
     QSize            scaledSize;
+    QRect            clipRect;
+    QRect            scaledClipRect;
+    int              quality = -1;
+    QByteArray       subType;       // 读取方请求的输出子类型，仅 "16bit" 时输出 16 位数据
+    QImage::Format   readFormat = QImage::Format_Invalid;   // 最近一次 read() 输出的图片格式
+    QByteArray       formatHint;    // 无 RawIOHandler 时使用的格式标识
     mutable RawIOHandler *q;
 };
 
+/**
+ * @brief canRead(QIODevice*) 中打开的 LibRaw 对象缓存
+ *      Qt 插件先调用 capabilities() 判断能否读取，随后 create() 新的 RawIOHandler 读取，
+ *      缓存打开结果供随后同一设备的读取复用，避免重复解析 RAW 文件头及 EXIF 信息。
+ *      每个线程仅缓存最近一次打开的设备，打开其它设备、设备被释放(Qt 选择了其它处理器或未调用 read())时
+ *      立即释放缓存的 LibRaw 对象及文件映射。
+ */
+struct OpenedRawCache
+{
+    ~OpenedRawCache()
+    {
+        clear();
+    }
+
+    void set(QIODevice *dev, RawIOHandlerPrivate *priv)
+    {
+        clear();
+        device = dev;
+        opened = priv;
+        // 设备通常在同一线程中释放，其它线程中释放时由此线程下次调用 take() 或 set() 时释放
+        QThread *owner = QThread::currentThread();
+        connection = QObject::connect(dev, &QObject::destroyed, [this, owner]() {
+            if (QThread::currentThread() == owner) {
+                clear();
+            }
+        });
+    }
+
+    /**
+     * @return 设备 \a dev 的打开结果，调用方接管所有权；缓存的为其它设备时释放缓存并返回空指针
+     */
+    RawIOHandlerPrivate *take(QIODevice *dev)
+    {
+        RawIOHandlerPrivate *result = nullptr;
+        if (opened && device && device == dev) {
+            result = opened;
+            opened = nullptr;
+        }
+        clear();
+        return result;
+    }
+
+    void clear()
+    {
+        QObject::disconnect(connection);
+        delete opened;
+        opened = nullptr;
+        device = nullptr;
+    }
+
+    QPointer<QIODevice> device;
+    RawIOHandlerPrivate *opened = nullptr;
+    QMetaObject::Connection connection;     // 设备释放时清除缓存
+};
+
+static thread_local OpenedRawCache t_openedCache;
+
+/**
+ * @brief 通过文件头快速判断是否可能为 RAW 文件，无需创建 LibRaw 对象
+ * @param device 读取的设备，仅预览数据，不改变读取位置
+ * @param trustFormat 格式标识已指明为 RAW 格式(插件声明的格式，见 RawIOHandler::formats())，
+ *      无法识别的文件头(部分旧相机的 NEF KDC 等文件没有文件头，LibRaw 通过文件大小识别)仍需完整打开判断
+ * @return 是否需要通过 LibRaw 完整打开判断
+ */
+static bool isRawCandidate(QIODevice *device, bool trustFormat)
+{
+    const QByteArray header = device->peek(16);
+    if (header.size() < 4) {
+        return false;
+    }
+
+    const char *h = header.constData();
+    const int len = header.size();
+    // 基于 TIFF 的格式(CR2 NEF DNG PEF ARW SRW DCR KDC 3FR 等)及 ORF RW2 IIQ
+    if (0 == memcmp(h, "II*\0", 4) || 0 == memcmp(h, "MM\0*", 4)
+            || 0 == memcmp(h, "IIRO", 4) || 0 == memcmp(h, "IIRS", 4) || 0 == memcmp(h, "MMOR", 4)
+            || 0 == memcmp(h, "IIU\0", 4) || 0 == memcmp(h, "IIII", 4)) {
+        return true;
+    }
+    // MRW X3F ARRI
+    if (0 == memcmp(h, "\0MRM", 4) || 0 == memcmp(h, "FOVb", 4) || 0 == memcmp(h, "ARRI", 4)) {
+        return true;
+    }
+    // RAF NOKIA CRW CR3
+    if (len >= 14 && (0 == memcmp(h, "FUJIFILM", 8) || 0 == memcmp(h, "NOKIARAW", 8)
+                      || 0 == memcmp(h + 6, "HEAPCCDR", 8) || 0 == memcmp(h + 4, "ftypcrx ", 8))) {
+        return true;
+    }
+
+    if (!trustFormat) {
+        return false;
+    }
+
+    // 常见的非 RAW 格式(JPEG PNG GIF BMP WEBP PSD SVG)直接排除
+    if ((0xFF == uchar(h[0]) && 0xD8 == uchar(h[1])) || 0 == memcmp(h, "\x89PNG", 4)
+            || 0 == memcmp(h, "GIF8", 4) || 0 == memcmp(h, "BM", 2) || 0 == memcmp(h, "RIFF", 4)
+            || 0 == memcmp(h, "8BPS", 4) || '<' == h[0]) {
+        return false;
+    }
+    return true;
+}
+
+#ifdef RAW_HAS_SSSE3_PATH
+/**
+ * @brief 8 位 RGB 转换为 ARGB32 (内存顺序 BGRA)，每次处理 4 个像素
+ * @return 已处理的像素数，剩余像素由调用方处理
+ */
+__attribute__((target("ssse3")))
+static int swizzleRgb8RowSsse3(const uchar *src, uchar *dst, int width)
+{
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+    int x = 0;
+    // 每次读取 16 字节，仅使用前 12 字节，需保证读取不越界
+    for (; x + 6 <= width; x += 4, src += 12, dst += 16) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        pixels = _mm_or_si128(_mm_shuffle_epi8(pixels, mask), alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), pixels);
+    }
+    return x;
+}
+
+/**
+ * @brief 16 位 RGB 转换为 RGBX64 ，每次处理 2 个像素
+ */
+__attribute__((target("ssse3")))
+static int swizzleRgb16RowSsse3(const quint16 *src, quint16 *dst, int width)
+{
+    const __m128i mask = _mm_setr_epi8(0, 1, 2, 3, 4, 5, -1, -1, 6, 7, 8, 9, 10, 11, -1, -1);
+    const __m128i alpha = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+    int x = 0;
+    for (; x + 3 <= width; x += 2, src += 6, dst += 8) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        pixels = _mm_or_si128(_mm_shuffle_epi8(pixels, mask), alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), pixels);
+    }
+    return x;
+}
+
+static bool cpuHasSsse3()
+{
+    static const bool hasSsse3 = __builtin_cpu_supports("ssse3");
+    return hasSsse3;
+}
+#endif
+
+/**
+ * @brief 将 LibRaw 输出的一行 8 位 RGB 数据写入 ARGB32 图片行
+ */
+static void swizzleRgb8Row(const uchar *src, uchar *dst, int width)
+{
+    int x = 0;
+#if defined(RAW_HAS_SSSE3_PATH)
+    if (cpuHasSsse3()) {
+        x = swizzleRgb8RowSsse3(src, dst, width);
+    }
+#elif defined(RAW_HAS_NEON_PATH) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    for (; x + 8 <= width; x += 8) {
+        uint8x8x3_t rgb = vld3_u8(src + x * 3);
+        uint8x8x4_t bgra;
+        bgra.val[0] = rgb.val[2];
+        bgra.val[1] = rgb.val[1];
+        bgra.val[2] = rgb.val[0];
+        bgra.val[3] = vdup_n_u8(0xFF);
+        vst4_u8(dst + x * 4, bgra);
+    }
+#endif
+
+    QRgb *line = reinterpret_cast<QRgb *>(dst);
+    for (; x < width; x++) {
+        const uchar *pixel = src + x * 3;
+        line[x] = qRgb(pixel[0], pixel[1], pixel[2]);
+    }
+}
+
+#ifdef RAW_HAS_16BIT_OUTPUT
+/**
+ * @brief 将 LibRaw 输出的一行 16 位 RGB 数据写入 RGBX64 图片行
+ */
+static void swizzleRgb16Row(const quint16 *src, quint16 *dst, int width)
+{
+    int x = 0;
+#if defined(RAW_HAS_SSSE3_PATH)
+    if (cpuHasSsse3()) {
+        x = swizzleRgb16RowSsse3(src, dst, width);
+    }
+#elif defined(RAW_HAS_NEON_PATH)
+    for (; x + 8 <= width; x += 8) {
+        uint16x8x3_t rgb = vld3q_u16(src + x * 3);
+        uint16x8x4_t rgbx;
+        rgbx.val[0] = rgb.val[0];
+        rgbx.val[1] = rgb.val[1];
+        rgbx.val[2] = rgb.val[2];
+        rgbx.val[3] = vdupq_n_u16(0xFFFF);
+        vst4q_u16(dst + x * 4, rgbx);
+    }
+#endif
+
+    for (; x < width; x++) {
+        dst[x * 4] = src[x * 3];
+        dst[x * 4 + 1] = src[x * 3 + 1];
+        dst[x * 4 + 2] = src[x * 3 + 2];
+        dst[x * 4 + 3] = 0xFFFF;
+    }
+}
+#endif
+
+/**
+ * @brief 将 LibRaw 输出的位图数据直接转换到最终的 QImage 中，
+ *      16 位输出转换为 RGBX64 ，8 位输出转换为 ARGB32 (RGB32 会导致窗口透明)
+ */
+static QImage bitmapToImage(const libraw_processed_image_t *output)
+{
+    const int width = output->width;
+    const int height = output->height;
+    const bool is16Bit = (16 == output->bits);
+    const int srcBytesPerLine = width * output->colors * (is16Bit ? 2 : 1);
+
+#ifdef RAW_HAS_16BIT_OUTPUT
+    QImage image(width, height, is16Bit ? QImage::Format_RGBX64 : QImage::Format_ARGB32);
+#else
+    QImage image(width, height, QImage::Format_ARGB32);
+#endif
+    if (image.isNull()) {
+        return image;
+    }
+
+    for (int y = 0; y < height; y++) {
+        const uchar *src = output->data + qint64(y) * srcBytesPerLine;
+        uchar *dst = image.scanLine(y);
+
+        if (3 == output->colors) {
+#ifdef RAW_HAS_16BIT_OUTPUT
+            if (is16Bit) {
+                swizzleRgb16Row(reinterpret_cast<const quint16 *>(src), reinterpret_cast<quint16 *>(dst), width);
+                continue;
+            }
+#endif
+            swizzleRgb8Row(src, dst, width);
+            continue;
+        }
+
+        // 灰度图
+        for (int x = 0; x < width; x++) {
+#ifdef RAW_HAS_16BIT_OUTPUT
+            if (is16Bit) {
+                quint16 gray = reinterpret_cast<const quint16 *>(src)[x * output->colors];
+                reinterpret_cast<QRgba64 *>(dst)[x] = qRgba64(gray, gray, gray, 0xFFFF);
+                continue;
+            }
+#endif
+            uchar gray = src[x * output->colors];
+            reinterpret_cast<QRgb *>(dst)[x] = qRgb(gray, gray, gray);
+        }
+    }
+
+    return image;
+}
+
 RawIOHandlerPrivate::~RawIOHandlerPrivate()
+{
+    release();
+}
+
+void RawIOHandlerPrivate::release()
 {
     delete raw;
     raw = nullptr;
     delete stream;
     stream = nullptr;
+    if (mappedFile && mappedData) {
+        mappedFile->unmap(mappedData);
+    }
+    mappedData = nullptr;
+    mappedFile = nullptr;
 }
 
-bool RawIOHandlerPrivate::load(QIODevice *device)
+/**
+ * @brief 接管 \a other 打开的 LibRaw 对象及数据流
+ */
+void RawIOHandlerPrivate::takeFrom(RawIOHandlerPrivate *other)
 {
-    if (device == nullptr) return false;
+    release();
+    raw = other->raw;
+    stream = other->stream;
+    mappedFile = other->mappedFile;
+    mappedData = other->mappedData;
+    other->raw = nullptr;
+    other->stream = nullptr;
+    other->mappedFile = nullptr;
+    other->mappedData = nullptr;
+}
 
-    device->seek(0);
-    if (raw != nullptr) return true;
+/**
+ * @brief 通过 LibRaw 打开设备 \a device ，文件设备映射到内存后通过 LibRaw_buffer_datastream 读取，
+ *      避免 LibRaw 解码时的大量小数据读取经过 QIODevice 虚函数调用；
+ *      其它设备或映射失败时使用按块缓存的 Datastream 读取
+ */
+bool RawIOHandlerPrivate::open(QIODevice *device)
+{
+    QFileDevice *file = qobject_cast<QFileDevice *>(device);
+    if (file && file->size() > 0) {
+        mappedData = file->map(0, file->size());
+        if (mappedData) {
+            mappedFile = file;
+            stream = new LibRaw_buffer_datastream(mappedData, static_cast<size_t>(file->size()));
+        }
+    }
+    if (!stream) {
+        stream = new Datastream(device);
+    }
 
-    stream = new Datastream(device);
     raw = new LibRaw;
     raw->imgdata.params.use_rawspeed = 1;
     if (raw->open_datastream(stream) != LIBRAW_SUCCESS) {
-        delete raw;
-        raw = nullptr;
-        delete stream;
-        stream = nullptr;
+        release();
         return false;
     }
+    return true;
+}
+
+bool RawIOHandlerPrivate::load(QIODevice *device)
+{
+    if (device == nullptr) return false;
+
+    device->seek(0);
+    if (raw != nullptr) return true;
+
+    RawIOHandlerPrivate *opened = t_openedCache.take(device);
+    if (opened) {
+        // 复用 canRead() 的打开结果
+        takeFrom(opened);
+        delete opened;
+    } else {
+        const QByteArray format = q ? q->format() : formatHint;
+        const bool trustFormat = RawIOHandler::formats().contains(QString::fromLatin1(format.toUpper()));
+        if (!isRawCandidate(device, trustFormat)) {
+            return false;
+        }
+
+        if (!open(device)) {
+            return false;
+        }
+    }
 
     defaultSize = QSize(raw->imgdata.sizes.width,
                         raw->imgdata.sizes.height);
@@ -81,6 +453,167 @@ bool RawIOHandlerPrivate::load(QIODevice *device)
 }
 
 
+/**
+ * @brief 选择能覆盖目标大小 \a target 的最小内嵌预览图，预览图越小解码越快
+ * @return 预览图索引，-1 表示没有满足条件的预览图
+ */
+int RawIOHandlerPrivate::selectThumbnail(const QSize &target) const
+{
+    const libraw_data_t &imgdata = raw->imgdata;
+    // 预览图尺寸为旋转前的尺寸，与目标尺寸比较时需要按图片方向转换
+    const bool transposed = (imgdata.sizes.flip == 5 || imgdata.sizes.flip == 6);
+    auto covers = [&](int width, int height) {
+        QSize thumbSize(width, height);
+        if (transposed) {
+            thumbSize.transpose();
+        }
+        return thumbSize.width() >= target.width() && thumbSize.height() >= target.height();
+    };
+
+#if LIBRAW_COMPILE_CHECK_VERSION_NOTLESS(0, 21)
+    // LibRaw 0.21 起可获取文件中的所有预览图
+    int best = -1;
+    qint64 bestArea = 0;
+    for (int i = 0; i < imgdata.thumbs_list.thumbcount; i++) {
+        const libraw_thumbnail_item_t &item = imgdata.thumbs_list.thumblist[i];
+        if (!covers(item.twidth, item.theight)) {
+            continue;
+        }
+        qint64 area = qint64(item.twidth) * item.theight;
+        if (best < 0 || area < bestArea) {
+            best = i;
+            bestArea = area;
+        }
+    }
+    return best;
+#else
+    return covers(imgdata.thumbnail.twidth, imgdata.thumbnail.theight) ? 0 : -1;
+#endif
+}
+
+/**
+ * @return 按整幅图片计算满足输出所需的分辨率，用于选择预览图及 half_size
+ */
+QSize RawIOHandlerPrivate::requiredSize() const
+{
+    const QRect fullRect(QPoint(0, 0), defaultSize);
+    const QRect clip = clipRect.isValid() ? clipRect.intersected(fullRect) : QRect();
+    const QSize contentSize = clip.isValid() ? clip.size() : defaultSize;
+    const QSize finalSize = scaledSize.isValid() ? scaledSize : contentSize;
+    if (!clip.isValid() || clip.isEmpty()) {
+        return finalSize;
+    }
+    return QSize(qCeil(qreal(defaultSize.width()) * finalSize.width() / clip.width()),
+                 qCeil(qreal(defaultSize.height()) * finalSize.height() / clip.height()));
+}
+
+/**
+ * @return read() 输出的图片格式，读取后为实际格式。读取前按当前参数预测：
+ *      使用内嵌预览图时为 JPEG 解码的 RGB32 ，请求 16 位子类型并处理 RAW 数据时为 RGBX64 ，否则为 ARGB32
+ */
+QImage::Format RawIOHandlerPrivate::outputFormat(QIODevice *device)
+{
+    if (QImage::Format_Invalid != readFormat) {
+        return readFormat;
+    }
+    if (!load(device)) {
+        return QImage::Format_Invalid;
+    }
+    if (selectThumbnail(requiredSize()) >= 0) {
+        return QImage::Format_RGB32;
+    }
+#ifdef RAW_HAS_16BIT_OUTPUT
+    if (s_subType16Bit == subType) {
+        return QImage::Format_RGBX64;
+    }
+#endif
+    return QImage::Format_ARGB32;
+}
+
+bool RawIOHandlerPrivate::unpackThumbnail(int index)
+{
+#if LIBRAW_COMPILE_CHECK_VERSION_NOTLESS(0, 21)
+    return raw->unpack_thumb_ex(index) == LIBRAW_SUCCESS;
+#else
+    Q_UNUSED(index)
+    return raw->unpack_thumb() == LIBRAW_SUCCESS;
+#endif
+}
+
+
+/**
+ * @return 能否通过 cropbox 仅处理部分区域，X-Trans 、非方形像素的图片坐标映射复杂，不进行裁剪
+ */
+bool RawIOHandlerPrivate::canCrop() const
+{
+#if LIBRAW_COMPILE_CHECK_VERSION_NOTLESS(0, 20)
+    const libraw_data_t &imgdata = raw->imgdata;
+    return imgdata.idata.filters != 9 && qFuzzyCompare(imgdata.sizes.pixel_aspect, 1.0);
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief 将旋转后的图片区域 \a rect 映射到传感器(旋转前)坐标
+ */
+QRect RawIOHandlerPrivate::mapToSensor(const QRect &rect) const
+{
+    const int sensorWidth = raw->imgdata.sizes.width;
+    const int sensorHeight = raw->imgdata.sizes.height;
+    switch (raw->imgdata.sizes.flip) {
+    case 3:
+        return QRect(sensorWidth - rect.x() - rect.width(), sensorHeight - rect.y() - rect.height(),
+                     rect.width(), rect.height());
+    case 5:
+        return QRect(sensorWidth - rect.y() - rect.height(), rect.x(), rect.height(), rect.width());
+    case 6:
+        return QRect(rect.y(), sensorHeight - rect.x() - rect.width(), rect.height(), rect.width());
+    default:
+        return rect;
+    }
+}
+
+/**
+ * @brief 将传感器坐标的区域 \a rect 映射到旋转后的图片坐标，mapToSensor() 的逆变换
+ */
+QRect RawIOHandlerPrivate::mapFromSensor(const QRect &rect) const
+{
+    const int sensorWidth = raw->imgdata.sizes.width;
+    const int sensorHeight = raw->imgdata.sizes.height;
+    switch (raw->imgdata.sizes.flip) {
+    case 3:
+        return QRect(sensorWidth - rect.x() - rect.width(), sensorHeight - rect.y() - rect.height(),
+                     rect.width(), rect.height());
+    case 5:
+        return QRect(rect.y(), sensorWidth - rect.x() - rect.width(), rect.height(), rect.width());
+    case 6:
+        return QRect(sensorHeight - rect.y() - rect.height(), rect.x(), rect.height(), rect.width());
+    default:
+        return rect;
+    }
+}
+
+
+/**
+ * @return 插件声明支持的 RAW 格式(大写)
+ */
+QStringList RawIOHandler::formats()
+{
+    static const QStringList raws = QStringList()
+                                    << QLatin1String("CR2") << QLatin1String("CRW")   // Canon cameras
+                                    << QLatin1String("DCR") << QLatin1String("KDC")   // Kodak cameras
+                                    << QLatin1String("MRW")            // Minolta cameras
+                                    << QLatin1String("NEF")            // Nikon cameras
+                                    << QLatin1String("ORF")            // Olympus cameras
+                                    << QLatin1String("PEF")            // Pentax cameras
+                                    << QLatin1String("RAF")            // Fuji cameras
+                                    << QLatin1String("SRF")            // Sony cameras
+                                    << QLatin1String("DNG")            //
+                                    << QLatin1String("RAW");           // RAW formats.
+    return raws;
+}
+
 RawIOHandler::RawIOHandler():
     d(new RawIOHandlerPrivate(this))
 {
@@ -96,7 +629,8 @@ RawIOHandler::~RawIOHandler()
 
 bool RawIOHandler::canRead() const
 {
-    if (canRead(device())) {
+    // 直接打开当前设备，打开结果在 read() 中复用
+    if (d->load(device())) {
         setFormat("raw");
         return true;
     }
@@ -104,13 +638,30 @@ bool RawIOHandler::canRead() const
 }
 
 
-bool RawIOHandler::canRead(QIODevice *device)
+/**
+ * @brief 判断设备 \a device 能否读取，先通过文件头快速排除非 RAW 文件，
+ *      仅对可能的 RAW 文件通过 LibRaw 完整打开，打开结果缓存供随后的 read() 使用
+ * @param format 文件格式标识，为 RAW 时无法识别文件头的文件仍会尝试打开
+ */
+bool RawIOHandler::canRead(QIODevice *device, const QByteArray &format)
 {
     if (!device) {
         return false;
     }
-    RawIOHandler handler;
-    return handler.d->load(device);
+    // 释放之前其它设备的打开结果
+    t_openedCache.clear();
+
+    const qint64 pos = device->pos();
+    RawIOHandlerPrivate *priv = new RawIOHandlerPrivate(nullptr);
+    priv->formatHint = format;
+    bool ret = priv->load(device);
+    device->seek(pos);
+    if (ret) {
+        t_openedCache.set(device, priv);
+    } else {
+        delete priv;
+    }
+    return ret;
 }
 
 
@@ -118,17 +669,29 @@ bool RawIOHandler::read(QImage *image)
 {
     if (!d->load(device())) return false;
 
+    // 裁剪区域为旋转后的图片坐标，先裁剪再缩放至 ScaledSize ，最后按 ScaledClipRect 裁剪
+    const QRect fullRect(QPoint(0, 0), d->defaultSize);
+    const QRect clipRect = d->clipRect.isValid() ? d->clipRect.intersected(fullRect) : QRect();
+    if (d->clipRect.isValid() && clipRect.isEmpty()) {
+        return false;
+    }
+    const QSize contentSize = clipRect.isValid() ? clipRect.size() : d->defaultSize;
     QSize finalSize = d->scaledSize.isValid() ?
-                      d->scaledSize : d->defaultSize;
+                      d->scaledSize : contentSize;
+    // 按整幅图片计算满足输出所需的分辨率，用于选择预览图及 half_size
+    const QSize requiredSize = d->requiredSize();
+    // 解码得到的图片数据对应的区域(旋转后的图片坐标)
+    QRect developedRect = fullRect;
 
     const libraw_data_t &imgdata = d->raw->imgdata;
     libraw_processed_image_t *output = nullptr;
     int errCode = 0;
+    QImage unscaled;
+    QByteArray cacheKey;
 
-    if (finalSize.width() < imgdata.thumbnail.twidth ||
-            finalSize.height() < imgdata.thumbnail.theight) {
-        qDebug() << "Using thumbnail";
-        d->raw->unpack_thumb();
+    const int thumbIndex = d->selectThumbnail(requiredSize);
+    if (thumbIndex >= 0 && d->unpackThumbnail(thumbIndex)) {
+        qDebug() << "Using thumbnail" << thumbIndex;
 
         errCode = LIBRAW_SUCCESS;
         output = d->raw->dcraw_make_mem_thumb(&errCode);
@@ -137,13 +700,57 @@ bool RawIOHandler::read(QImage *image)
                           .arg(errCode).arg(QString(d->raw->strerror(errCode)));
             if (output) {
                 d->raw->dcraw_clear_mem(output);
+                output = nullptr;
             }
             // 不存在缩略图数据，可走图像数据分支
         }
     }
 
     if (!output) {
-        qDebug() << "Decoding raw data";
+        // 目标尺寸不超过传感器分辨率的一半时，使用 half_size 模式解码，
+        // 直接合并 2x2 的 Bayer 像素，无需完整的去马赛克处理
+        const QSize sensorSize = d->defaultSize;
+        const bool halfSize = requiredSize.width() * 2 <= sensorSize.width()
+                              && requiredSize.height() * 2 <= sensorSize.height();
+        d->raw->imgdata.params.half_size = halfSize ? 1 : 0;
+#ifdef RAW_HAS_16BIT_OUTPUT
+        // 读取方通过子类型请求时输出 16 位数据，保留更多色调细节。默认输出 8 位，
+        // 16 位图片的内存占用及缓存大小加倍，而仅需 8 位数据的读取方会再次转换
+        d->raw->imgdata.params.output_bps = (s_subType16Bit == d->subType) ? 16 : 8;
+#endif
+
+#if LIBRAW_COMPILE_CHECK_VERSION_NOTLESS(0, 20)
+        d->raw->imgdata.params.cropbox[0] = d->raw->imgdata.params.cropbox[1] = 0;
+        d->raw->imgdata.params.cropbox[2] = d->raw->imgdata.params.cropbox[3] = 0;
+#endif
+
+        // 优先读取磁盘缓存的处理结果(整幅图片)
+        cacheKey = RawCache::cacheKey(device(), d->raw->imgdata.params);
+        if (!cacheKey.isEmpty() && RawCache::load(cacheKey, &unscaled)) {
+            qDebug() << "Using cached raw data";
+        } else if (clipRect.isValid() && clipRect != fullRect && d->canCrop()) {
+#if LIBRAW_COMPILE_CHECK_VERSION_NOTLESS(0, 20)
+            // 仅处理裁剪区域，额外保留去马赛克插值所需的边缘，按 Bayer 阵列 2x2 对齐
+            const int margin = 8;
+            QRect sensorRect = d->mapToSensor(clipRect.adjusted(-margin, -margin, margin, margin).intersected(fullRect));
+            sensorRect.setLeft(sensorRect.left() & ~1);
+            sensorRect.setTop(sensorRect.top() & ~1);
+            sensorRect.setWidth(qMin((sensorRect.width() + 1) & ~1, d->raw->imgdata.sizes.width - sensorRect.left()));
+            sensorRect.setHeight(qMin((sensorRect.height() + 1) & ~1, d->raw->imgdata.sizes.height - sensorRect.top()));
+
+            d->raw->imgdata.params.cropbox[0] = static_cast<unsigned>(sensorRect.x());
+            d->raw->imgdata.params.cropbox[1] = static_cast<unsigned>(sensorRect.y());
+            d->raw->imgdata.params.cropbox[2] = static_cast<unsigned>(sensorRect.width());
+            d->raw->imgdata.params.cropbox[3] = static_cast<unsigned>(sensorRect.height());
+            developedRect = d->mapFromSensor(sensorRect);
+            // 部分区域的处理结果不写入缓存
+            cacheKey.clear();
+#endif
+        }
+    }
+
+    if (!output && unscaled.isNull()) {
+        qDebug() << "Decoding raw data" << (d->raw->imgdata.params.half_size ? "(half size)" : "");
         if ((errCode = d->raw->unpack()) != LIBRAW_SUCCESS) {
             qWarning() << "Decoding raw data unpack error:" << LibRaw::strerror(errCode);
             return false;
@@ -167,9 +774,9 @@ bool RawIOHandler::read(QImage *image)
         }
     }
 
-    QImage unscaled;
-    uchar *pixels = nullptr;
-    if (output->type == LIBRAW_IMAGE_JPEG) {
+    if (!output) {
+        // 使用缓存的图片
+    } else if (output->type == LIBRAW_IMAGE_JPEG) {
         unscaled.loadFromData(output->data, static_cast<int>(output->data_size), "JPEG");
         if (imgdata.sizes.flip != 0) {
             QTransform rotation;
@@ -183,44 +790,41 @@ bool RawIOHandler::read(QImage *image)
             }
         }
     } else {
-        int numPixels = output->width * output->height;
-        int colorSize = output->bits / 8;
-        int pixelSize = output->colors * colorSize;
-        pixels = new uchar[numPixels * 4];
-        uchar *data = output->data;
-        for (int i = 0; i < numPixels; i++, data += pixelSize) {
-            if (output->colors == 3) {
-                pixels[i * 4] = data[2 * colorSize];
-                pixels[i * 4 + 1] = data[1 * colorSize];
-                pixels[i * 4 + 2] = data[0];
-            } else {
-                pixels[i * 4] = data[0];
-                pixels[i * 4 + 1] = data[0];
-                pixels[i * 4 + 2] = data[0];
-            }
+        unscaled = bitmapToImage(output);
+        RawCache::save(cacheKey, unscaled);
+
+        // 解码结果与期望的裁剪区域大小不符时(LibRaw 未按 cropbox 裁剪)，按整幅图片处理
+        const int divisor = d->raw->imgdata.params.half_size ? 2 : 1;
+        if (developedRect != fullRect
+                && (qAbs(unscaled.width() - developedRect.width() / divisor) > 2
+                    || qAbs(unscaled.height() - developedRect.height() / divisor) > 2)) {
+            developedRect = fullRect;
         }
-        unscaled = QImage(pixels,
-                          output->width, output->height,
-                          QImage::Format_RGB32)
-                   // QImage::Format_RGB32 will cause window transparent, DON'T know why
-                   .convertToFormat(QImage::Format_ARGB32);
+    }
+
+    if (clipRect.isValid() && !unscaled.isNull()) {
+        // 将裁剪区域映射到解码结果的坐标
+        const qreal scaleX = qreal(unscaled.width()) / developedRect.width();
+        const qreal scaleY = qreal(unscaled.height()) / developedRect.height();
+        const QRectF area((clipRect.x() - developedRect.x()) * scaleX, (clipRect.y() - developedRect.y()) * scaleY,
+                          clipRect.width() * scaleX, clipRect.height() * scaleY);
+        unscaled = unscaled.copy(area.toAlignedRect().intersected(unscaled.rect()));
     }
 
     if (unscaled.size() != finalSize) {
-        // TODO: use quality parameter to decide transformation method
-        *image = unscaled.scaled(finalSize, Qt::IgnoreAspectRatio,
-                                 Qt::SmoothTransformation);
+        *image = RawScaler::scale(unscaled, finalSize, RawScaler::filterForQuality(d->quality));
     } else {
         *image = unscaled;
-        if (output->type == LIBRAW_IMAGE_BITMAP) {
-            // make sure that the bits are copied
-            uchar *b = image->bits();
-            Q_UNUSED(b);
-        }
     }
-    d->raw->dcraw_clear_mem(output);
-    delete[] pixels;
 
+    if (d->scaledClipRect.isValid()) {
+        *image = image->copy(d->scaledClipRect);
+    }
+    if (output) {
+        d->raw->dcraw_clear_mem(output);
+    }
+
+    d->readFormat = image->format();
     return true;
 }
 
@@ -229,12 +833,22 @@ QVariant RawIOHandler::option(ImageOption option) const
 {
     switch (option) {
     case ImageFormat:
-        return QImage::Format_RGB32;
+        return d->outputFormat(device());
+    case SubType:
+        return d->subType;
+    case SupportedSubTypes:
+        return QVariant::fromValue(supportedSubTypes());
     case Size:
         d->load(device());
         return d->defaultSize;
     case ScaledSize:
         return d->scaledSize;
+    case ClipRect:
+        return d->clipRect;
+    case ScaledClipRect:
+        return d->scaledClipRect;
+    case Quality:
+        return d->quality;
     default:
         break;
     }
@@ -248,6 +862,18 @@ void RawIOHandler::setOption(ImageOption option, const QVariant &value)
     case ScaledSize:
         d->scaledSize = value.toSize();
         break;
+    case ClipRect:
+        d->clipRect = value.toRect();
+        break;
+    case ScaledClipRect:
+        d->scaledClipRect = value.toRect();
+        break;
+    case Quality:
+        d->quality = value.toInt();
+        break;
+    case SubType:
+        d->subType = value.toByteArray();
+        break;
     default:
         break;
     }
@@ -260,6 +886,11 @@ bool RawIOHandler::supportsOption(ImageOption option) const
     case ImageFormat:
     case Size:
     case ScaledSize:
+    case ClipRect:
+    case ScaledClipRect:
+    case Quality:
+    case SubType:
+    case SupportedSubTypes:
         return true;
     default:
         break;
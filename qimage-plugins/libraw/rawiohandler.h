@@ -21,6 +21,7 @@
 #define RAW_IO_HANDLER_H
 
 #include <QImageIOHandler>
+#include <QStringList>
 
 class QImage;
 class QByteArray;
@@ -36,7 +37,8 @@ public:
 
     virtual bool canRead() const;
     virtual bool read(QImage *image);
-    static bool canRead(QIODevice *device);
+    static bool canRead(QIODevice *device, const QByteArray &format = QByteArray());
+    static QStringList formats();
     virtual QVariant option(ImageOption option) const;
     virtual void setOption(ImageOption option, const QVariant &value);
     virtual bool supportsOption(ImageOption option) const;
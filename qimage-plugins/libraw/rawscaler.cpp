@@ -0,0 +1,438 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "rawscaler.h"
+
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QVector>
+#include <QtMath>
+
+#include <functional>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+enum Constant {
+    EMinBandRows = 16,                  // 每个分段的最小输出行数
+    EParallelPixels = 1024 * 1024,      // 源图片像素数超过此值时并行缩放
+    EMaxBoxFactor = 64,                 // 区域平均的最大倍数，保证 16 位累加不溢出
+};
+
+/**
+ * @brief 将 \a count 个分段分发到全局线程池执行，调用线程同样参与处理。
+ *      线程池繁忙时未开始执行的任务被取回，避免在线程池线程中调用时等待造成死锁
+ */
+class BandJob
+{
+public:
+    BandJob(int count, const std::function<void(int)> &func)
+        : m_count(count)
+        , m_func(func)
+    {
+    }
+
+    void runBands()
+    {
+        int band;
+        while ((band = m_next.fetchAndAddRelaxed(1)) < m_count) {
+            m_func(band);
+        }
+    }
+
+    void run()
+    {
+        QThreadPool *pool = QThreadPool::globalInstance();
+        const int taskCount = qMin(m_count, pool->maxThreadCount()) - 1;
+        if (taskCount <= 0) {
+            runBands();
+            return;
+        }
+
+        QVector<QRunnable *> tasks;
+        for (int i = 0; i < taskCount; i++) {
+            QRunnable *task = new BandTask(this);
+            task->setAutoDelete(false);
+            tasks.append(task);
+            pool->start(task);
+        }
+
+        runBands();
+
+        int started = 0;
+        for (QRunnable *task : tasks) {
+            if (!pool->tryTake(task)) {
+                started++;
+            }
+        }
+        m_finished.acquire(started);
+        qDeleteAll(tasks);
+    }
+
+private:
+    class BandTask : public QRunnable
+    {
+    public:
+        explicit BandTask(BandJob *job)
+            : m_job(job)
+        {
+        }
+
+        void run() override
+        {
+            m_job->runBands();
+            m_job->m_finished.release();
+        }
+
+    private:
+        BandJob *m_job;
+    };
+
+    int                         m_count;
+    std::function<void(int)>    m_func;
+    QAtomicInt                  m_next;
+    QSemaphore                  m_finished;
+};
+
+/**
+ * @brief 将 \a rows 行输出按分段处理，源图片较大时并行执行
+ */
+static void forEachBand(int rows, qint64 srcPixels, const std::function<void(int, int)> &func)
+{
+    const int threads = QThreadPool::globalInstance()->maxThreadCount();
+    if (srcPixels < EParallelPixels || threads <= 1 || rows < EMinBandRows * 2) {
+        func(0, rows);
+        return;
+    }
+
+    // 分段数多于线程数，平衡各线程的负载
+    const int bandRows = qMax(int(EMinBandRows), (rows + threads * 4 - 1) / (threads * 4));
+    const int bandCount = (rows + bandRows - 1) / bandRows;
+    BandJob job(bandCount, [&](int band) {
+        const int begin = band * bandRows;
+        func(begin, qMin(rows, begin + bandRows));
+    });
+    job.run();
+}
+
+/**
+ * @brief 将一行 \a n 个 8 位通道值累加到 \a acc
+ */
+static void accumulateRow(const quint8 *src, quint32 *acc, int n)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        __m128i *a = reinterpret_cast<__m128i *>(acc + i);
+        _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), _mm_unpacklo_epi16(lo, zero)));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_unpackhi_epi16(lo, zero)));
+        _mm_storeu_si128(a + 2, _mm_add_epi32(_mm_loadu_si128(a + 2), _mm_unpacklo_epi16(hi, zero)));
+        _mm_storeu_si128(a + 3, _mm_add_epi32(_mm_loadu_si128(a + 3), _mm_unpackhi_epi16(hi, zero)));
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+        uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+        vst1q_u32(acc + i, vaddw_u16(vld1q_u32(acc + i), vget_low_u16(lo)));
+        vst1q_u32(acc + i + 4, vaddw_u16(vld1q_u32(acc + i + 4), vget_high_u16(lo)));
+        vst1q_u32(acc + i + 8, vaddw_u16(vld1q_u32(acc + i + 8), vget_low_u16(hi)));
+        vst1q_u32(acc + i + 12, vaddw_u16(vld1q_u32(acc + i + 12), vget_high_u16(hi)));
+    }
+#endif
+    for (; i < n; i++) {
+        acc[i] += src[i];
+    }
+}
+
+/**
+ * @brief 将一行 \a n 个 16 位通道值累加到 \a acc
+ */
+static void accumulateRow(const quint16 *src, quint32 *acc, int n)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i *a = reinterpret_cast<__m128i *>(acc + i);
+        _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), _mm_unpacklo_epi16(v, zero)));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_unpackhi_epi16(v, zero)));
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t v = vld1q_u16(src + i);
+        vst1q_u32(acc + i, vaddw_u16(vld1q_u32(acc + i), vget_low_u16(v)));
+        vst1q_u32(acc + i + 4, vaddw_u16(vld1q_u32(acc + i + 4), vget_high_u16(v)));
+    }
+#endif
+    for (; i < n; i++) {
+        acc[i] += src[i];
+    }
+}
+
+/**
+ * @brief 按 \a factorX x \a factorY 区域平均缩小图片，T 为通道类型，每像素 4 个通道
+ */
+template <typename T>
+static QImage boxDownscale(const QImage &src, int factorX, int factorY)
+{
+    const int dstWidth = src.width() / factorX;
+    const int dstHeight = src.height() / factorY;
+    QImage dst(dstWidth, dstHeight, src.format());
+    if (dst.isNull()) {
+        return QImage();
+    }
+
+    const int srcChannels = dstWidth * factorX * 4;
+    const quint32 area = static_cast<quint32>(factorX * factorY);
+    // 提前分离图片数据，各线程仅写入各自的行
+    uchar *dstBits = dst.bits();
+    const qint64 dstBytesPerLine = dst.bytesPerLine();
+    forEachBand(dstHeight, qint64(src.width()) * src.height(), [&](int begin, int end) {
+        QVector<quint32> acc(srcChannels);
+        for (int y = begin; y < end; y++) {
+            acc.fill(0);
+            for (int row = 0; row < factorY; row++) {
+                accumulateRow(reinterpret_cast<const T *>(src.constScanLine(y * factorY + row)), acc.data(), srcChannels);
+            }
+
+            T *out = reinterpret_cast<T *>(dstBits + y * dstBytesPerLine);
+            const quint32 *sum = acc.constData();
+            for (int x = 0; x < dstWidth; x++) {
+                quint32 pixel[4] = {0, 0, 0, 0};
+                for (int i = 0; i < factorX; i++, sum += 4) {
+                    pixel[0] += sum[0];
+                    pixel[1] += sum[1];
+                    pixel[2] += sum[2];
+                    pixel[3] += sum[3];
+                }
+                for (int c = 0; c < 4; c++) {
+                    *out++ = static_cast<T>((pixel[c] + area / 2) / area);
+                }
+            }
+        }
+    });
+
+    return dst;
+}
+
+static float triangleFilter(float x)
+{
+    x = qAbs(x);
+    return x < 1.0f ? 1.0f - x : 0.0f;
+}
+
+static float sinc(float x)
+{
+    if (x == 0.0f) {
+        return 1.0f;
+    }
+    x *= float(M_PI);
+    return qSin(x) / x;
+}
+
+static float lanczosFilter(float x)
+{
+    return (x > -3.0f && x < 3.0f) ? sinc(x) * sinc(x / 3.0f) : 0.0f;
+}
+
+/**
+ * @brief 可分离滤波的采样权重，输出位置 i 使用源位置 start[i] 起的 count[i] 个采样
+ */
+struct Coefficients
+{
+    QVector<int>    start;
+    QVector<int>    count;
+    QVector<float>  weights;    // 每个输出位置占用 maxCount 个权重
+    int             maxCount = 0;
+};
+
+/**
+ * @brief 计算由长度 \a srcLength 缩放至 \a dstLength 的采样权重，缩小时按缩放比例扩大滤波范围以抗锯齿
+ */
+static Coefficients computeCoefficients(int srcLength, int dstLength, RawScaler::Filter filter)
+{
+    float (*kernel)(float) = (filter == RawScaler::Lanczos) ? lanczosFilter : triangleFilter;
+    const float kernelSupport = (filter == RawScaler::Lanczos) ? 3.0f : 1.0f;
+
+    const float scale = float(srcLength) / dstLength;
+    const float filterScale = qMax(scale, 1.0f);
+    const float support = kernelSupport * filterScale;
+
+    Coefficients coeffs;
+    coeffs.maxCount = qCeil(support) * 2 + 1;
+    coeffs.start.resize(dstLength);
+    coeffs.count.resize(dstLength);
+    coeffs.weights.fill(0.0f, dstLength * coeffs.maxCount);
+
+    for (int i = 0; i < dstLength; i++) {
+        const float center = (i + 0.5f) * scale;
+        const int begin = qMax(0, int(center - support + 0.5f));
+        const int end = qMin(srcLength, int(center + support + 0.5f));
+        const int count = qMin(end - begin, coeffs.maxCount);
+
+        float *weights = coeffs.weights.data() + i * coeffs.maxCount;
+        float total = 0.0f;
+        for (int j = 0; j < count; j++) {
+            weights[j] = kernel((begin + j - center + 0.5f) / filterScale);
+            total += weights[j];
+        }
+        if (total != 0.0f) {
+            for (int j = 0; j < count; j++) {
+                weights[j] /= total;
+            }
+        }
+
+        coeffs.start[i] = begin;
+        coeffs.count[i] = count;
+    }
+
+    return coeffs;
+}
+
+template <typename T>
+static inline T clampChannel(float value)
+{
+    const float maxValue = float(std::numeric_limits<T>::max());
+    return static_cast<T>(qBound(0.0f, value + 0.5f, maxValue));
+}
+
+/**
+ * @brief 使用可分离滤波缩放图片，T 为通道类型，每像素 4 个通道。
+ *      按输出行分段，每段先对所需的源图片行水平缩放，再垂直缩放，
+ *      分段之间仅重复计算边界处少量的行，中间数据不超过分段大小
+ */
+template <typename T>
+static QImage resample(const QImage &src, const QSize &size, RawScaler::Filter filter)
+{
+    QImage dst(size, src.format());
+    if (dst.isNull()) {
+        return QImage();
+    }
+
+    const Coefficients horizontal = computeCoefficients(src.width(), size.width(), filter);
+    const Coefficients vertical = computeCoefficients(src.height(), size.height(), filter);
+    const int dstChannels = size.width() * 4;
+    uchar *dstBits = dst.bits();
+    const qint64 dstBytesPerLine = dst.bytesPerLine();
+
+    forEachBand(size.height(), qint64(src.width()) * src.height(), [&](int begin, int end) {
+        const int srcBegin = vertical.start[begin];
+        int srcEnd = srcBegin;
+        for (int y = begin; y < end; y++) {
+            srcEnd = qMax(srcEnd, vertical.start[y] + vertical.count[y]);
+        }
+
+        // 水平缩放
+        QVector<T> buffer((srcEnd - srcBegin) * dstChannels);
+        for (int row = srcBegin; row < srcEnd; row++) {
+            const T *in = reinterpret_cast<const T *>(src.constScanLine(row));
+            T *out = buffer.data() + (row - srcBegin) * dstChannels;
+            for (int x = 0; x < size.width(); x++) {
+                const float *weights = horizontal.weights.constData() + x * horizontal.maxCount;
+                const T *pixel = in + horizontal.start[x] * 4;
+                float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                for (int j = 0; j < horizontal.count[x]; j++, pixel += 4) {
+                    sum[0] += pixel[0] * weights[j];
+                    sum[1] += pixel[1] * weights[j];
+                    sum[2] += pixel[2] * weights[j];
+                    sum[3] += pixel[3] * weights[j];
+                }
+                for (int c = 0; c < 4; c++) {
+                    *out++ = clampChannel<T>(sum[c]);
+                }
+            }
+        }
+
+        // 垂直缩放
+        QVector<float> sum(dstChannels);
+        for (int y = begin; y < end; y++) {
+            sum.fill(0.0f);
+            const float *weights = vertical.weights.constData() + y * vertical.maxCount;
+            for (int j = 0; j < vertical.count[y]; j++) {
+                const T *in = buffer.constData() + (vertical.start[y] + j - srcBegin) * dstChannels;
+                const float weight = weights[j];
+                float *acc = sum.data();
+                for (int i = 0; i < dstChannels; i++) {
+                    acc[i] += in[i] * weight;
+                }
+            }
+
+            T *out = reinterpret_cast<T *>(dstBits + y * dstBytesPerLine);
+            for (int i = 0; i < dstChannels; i++) {
+                out[i] = clampChannel<T>(sum[i]);
+            }
+        }
+    });
+
+    return dst;
+}
+
+RawScaler::Filter RawScaler::filterForQuality(int quality)
+{
+    if (quality < 0) {
+        return Smooth;
+    }
+    if (quality < 50) {
+        return Box;
+    }
+    return quality < 75 ? Smooth : Lanczos;
+}
+
+QImage RawScaler::scale(const QImage &image, const QSize &size, Filter filter)
+{
+    if (image.isNull() || size.isEmpty() || image.size() == size) {
+        return image;
+    }
+
+    // 解码结果为 32 位或 64 位格式，其它格式(如内嵌的灰度预览图)转换后处理
+    QImage src = image;
+    bool deep = false;
+    switch (src.format()) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        break;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+    case QImage::Format_RGBX64:
+    case QImage::Format_RGBA64:
+    case QImage::Format_RGBA64_Premultiplied:
+        deep = true;
+        break;
+#endif
+    default:
+        src = src.convertToFormat(src.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+        break;
+    }
+
+    if (Box == filter) {
+        if (size.width() > src.width() || size.height() > src.height()) {
+            return src.scaled(size, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+        }
+
+        // 先按整数倍区域平均缩小，剩余不足 2 倍的部分平滑缩放
+        const int factorX = qMin(src.width() / size.width(), int(EMaxBoxFactor));
+        const int factorY = qMin(src.height() / size.height(), int(EMaxBoxFactor));
+        if (factorX > 1 || factorY > 1) {
+            src = deep ? boxDownscale<quint16>(src, factorX, factorY) : boxDownscale<quint8>(src, factorX, factorY);
+        }
+        if (src.size() == size || src.isNull()) {
+            return src;
+        }
+        filter = Smooth;
+    }
+
+    return deep ? resample<quint16>(src, size, filter) : resample<quint8>(src, size, filter);
+}
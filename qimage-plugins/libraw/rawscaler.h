@@ -0,0 +1,36 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef RAW_SCALER_H
+#define RAW_SCALER_H
+
+#include <QImage>
+
+/**
+ * @brief RAW 图片解码结果的缩放
+ *      RAW 图片分辨率高，QImage::scaled() 单线程的双线性缩放耗时与解码相当。
+ *      根据 QImageIOHandler::Quality 选择缩放算法：
+ *      Box 按整数倍区域平均(SIMD)快速缩小，Smooth 使用三角滤波，Lanczos 使用 Lanczos3 滤波。
+ *      大图缩放按输出行分段，在全局线程池中并行处理。
+ */
+class RawScaler
+{
+public:
+    enum Filter {
+        Box,        // 快速缩放
+        Smooth,     // 平滑缩放，默认
+        Lanczos     // 高质量缩放
+    };
+
+    /**
+     * @brief 根据图片读取质量 \a quality (0~100，-1 为默认值) 选择缩放算法，
+     *      和 Qt 内置插件一致，低于 50 时使用快速缩放
+     */
+    static Filter filterForQuality(int quality);
+
+    // 按算法 \a filter 将图片 \a image 缩放至 \a size ，不保持宽高比
+    static QImage scale(const QImage &image, const QSize &size, Filter filter);
+};
+
+#endif // RAW_SCALER_H
@@ -7,6 +7,9 @@
 #include "src/thumbnailload.h"
 #include "src/cursortool.h"
 #include "src/ocr/livetextanalyzer.h"
+#include "src/animatedimage/animatedimageitem.h"
+#include "src/tiledimage/tiledimageitem.h"
+#include "src/imageprovider/asyncimageprovider.h"
 #include "src/dbus/applicationadpator.h"
 #include "config.h"
 
@@ -47,10 +50,18 @@ int main(int argc, char *argv[])
     // 后端缩略图加载
     LoadImage *load = new LoadImage();
     engine.rootContext()->setContextProperty("CodeImage", load);
-    engine.addImageProvider(QLatin1String("ThumbnailImage"), load->m_pThumbnail);
-    engine.addImageProvider(QLatin1String("viewImage"), load->m_viewLoad);
+    // 图片提供者包装为异步接口，在 ImageLoadPool 中按优先级加载，缩略图不会延迟当前图片。
+    // 被包装的图片提供者由 AsyncImageProvider 持有，随 QML 引擎释放
+    engine.addImageProvider(QLatin1String("ThumbnailImage"), new AsyncImageProvider(load->m_pThumbnail, ImageLoadPool::EThumbnail));
+    engine.addImageProvider(QLatin1String("viewImage"), new AsyncImageProvider(load->m_viewLoad, ImageLoadPool::EImage));
     // 后端多页图加载
-    engine.addImageProvider(QLatin1String("multiimage"), load->m_multiLoad);
+    engine.addImageProvider(QLatin1String("multiimage"), new AsyncImageProvider(load->m_multiLoad, ImageLoadPool::EImage));
+    // 导航窗口预览图加载
+    engine.addImageProvider(QLatin1String("navigationImage"), new AsyncImageProvider(load->m_navigationLoad, ImageLoadPool::EImage));
+    // 动图展示组件，后台解码动图帧
+    qmlRegisterType<AnimatedImageItem>("org.deepin.image.viewer", 1, 0, "AnimatedImageView");
+    // 按视口分块绘制的图片展示组件，放大查看时仅绘制可见区域
+    qmlRegisterType<TiledImageItem>("org.deepin.image.viewer", 1, 0, "TiledImageView");
 
     FileControl *fileControl = new FileControl();
     engine.rootContext()->setContextProperty("fileControl", fileControl);
@@ -69,7 +80,7 @@ int main(int argc, char *argv[])
     // OCR分析工具
     auto liveTextAnalyzer = new LiveTextAnalyzer;
     engine.rootContext()->setContextProperty("liveTextAnalyzer", liveTextAnalyzer);
-    engine.addImageProvider(QLatin1String("liveTextAnalyzer"), liveTextAnalyzer);
+    engine.addImageProvider(QLatin1String("liveTextAnalyzer"), new AsyncImageProvider(liveTextAnalyzer, ImageLoadPool::EImage));
 
     engine.load(QUrl(QStringLiteral("qrc:/qml/main.qml")));
     if (engine.rootObjects().isEmpty())
@@ -80,5 +91,8 @@ int main(int argc, char *argv[])
     QDBusConnection::sessionBus().registerService("com.deepin.imageViewer");
     QDBusConnection::sessionBus().registerObject("/", fileControl);
 
-    return app->exec();
+    const int ret = app->exec();
+    // QML 引擎释放图片提供者前，等待引用图片提供者的加载任务完成
+    ImageLoadPool::instance()->shutdown();
+    return ret;
 }
@@ -13,6 +13,7 @@ Item {
     id: fullThumbnail
     property alias source: imageViewer.source
     property alias sourcePaths: imageViewer.sourcePaths
+    property alias sourcePathsModel: imageViewer.sourcePathsModel
     property alias currentIndex: imageViewer.swipeIndex
 
     signal closeFullThumbnail
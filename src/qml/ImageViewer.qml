@@ -8,6 +8,7 @@ import QtQuick.Controls 2.4
 import QtQuick.Layouts 1.11
 import QtQuick.Shapes 1.11
 import org.deepin.dtk 1.0
+import org.deepin.image.viewer 1.0
 
 Rectangle {
 
@@ -82,6 +83,11 @@ Rectangle {
     // 图片正在滑动中
     property bool inFlick: false
 
+    // 图片列表对应的视图模型，仅维护行数，图片路径仍通过 sourcePaths[index] 取得
+    property alias sourcePathsModel: sourcePathsModel
+    // 视图模型当前对应的图片列表，用于 sourcePaths 变更时比较差异
+    property var modelPaths: []
+
     signal sigWheelChange
     signal sigImageShowFullScreen
     signal sigImageShowNormal
@@ -238,6 +244,70 @@ Rectangle {
     }
 
     // 图片源发生改变，隐藏导航区域，重置图片缩放比例
+    ListModel {
+        id: sourcePathsModel
+    }
+
+    // 图片列表变更时按差异插入或移除视图模型的行，仅在无法按差异处理时重置模型，
+    // 避免文件夹新增图片时视图重置并重新创建所有代理
+    function syncSourcePathsModel() {
+        var newPaths = sourcePaths ? sourcePaths : []
+        var oldPaths = modelPaths
+        var rows = []
+        var i = 0
+        var j = 0
+
+        if (newPaths.length > oldPaths.length) {
+            for (j = 0; j < newPaths.length; j++) {
+                if (i < oldPaths.length && oldPaths[i] === newPaths[j]) {
+                    i++
+                } else {
+                    rows.push(j)
+                }
+            }
+
+            if (i === oldPaths.length) {
+                // 按升序插入，插入位置即为新列表中的位置
+                for (i = 0; i < rows.length; i++) {
+                    sourcePathsModel.insert(rows[i], {})
+                }
+                modelPaths = newPaths.slice()
+                return
+            }
+        } else if (newPaths.length < oldPaths.length) {
+            for (i = 0; i < oldPaths.length; i++) {
+                if (j < newPaths.length && newPaths[j] === oldPaths[i]) {
+                    j++
+                } else {
+                    rows.push(i)
+                }
+            }
+
+            if (j === newPaths.length) {
+                // 按降序移除，避免影响未处理的行号
+                for (i = rows.length - 1; i >= 0; i--) {
+                    sourcePathsModel.remove(rows[i])
+                }
+                modelPaths = newPaths.slice()
+                return
+            }
+        } else {
+            // 行数不变(例如重命名)，代理通过 sourcePaths[index] 更新路径
+            modelPaths = newPaths.slice()
+            return
+        }
+
+        var items = []
+        for (i = 0; i < newPaths.length; i++) {
+            items.push({})
+        }
+        sourcePathsModel.clear()
+        sourcePathsModel.append(items)
+        modelPaths = newPaths.slice()
+    }
+
+    onSourcePathsChanged: syncSourcePathsModel()
+
     onSourceChanged: {
         // 手动更新图源时，排除空图源影响
         if (source.length === 0) {
@@ -250,6 +320,13 @@ Rectangle {
 
         // 设置图片状态
         fileControl.setCurrentImage(source)
+        // 当前图片优先加载
+        CodeImage.setCurrentImage(source)
+        // 远程路径(SMB/MTP/PTP)的相邻图片在后台暂存到本地
+        var sourceIndex = sourcePaths ? sourcePaths.indexOf(source) : -1
+        if (sourceIndex >= 0) {
+            CodeImage.prefetchImages(sourcePaths.slice(Math.max(0, sourceIndex - 2), sourceIndex + 3))
+        }
         CodeImage.setMultiFrameIndex(fileControl.isMultiImage(source) ? 0 : -1)
         // 复位图片旋转状态
         imageViewer.currentRotate = 0
@@ -577,9 +654,9 @@ Rectangle {
             }
 
             // normal image
-            Image {
+            // 仅绘制可见区域，放大查看大图时绘制耗时与缩放比例无关
+            TiledImageView {
                 id: showImg
-                fillMode: Image.PreserveAspectFit
                 width: parent.width
                 height: parent.height
                 source: {
@@ -594,12 +671,10 @@ Rectangle {
 
                 // NormalStaticImage 包含普通图片和多页图类型
                 visible: flickableL.curSourceIsNormalStaticImage && flickableL.curSourceIsExist
-                asynchronous: true
 
-                cache: false
                 clip: true
                 scale: imageScale
-                mipmap: true
+                // 仅影响缩小(低于 100%)时的采样，放大时始终最近邻采样以保持像素清晰
                 smooth: true
                 // 仅限普通图片进行旋转
                 rotation: currentRotate
@@ -664,16 +739,15 @@ Rectangle {
             }
 
             // dynamic image
-            AnimatedImage {
+            AnimatedImageView {
                 id: showAnimatedImg
 
-                fillMode: Image.PreserveAspectFit
                 width: parent.width
                 height: parent.height
                 source: flickableL.curSourceIsDynamicImage ? flickableL.curImageSource : ""
                 visible: flickableL.curSourceIsDynamicImage && flickableL.curSourceIsExist
-                asynchronous: true
-                cache: false
+                // 不可见时暂停播放，避免后台持续解码
+                playing: visible
                 clip: true
                 scale: imageScale
                 smooth: true
@@ -1273,7 +1347,7 @@ Rectangle {
         highlightMoveDuration: 0
         boundsMovement: Flickable.FollowBoundsBehavior
         boundsBehavior: Flickable.StopAtBounds
-        model: sourcePaths
+        model: sourcePathsModel
 
         cacheBuffer: 200
         delegate: Loader {
@@ -1364,7 +1438,7 @@ Rectangle {
         function liveTextAnalyze() {
             console.debug("Live Text analyze start")
             view.currentItem.grabToImage(function(result) { //截取当前控件显示
-                liveTextAnalyzer.setImage(result.image) //设置分析图片
+                liveTextAnalyzer.setImage(result.image, true) //设置分析图片，截取的屏幕图像不再缩小
                 liveTextAnalyzer.analyze(currentIndex) //执行分析（异步执行，函数会立即返回）
                 //result.saveToFile("/home/wzyforuos/Desktop/viewer.png") //保存截取的图片，debug用
             })
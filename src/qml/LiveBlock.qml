@@ -10,6 +10,7 @@ Rectangle {
     id: root
 
     property int index: 0
+    property string resultId: ""    //识别结果标识，与index组成区域图片的稳定标识
     property var charLocations: new Array
     property int startCharIndex: -1
     property int endCharIndex:   -1
@@ -74,7 +75,7 @@ Rectangle {
 
     Image {
         anchors.fill: parent
-        source : "image://liveTextAnalyzer/" + Math.random() + "_" + index
+        source : "image://liveTextAnalyzer/" + resultId + "_" + index
         fillMode: Image.Tile
     }
 
@@ -41,9 +41,11 @@ Item {
             blockArray.length = []
         }
 
+        var resultId = liveTextAnalyzer.resultId()
         for(var id = 0;id !== blocks.length;id++) {
             BlockLoader.createBlockObjects(root)
             var rectDetail = BlockLoader.block
+            rectDetail.resultId = resultId
             rectDetail.index = id
             rectDetail.width = blocks[id][2] - blocks[id][0]
             rectDetail.height = blocks[id][5] - blocks[id][3]
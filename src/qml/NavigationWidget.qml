@@ -32,8 +32,9 @@ Rectangle {
         // 取得原始图片调整后的大小
         var imgw = 0
         var imgh = 0
-        var ratio = idcurrentImg.sourceSize.width / idcurrentImg.sourceSize.height
-        if (idcurrentImg.sourceSize.width < idcurrentImg.sourceSize.height) {
+        // 加载的为缩小后的预览图片，使用实际加载的图片大小计算宽高比
+        var ratio = idcurrentImg.implicitWidth / idcurrentImg.implicitHeight
+        if (idcurrentImg.implicitWidth < idcurrentImg.implicitHeight) {
             imgw = ratio * idNavigationwidget.height
             imgh = idNavigationwidget.height
         } else {
@@ -86,15 +87,17 @@ Rectangle {
             width: parent.width
             height: parent.height
             asynchronous: true
+            // 仅请求导航窗口大小的预览图片
+            sourceSize: Qt.size(width * Screen.devicePixelRatio, height * Screen.devicePixelRatio)
 
-            // 多页图使用不同图像加载类
+            // 多页图需指定加载的图像帧号
             source: {
                 if (!visible) {
                     return ""
                 } else {
                     return imageViewer.currentIsMultiImage
-                            ? "image://multiimage/" + imageViewer.source + "#frame_" + imageViewer.frameIndex
-                            : "image://viewImage/" + imageViewer.source
+                            ? "image://navigationImage/" + imageViewer.source + "#frame_" + imageViewer.frameIndex
+                            : "image://navigationImage/" + imageViewer.source
                 }
             }
         }
@@ -38,6 +38,16 @@ Item {
         onOpenImageFile: {
             openwidget.openImageFile(fileName)
         }
+
+        // 图片文件夹中新增图片，按排序合并到当前图片列表，视图模型按差异插入新增的行
+        onImageFilesAdded: {
+            if (mainView.sourcePaths.length > 0) {
+                var curSource = mainView.source
+                mainView.sourcePaths = fileControl.insertImageFiles(mainView.sourcePaths, filePaths)
+                mainView.currentIndex = mainView.sourcePaths.indexOf(curSource)
+                mainView.setThumbnailCurrentIndex(mainView.currentIndex)
+            }
+        }
     }
 
     Rectangle{
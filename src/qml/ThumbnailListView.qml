@@ -279,6 +279,29 @@ Item {
             }
         }
 
+        // 通知后端当前可见的缩略图，可见缩略图优先加载
+        function updateVisibleThumbnails() {
+            if (count <= 0) {
+                CodeImage.setVisibleThumbnails([])
+                return
+            }
+
+            var first = indexAt(contentX, contentY + height / 2)
+            var last = indexAt(contentX + width - 1, contentY + height / 2)
+            // 边界处为表头表尾或间距时无对应索引
+            if (first < 0) {
+                first = 0
+            }
+            if (last < 0) {
+                last = count - 1
+            }
+            CodeImage.setVisibleThumbnails(mainView.sourcePaths.slice(first, last + 1))
+        }
+
+        onContentXChanged: updateVisibleThumbnails()
+        onWidthChanged: updateVisibleThumbnails()
+        onCountChanged: updateVisibleThumbnails()
+
         //滑动联动主视图
         onCurrentIndexChanged: {
             mainView.currentIndex = currentIndex
@@ -359,7 +382,7 @@ Item {
         orientation: Qt.Horizontal
 
         cacheBuffer: 200
-        model: mainView.sourcePaths.length
+        model: mainView.sourcePathsModel
         delegate: ListViewDelegate {
         }
 
@@ -0,0 +1,185 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "animatedimagedecoder.h"
+#include "unionimage/unionimage.h"
+
+#include <QMutexLocker>
+#include <QDebug>
+
+AnimatedImageDecoder::AnimatedImageDecoder(QObject *parent)
+    : QThread(parent)
+{
+}
+
+AnimatedImageDecoder::~AnimatedImageDecoder()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_quit = true;
+        m_condition.wakeAll();
+    }
+    wait();
+}
+
+void AnimatedImageDecoder::setFileName(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+    m_path = path;
+    m_pathChanged = true;
+    m_seekIndex = -1;
+    m_frameCount = 0;
+    m_size = QSize();
+    clearRing();
+    m_condition.wakeAll();
+}
+
+void AnimatedImageDecoder::setRingBytes(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxRingBytes = bytes;
+    m_condition.wakeAll();
+}
+
+bool AnimatedImageDecoder::takeFrame(Frame &frame)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_ring.isEmpty()) {
+        return false;
+    }
+
+    frame = m_ring.dequeue();
+    m_ringBytes -= frame.image.sizeInBytes();
+    // 缓冲区有空闲，唤醒解码线程
+    m_condition.wakeAll();
+    return true;
+}
+
+void AnimatedImageDecoder::seek(int index)
+{
+    QMutexLocker locker(&m_mutex);
+    m_seekIndex = qMax(0, index);
+    clearRing();
+    m_condition.wakeAll();
+}
+
+int AnimatedImageDecoder::frameCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_frameCount;
+}
+
+QSize AnimatedImageDecoder::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_size;
+}
+
+/**
+ * @brief 解码线程，打开文件、跳转及解码耗时操作均在锁外执行，
+ *      执行完成后若文件或跳转位置已变更，丢弃结果重新处理
+ */
+void AnimatedImageDecoder::run()
+{
+    LibUnionImage_NameSpace::UnionMovieImage movie;
+    int failedCount = 0;    // 连续解码失败的帧数
+
+    QMutexLocker locker(&m_mutex);
+    forever {
+        while (!m_quit && !m_pathChanged && m_seekIndex < 0 && (!movie.isValid() || ringIsFull())) {
+            m_condition.wait(&m_mutex);
+        }
+        if (m_quit) {
+            break;
+        }
+
+        if (m_pathChanged) {
+            m_pathChanged = false;
+            const QString path = m_path;
+            locker.unlock();
+
+            failedCount = 0;
+            bool ret = !path.isEmpty() && movie.setFileName(path);
+            if (!ret) {
+                // 释放之前打开的文件
+                movie.setFileName(QString());
+            }
+
+            locker.relock();
+            if (m_pathChanged) {
+                continue;
+            }
+            m_frameCount = movie.frameCount();
+            m_size = movie.size();
+            if (!path.isEmpty()) {
+                Q_EMIT opened(ret);
+            }
+            continue;
+        }
+
+        if (m_seekIndex >= 0) {
+            const int index = m_seekIndex;
+            m_seekIndex = -1;
+            locker.unlock();
+
+            movie.jumpToFrame(index);
+
+            locker.relock();
+            continue;
+        }
+
+        locker.unlock();
+
+        Frame frame;
+        frame.index = movie.currentIndex();
+        if (movie.frameCount() > 0 && frame.index >= movie.frameCount()) {
+            // 播放完成后从首帧循环
+            frame.index = 0;
+        }
+        frame.image = movie.next();
+        frame.delay = movie.frameDelay();
+
+        locker.relock();
+        if (frame.image.isNull()) {
+            // 文件损坏时所有帧均无法解码，停止解码防止空转
+            if (++failedCount > qMax(1, movie.frameCount())) {
+                qWarning() << "AnimatedImageDecoder: decode frames failed," << m_path;
+                movie.setFileName(QString());
+            }
+            continue;
+        }
+        failedCount = 0;
+
+        // 解码期间文件或跳转位置变更，丢弃此帧
+        if (m_pathChanged || m_seekIndex >= 0) {
+            continue;
+        }
+
+        const bool wasEmpty = m_ring.isEmpty();
+        m_ringBytes += frame.image.sizeInBytes();
+        m_ring.enqueue(frame);
+        if (wasEmpty) {
+            Q_EMIT frameReady();
+        }
+    }
+}
+
+/**
+ * @return 帧缓冲区是否已满，按字节数计算，至少保留 EMinRingFrames 帧
+ */
+bool AnimatedImageDecoder::ringIsFull() const
+{
+    if (m_ring.size() < EMinRingFrames) {
+        return false;
+    }
+
+    const qint64 frameBytes = qint64(m_size.width()) * m_size.height() * 4;
+    return m_ringBytes + frameBytes > m_maxRingBytes;
+}
+
+void AnimatedImageDecoder::clearRing()
+{
+    m_ring.clear();
+    m_ringBytes = 0;
+}
@@ -0,0 +1,81 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef ANIMATEDIMAGEDECODER_H
+#define ANIMATEDIMAGEDECODER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QImage>
+
+/**
+ * @brief 动图后台解码线程
+ *      通过 UnionMovieImage 在工作线程中提前解码后续帧，存入按字节数限制大小的环形帧缓冲区，
+ *      展示端通过 takeFrame() 取出帧后唤醒解码线程继续解码。
+ *      仅保留有限的后续帧，长动图( 1080P 数千帧)播放时内存占用固定。
+ */
+class AnimatedImageDecoder : public QThread
+{
+    Q_OBJECT
+public:
+    enum Constant {
+        EDefaultRingBytes = 64 * 1024 * 1024,   // 帧缓冲区默认 64MB
+        EMinRingFrames = 2,                     // 帧缓冲区最少缓存 2 帧，防止超大图片无法播放
+    };
+
+    // 解码完成的帧
+    struct Frame {
+        QImage  image;
+        int     index = -1;     // 帧号
+        int     delay = 0;      // 展示时长，单位 ms
+    };
+
+    explicit AnimatedImageDecoder(QObject *parent = nullptr);
+    ~AnimatedImageDecoder() override;
+
+    // 设置解码的动图文件，传入空路径时停止解码并清空缓存
+    void setFileName(const QString &path);
+    // 设置帧缓冲区的最大字节数
+    void setRingBytes(qint64 bytes);
+
+    // 取出帧缓冲区中的下一帧，无可用帧时返回 false
+    bool takeFrame(Frame &frame);
+    // 跳转到帧 index ，之前缓存的帧将被丢弃
+    void seek(int index);
+
+    int frameCount() const;
+    QSize size() const;
+
+Q_SIGNALS:
+    // 动图文件打开完成，可获取帧数及图片大小
+    void opened(bool success);
+    // 帧缓冲区由空变为非空
+    void frameReady();
+
+protected:
+    void run() override;
+
+private:
+    bool ringIsFull() const;
+    void clearRing();
+
+private:
+    mutable QMutex      m_mutex;
+    QWaitCondition      m_condition;
+    QQueue<Frame>       m_ring;                                 // 环形帧缓冲区
+    qint64              m_ringBytes = 0;                        // 帧缓冲区已使用的字节数
+    qint64              m_maxRingBytes = EDefaultRingBytes;     // 帧缓冲区最大字节数
+
+    QString             m_path;                                 // 动图文件路径
+    bool                m_pathChanged = false;                  // 文件路径变更，需重新打开
+    int                 m_seekIndex = -1;                       // 待跳转的帧号
+    bool                m_quit = false;                         // 退出线程
+
+    int                 m_frameCount = 0;
+    QSize               m_size;
+};
+
+#endif // ANIMATEDIMAGEDECODER_H
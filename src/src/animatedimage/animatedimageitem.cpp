@@ -0,0 +1,256 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "animatedimageitem.h"
+
+#include <QQuickWindow>
+#include <QSGSimpleTextureNode>
+
+AnimatedImageItem::AnimatedImageItem(QQuickItem *parent)
+    : QQuickItem(parent)
+    , m_decoder(new AnimatedImageDecoder(this))
+{
+    setFlag(ItemHasContents, true);
+
+    m_frameTimer.setSingleShot(true);
+    m_frameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_frameTimer, &QTimer::timeout, this, &AnimatedImageItem::showNextFrame);
+
+    // 解码线程信号通过队列连接在 GUI 线程处理
+    connect(m_decoder, &AnimatedImageDecoder::opened, this, &AnimatedImageItem::onOpened, Qt::QueuedConnection);
+    connect(m_decoder, &AnimatedImageDecoder::frameReady, this, &AnimatedImageItem::onFrameReady, Qt::QueuedConnection);
+    m_decoder->start();
+}
+
+AnimatedImageItem::~AnimatedImageItem()
+{
+}
+
+QUrl AnimatedImageItem::source() const
+{
+    return m_source;
+}
+
+/**
+ * @brief 设置动图文件 \a source ，之前的帧缓存将被清空
+ */
+void AnimatedImageItem::setSource(const QUrl &source)
+{
+    if (m_source == source) {
+        return;
+    }
+
+    m_source = source;
+    m_frameTimer.stop();
+    m_currentImage = QImage();
+    m_imageChanged = true;
+    m_currentFrame = 0;
+    m_frameCount = 0;
+    m_sourceSize = QSize();
+
+    const QString path = source.isLocalFile() ? source.toLocalFile() : source.toString();
+    m_decoder->setFileName(path);
+    m_waitingFrame = !path.isEmpty();
+    setStatus(path.isEmpty() ? Null : Loading);
+
+    Q_EMIT sourceChanged();
+    Q_EMIT currentFrameChanged();
+    Q_EMIT frameCountChanged();
+    Q_EMIT sourceSizeChanged();
+    Q_EMIT paintedGeometryChanged();
+    update();
+}
+
+bool AnimatedImageItem::isPlaying() const
+{
+    return m_playing;
+}
+
+void AnimatedImageItem::setPlaying(bool playing)
+{
+    if (m_playing == playing) {
+        return;
+    }
+
+    m_playing = playing;
+    if (m_playing) {
+        // 继续播放时，当前帧重新计时
+        m_clock.start();
+        m_nextFrameTime = m_currentDelay;
+        if (!m_waitingFrame && !m_currentImage.isNull()) {
+            m_frameTimer.start(m_currentDelay);
+        }
+    } else {
+        m_frameTimer.stop();
+    }
+
+    Q_EMIT playingChanged();
+}
+
+int AnimatedImageItem::currentFrame() const
+{
+    return m_currentFrame;
+}
+
+/**
+ * @brief 跳转到帧 \a index ，解码完成后展示
+ */
+void AnimatedImageItem::setCurrentFrame(int index)
+{
+    if (index == m_currentFrame || index < 0 || (m_frameCount > 0 && index >= m_frameCount)) {
+        return;
+    }
+
+    m_frameTimer.stop();
+    m_decoder->seek(index);
+    m_waitingFrame = true;
+}
+
+int AnimatedImageItem::frameCount() const
+{
+    return m_frameCount;
+}
+
+AnimatedImageItem::Status AnimatedImageItem::status() const
+{
+    return m_status;
+}
+
+QSize AnimatedImageItem::sourceSize() const
+{
+    return m_sourceSize;
+}
+
+qreal AnimatedImageItem::paintedWidth() const
+{
+    return paintedRect().width();
+}
+
+qreal AnimatedImageItem::paintedHeight() const
+{
+    return paintedRect().height();
+}
+
+QSGNode *AnimatedImageItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data)
+{
+    Q_UNUSED(data)
+    QSGSimpleTextureNode *node = static_cast<QSGSimpleTextureNode *>(oldNode);
+    if (m_currentImage.isNull() || !window()) {
+        delete node;
+        return nullptr;
+    }
+
+    if (!node) {
+        node = new QSGSimpleTextureNode;
+        node->setOwnsTexture(true);
+        m_imageChanged = true;
+    }
+
+    if (m_imageChanged) {
+        // 节点仅在析构时释放纹理，替换纹理时需手动释放之前的纹理
+        QSGTexture *oldTexture = node->texture();
+        node->setTexture(window()->createTextureFromImage(m_currentImage));
+        delete oldTexture;
+        m_imageChanged = false;
+    }
+
+    node->setRect(paintedRect());
+    node->setFiltering(smooth() ? QSGTexture::Linear : QSGTexture::Nearest);
+    return node;
+}
+
+void AnimatedImageItem::geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChanged(newGeometry, oldGeometry);
+    if (newGeometry.size() != oldGeometry.size()) {
+        Q_EMIT paintedGeometryChanged();
+        update();
+    }
+}
+
+void AnimatedImageItem::setStatus(Status status)
+{
+    if (m_status != status) {
+        m_status = status;
+        Q_EMIT statusChanged();
+    }
+}
+
+void AnimatedImageItem::onOpened(bool success)
+{
+    if (!success) {
+        m_waitingFrame = false;
+        setStatus(Error);
+        return;
+    }
+
+    m_frameCount = m_decoder->frameCount();
+    m_sourceSize = m_decoder->size();
+    Q_EMIT frameCountChanged();
+    Q_EMIT sourceSizeChanged();
+    Q_EMIT paintedGeometryChanged();
+}
+
+void AnimatedImageItem::onFrameReady()
+{
+    if (m_waitingFrame) {
+        m_waitingFrame = false;
+        showNextFrame();
+    }
+}
+
+/**
+ * @brief 展示帧缓冲区中的下一帧，并按帧展示时长设置下一帧的展示时间。
+ *      解码速度不足时等待 frameReady() 信号，延迟过多时重新计时，不追赶丢失的时间。
+ */
+void AnimatedImageItem::showNextFrame()
+{
+    AnimatedImageDecoder::Frame frame;
+    if (!m_decoder->takeFrame(frame)) {
+        m_waitingFrame = true;
+        return;
+    }
+
+    const bool firstFrame = m_currentImage.isNull();
+    m_currentImage = frame.image;
+    m_currentDelay = frame.delay;
+    m_imageChanged = true;
+    update();
+
+    if (m_currentFrame != frame.index) {
+        m_currentFrame = frame.index;
+        Q_EMIT currentFrameChanged();
+    }
+
+    if (firstFrame) {
+        m_clock.start();
+        m_nextFrameTime = 0;
+        setStatus(Ready);
+    }
+
+    // 单帧图片无需继续播放
+    if (!m_playing || 1 == m_frameCount) {
+        return;
+    }
+
+    const qint64 now = m_clock.elapsed();
+    m_nextFrameTime += frame.delay;
+    if (m_nextFrameTime < now) {
+        m_nextFrameTime = now + frame.delay;
+    }
+    m_frameTimer.start(static_cast<int>(m_nextFrameTime - now));
+}
+
+/**
+ * @return 按 PreserveAspectFit 方式计算的图片展示区域
+ */
+QRectF AnimatedImageItem::paintedRect() const
+{
+    if (m_sourceSize.isEmpty() || width() <= 0 || height() <= 0) {
+        return QRectF();
+    }
+
+    QSizeF paintedSize = QSizeF(m_sourceSize).scaled(size(), Qt::KeepAspectRatio);
+    return QRectF(QPointF((width() - paintedSize.width()) / 2, (height() - paintedSize.height()) / 2), paintedSize);
+}
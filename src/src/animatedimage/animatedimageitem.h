@@ -0,0 +1,102 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef ANIMATEDIMAGEITEM_H
+#define ANIMATEDIMAGEITEM_H
+
+#include "animatedimagedecoder.h"
+
+#include <QQuickItem>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QUrl>
+
+/**
+ * @brief 动图展示组件，替代 QML 的 AnimatedImage
+ *      AnimatedImage 在 GUI 线程中解码并缓存全部帧，大尺寸长动图会占用大量内存。
+ *      此组件通过 AnimatedImageDecoder 在后台线程解码，仅缓存有限的后续帧，
+ *      按各帧的展示时长计算绝对展示时间，避免定时器误差累积。
+ *      图片按 PreserveAspectFit 方式居中展示。
+ *      在 QML 中注册为 AnimatedImageView
+ */
+class AnimatedImageItem : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QUrl source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(bool playing READ isPlaying WRITE setPlaying NOTIFY playingChanged)
+    Q_PROPERTY(int currentFrame READ currentFrame WRITE setCurrentFrame NOTIFY currentFrameChanged)
+    Q_PROPERTY(int frameCount READ frameCount NOTIFY frameCountChanged)
+    Q_PROPERTY(Status status READ status NOTIFY statusChanged)
+    Q_PROPERTY(QSize sourceSize READ sourceSize NOTIFY sourceSizeChanged)
+    Q_PROPERTY(qreal paintedWidth READ paintedWidth NOTIFY paintedGeometryChanged)
+    Q_PROPERTY(qreal paintedHeight READ paintedHeight NOTIFY paintedGeometryChanged)
+
+public:
+    // 和 QML Image.status 取值保持一致
+    enum Status {
+        Null,
+        Ready,
+        Loading,
+        Error
+    };
+    Q_ENUM(Status)
+
+    explicit AnimatedImageItem(QQuickItem *parent = nullptr);
+    ~AnimatedImageItem() override;
+
+    QUrl source() const;
+    void setSource(const QUrl &source);
+
+    bool isPlaying() const;
+    void setPlaying(bool playing);
+
+    int currentFrame() const;
+    void setCurrentFrame(int index);
+
+    int frameCount() const;
+    Status status() const;
+    QSize sourceSize() const;
+    qreal paintedWidth() const;
+    qreal paintedHeight() const;
+
+Q_SIGNALS:
+    void sourceChanged();
+    void playingChanged();
+    void currentFrameChanged();
+    void frameCountChanged();
+    void statusChanged();
+    void sourceSizeChanged();
+    void paintedGeometryChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+    void geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+
+private:
+    void setStatus(Status status);
+    void onOpened(bool success);
+    void onFrameReady();
+    void showNextFrame();
+    QRectF paintedRect() const;
+
+private:
+    AnimatedImageDecoder    *m_decoder = nullptr;   // 后台解码线程
+    QTimer                  m_frameTimer;           // 下一帧展示定时器
+    QElapsedTimer           m_clock;                // 播放时钟
+    qint64                  m_nextFrameTime = 0;    // 下一帧的展示时间(基于播放时钟)
+
+    QUrl                    m_source;
+    bool                    m_playing = true;
+    bool                    m_waitingFrame = false; // 帧缓冲区为空，等待解码完成
+    Status                  m_status = Null;
+    QSize                   m_sourceSize;
+    int                     m_frameCount = 0;
+
+    QImage                  m_currentImage;         // 当前展示的帧
+    int                     m_currentFrame = 0;
+    int                     m_currentDelay = 0;
+    bool                    m_imageChanged = false; // 需要重新上传纹理
+};
+
+#endif // ANIMATEDIMAGEITEM_H
@@ -5,16 +5,22 @@
 #include "filecontrol.h"
 #include "unionimage/unionimage_global.h"
 #include "unionimage/unionimage.h"
+#include "unionimage/batchfilereader.h"
 #include "printdialog/printhelper.h"
 #include "ocr/ocrinterface.h"
+#include "utils/imagedirwatcher.h"
 
 #include <DSysInfo>
 
 #include <QFileInfo>
 #include <QDir>
+#include <QStandardPaths>
 #include <QMimeDatabase>
 #include <QCollator>
+#include <QSet>
 #include <QUrl>
+#include <QFutureWatcher>
+#include <QtConcurrent>
 #include <QDBusInterface>
 #include <QThread>
 #include <QProcess>
@@ -40,6 +46,8 @@ const QString SETTINGS_WINSIZE_W_KEY = "WindowWidth";
 const QString SETTINGS_WINSIZE_H_KEY = "WindowHeight";
 // 是否显示导航窗口
 const QString SETTINGS_ENABLE_NAVIGATION = "EnableNavigation";
+// RAW 图片解码结果的磁盘缓存大小上限(MB)，默认为 0 不启用
+const QString SETTINGS_RAW_CACHE_SIZE_MB = "RawCacheSizeMB";
 const int MAINWIDGET_MINIMUN_HEIGHT = 300;
 const int MAINWIDGET_MINIMUN_WIDTH = 628;
 
@@ -50,6 +58,30 @@ bool compareByFileInfo(const QFileInfo &str1, const QFileInfo &str2)
     return sortCollator.compare(str1.baseName(), str2.baseName()) < 0;
 }
 
+// 通过内容判断文件类型时读取的文件头长度，与 QMimeDatabase 读取的长度一致
+const int MIME_PROBE_SIZE = 16 * 1024;
+
+static bool isImageMimeType(const QMimeType &mt)
+{
+    return mt.name().startsWith("image/") || mt.name().startsWith("video/x-mng");
+}
+
+/**
+ * @brief 按文件内容判断 \a files 中的图片文件，读取文件头，在后台线程中调用
+ * @return 内容为图片的文件
+ */
+static QStringList filterImageFilesByContent(const QStringList &files)
+{
+    QStringList images;
+    QMimeDatabase db;
+    for (const QString &file : files) {
+        if (isImageMimeType(db.mimeTypeForFile(file, QMimeDatabase::MatchContent))) {
+            images << file;
+        }
+    }
+    return images;
+}
+
 //转换路径
 QUrl UrlInfo(QString path)
 {
@@ -87,9 +119,15 @@ FileControl::FileControl(QObject *parent) : QObject(parent)
     m_shortcutViewProcess = new QProcess(this);
 
     m_config = LibConfigSetter::instance();
-    m_pFileWathcer = new QFileSystemWatcher(this);
-    connect(m_pFileWathcer, &QFileSystemWatcher::fileChanged, this, &FileControl::onImageFileChanged);
-    connect(m_pFileWathcer, &QFileSystemWatcher::directoryChanged, this, &FileControl::onImageDirChanged);
+    // RAW 图片插件的磁盘缓存由宿主程序启用，需在读取图片前设置缓存目录及大小上限
+    const int rawCacheSizeMB = getConfigValue(SETTINGS_GROUP, SETTINGS_RAW_CACHE_SIZE_MB, 0).toInt();
+    if (rawCacheSizeMB > 0) {
+        qApp->setProperty("rawCacheDirectory", QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/raw");
+        qApp->setProperty("rawCacheSizeMB", rawCacheSizeMB);
+    }
+    m_pDirWatcher = new ImageDirWatcher(this);
+    connect(m_pDirWatcher, &ImageDirWatcher::filesChanged, this, &FileControl::onImageDirFilesChanged);
+    connect(m_pDirWatcher, &ImageDirWatcher::directoryInvalidated, this, &FileControl::onImageDirInvalidated);
 
     // 实时保存旋转后图片太卡，因此采用10ms后延时保存的问题
     if (!m_tSaveImage) {
@@ -138,14 +176,36 @@ QStringList FileControl::getDirImagePath(const QString &path)
 
     //修复Ｑt带后缀排序错误的问题
     std::sort(m_AllPath.begin(), m_AllPath.end(), compareByFileInfo);
+
+    //判断是否图片格式，与 isImage() 一致，后缀可判断为图片的文件无需读取，
+    //其余文件的文件头通过 BatchFileReader 批量读取后按内容判断，不再逐个阻塞打开读取
+    QMimeDatabase db;
+    QVector<bool> isImageFile(m_AllPath.size(), false);
+    QStringList probePaths;
+    QVector<int> probeIndexes;
     for (int i = 0; i < m_AllPath.size(); i++) {
         QString tmpPath = m_AllPath.at(i).filePath();
         if (tmpPath.isEmpty()) {
             continue;
         }
-        //判断是否图片格式
-        if (isImage(tmpPath)) {
-            image_list << QUrl::fromLocalFile(tmpPath).toString();
+        if (isImageMimeType(db.mimeTypeForFile(tmpPath, QMimeDatabase::MatchExtension))) {
+            isImageFile[i] = true;
+        } else {
+            probePaths << tmpPath;
+            probeIndexes << i;
+        }
+    }
+
+    const auto headers = LibUnionImage_NameSpace::BatchFileReader::readFiles(probePaths, MIME_PROBE_SIZE);
+    for (int i = 0; i < headers.size(); i++) {
+        if (0 == headers.at(i).error && isImageMimeType(db.mimeTypeForData(headers.at(i).data))) {
+            isImageFile[probeIndexes.at(i)] = true;
+        }
+    }
+
+    for (int i = 0; i < m_AllPath.size(); i++) {
+        if (isImageFile.at(i)) {
+            image_list << QUrl::fromLocalFile(m_AllPath.at(i).filePath()).toString();
         }
     }
     return image_list;
@@ -158,6 +218,31 @@ QStringList FileControl::removeList(const QStringList &pathlist, int index)
     return list;
 }
 
+/**
+ * @brief 将新增的图片 \a newPaths 合并到图片列表 \a pathlist 中，
+ *      排序方式和 getDirImagePath() 一致，已存在的图片不会重复添加。
+ * @note \a pathlist 已排序，新增图片通过二分查找插入，不再重新排序整个列表
+ * @return 合并后的图片列表
+ */
+QStringList FileControl::insertImageFiles(const QStringList &pathlist, const QStringList &newPaths)
+{
+    QSet<QString> existPaths = pathlist.toSet();
+    QStringList list = pathlist;
+    for (const QString &path : newPaths) {
+        if (existPaths.contains(path)) {
+            continue;
+        }
+        existPaths.insert(path);
+
+        const QFileInfo info(QUrl(path).toLocalFile());
+        auto itr = std::upper_bound(list.begin(), list.end(), info, [](const QFileInfo & newInfo, const QString & exist) {
+            return compareByFileInfo(newInfo, QFileInfo(QUrl(exist).toLocalFile()));
+        });
+        list.insert(itr, path);
+    }
+    return list;
+}
+
 QStringList FileControl::renameOne(const QStringList &pathlist, const  QString &oldPath, const QString &newPath)
 {
     QStringList list = pathlist;
@@ -193,8 +278,7 @@ bool FileControl::isImage(const QString &path)
     QMimeDatabase db;
     QMimeType mt = db.mimeTypeForFile(path, QMimeDatabase::MatchContent);
     QMimeType mt1 = db.mimeTypeForFile(path, QMimeDatabase::MatchExtension);
-    if (mt.name().startsWith("image/") || mt.name().startsWith("video/x-mng") ||
-            mt1.name().startsWith("image/") || mt1.name().startsWith("video/x-mng")) {
+    if (isImageMimeType(mt) || isImageMimeType(mt1)) {
         bRet = true;
     }
     return bRet;
@@ -437,12 +521,10 @@ void FileControl::ocrImage(const QString &path, int index)
     if (!isMultiImage(path)) { //非多页图使用路径直接进行识别
         QString localPath = QUrl(path).toLocalFile();
         m_ocrInterface->openFile(localPath);
-    } else { //多页图需要确定识别哪一页
+    } else { //多页图需要确定识别哪一页，通过共享内存直接传递解码后的图片，无需写入临时文件
         m_currentReader->jumpToImage(index);
         auto image = m_currentReader->read();
-        auto tempFileName = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation) + QDir::separator() + "rec.png";
-        image.save(tempFileName);
-        m_ocrInterface->openFile(tempFileName);
+        m_ocrInterface->openImageShared(image, QFileInfo(QUrl(path).toLocalFile()).fileName());
     }
 }
 
@@ -969,15 +1051,16 @@ int FileControl::getImageCount(const QString &path)
 /**
  * @brief 根据传入的文件路径列表 \a filePaths 重设缓存的文件信息，记录每个文件的最后修改时间，
  *      若在图片打开过程中文件被修改，将发送信号至界面或其它处理。
+ * @note 仅观察图片所在的文件夹，不再单独观察每个文件，避免超出系统 inotify 观察数量限制
  */
 void FileControl::resetImageFiles(const QStringList &filePaths)
 {
     // 清空缓存的文件路径信息
     m_cacheFileInfo.clear();
     m_removedFile.clear();
-    m_pFileWathcer->removePaths(m_pFileWathcer->files());
-    m_pFileWathcer->removePaths(m_pFileWathcer->directories());
+    m_pDirWatcher->clear();
 
+    QString dirPath;
     for (const QString &filePath : filePaths) {
         QString tempPath = QUrl(filePath).toLocalFile();
         QFileInfo info(tempPath);
@@ -985,16 +1068,16 @@ void FileControl::resetImageFiles(const QStringList &filePaths)
         if (info.exists()) {
             // 记录文件的最后修改时间
             m_cacheFileInfo.insert(tempPath, filePath);
-            // 将文件追加到记录中
-            m_pFileWathcer->addPath(tempPath);
+
+            if (dirPath.isEmpty()) {
+                dirPath = info.absolutePath();
+            }
         }
     }
 
-    QStringList fileList = m_pFileWathcer->files();
-    if (!fileList.isEmpty()) {
+    if (!dirPath.isEmpty()) {
         // 观察文件夹变更
-        QFileInfo info(fileList.first());
-        m_pFileWathcer->addPath(info.absolutePath());
+        m_pDirWatcher->setDirectory(dirPath);
     }
 }
 
@@ -1009,8 +1092,8 @@ QUrl FileControl::getCompanyLogo()
 
 /**
  * @brief 当文件 \a file 被移动、替换、删除时触发
- * @note QFileSystemWatcher 会在文件被移动、删除后取消观察，恢复文件时需要通过
- *      onImageDirChanged() 复位观察状态。
+ * @note 由 onImageDirFilesChanged() 根据文件夹增量信息调用，被移除的文件记录在
+ *      m_removedFile 中，文件恢复时再次触发。
  */
 void FileControl::onImageFileChanged(const QString &file)
 {
@@ -1036,28 +1119,114 @@ void FileControl::onImageFileChanged(const QString &file)
 }
 
 /**
- * @brief 当图片文件夹 \a dir 变更时触发，主要用于恢复已被删除图片的状态。
+ * @brief 当图片文件夹变更时触发，\a added \a removed \a modified 为合并后的新增、移除、修改文件。
+ *      根据增量信息更新缓存的文件信息，不再重新遍历整个文件夹。
  */
-void FileControl::onImageDirChanged(const QString &dir)
-{
-    // 文件夹变更，判断是否存在新增已移除的文件
-    QDir imageDir(dir);
-    QStringList dirFiles = imageDir.entryList();
-
-    for (auto itr = m_removedFile.begin(); itr != m_removedFile.end();) {
-        QFileInfo info(itr.key());
-        if (dirFiles.contains(info.fileName())) {
-            // 重新追加到文件观察中
-            m_pFileWathcer->addPath(itr.key());
-            // 文件恢复或替换，发布文件变更信息
-            onImageFileChanged(itr.key());
-
-            // 从缓存信息中移除
-            itr = m_removedFile.erase(itr);
+void FileControl::onImageDirFilesChanged(const QStringList &added, const QStringList &removed, const QStringList &modified)
+{
+    for (const QString &file : removed) {
+        if (file == fileRenamed) {
+            // 重命名的文件不提示变更，新文件名通过新增文件处理
+            fileRenamed.clear();
+            m_cacheFileInfo.remove(file);
+            continue;
+        }
+
+        if (m_cacheFileInfo.contains(file) && !m_removedFile.contains(file)) {
+            // 文件移动或删除，缓存记录
+            m_removedFile.insert(file, m_cacheFileInfo.value(file));
+            onImageFileChanged(file);
+        }
+    }
+
+    QMimeDatabase db;
+    QStringList newImages;
+    QStringList probeFiles;
+    for (const QString &file : added + modified) {
+        if (m_removedFile.contains(file)) {
+            // 文件恢复，从缓存信息中移除并发布文件变更信息
+            m_removedFile.remove(file);
+            onImageFileChanged(file);
+        } else if (m_cacheFileInfo.contains(file)) {
+            // 文件替换或内容修改
+            onImageFileChanged(file);
+        } else if (isImageMimeType(db.mimeTypeForFile(file, QMimeDatabase::MatchExtension))) {
+            // 后缀可判断为图片的新增文件，无需读取文件内容
+            newImages << file;
         } else {
-            ++itr;
+            probeFiles << file;
+        }
+    }
+
+    appendImageFiles(newImages);
+
+    if (!probeFiles.isEmpty()) {
+        // 其余文件需读取文件头按内容判断，放到后台线程处理，避免阻塞界面线程
+        auto watcher = new QFutureWatcher<QStringList>(this);
+        connect(watcher, &QFutureWatcher<QStringList>::finished, this, [this, watcher]() {
+            watcher->deleteLater();
+            appendImageFiles(watcher->result());
+        });
+        watcher->setFuture(QtConcurrent::run(filterImageFilesByContent, probeFiles));
+    }
+}
+
+/**
+ * @brief 将新增的图片文件 \a files 记录到缓存信息中，并发送 imageFilesAdded() 信号。
+ * @note 内容判断在后台线程完成，期间可能已切换图片文件夹或其它途径已记录，需跳过这些文件。
+ */
+void FileControl::appendImageFiles(const QStringList &files)
+{
+    const QString dir = m_pDirWatcher->directory();
+    QStringList urls;
+    for (const QString &file : files) {
+        if (m_cacheFileInfo.contains(file) || QFileInfo(file).absolutePath() != dir) {
+            continue;
+        }
+
+        QString url = QUrl::fromLocalFile(file).toString();
+        m_cacheFileInfo.insert(file, url);
+        urls << url;
+    }
+
+    if (!urls.isEmpty()) {
+        emit imageFilesAdded(urls);
+    }
+}
+
+/**
+ * @brief 文件夹观察失效时(inotify 事件队列溢出、文件夹被移动删除等)，
+ *      无法取得增量信息，重新遍历文件夹 \a dir 比较缓存的文件信息。
+ */
+void FileControl::onImageDirInvalidated(const QString &dir)
+{
+    QStringList added;
+    QStringList removed;
+
+    for (auto itr = m_cacheFileInfo.begin(); itr != m_cacheFileInfo.end(); ++itr) {
+        bool isExist = QFile::exists(itr.key());
+        if (!isExist && !m_removedFile.contains(itr.key())) {
+            removed << itr.key();
+        } else if (isExist && m_removedFile.contains(itr.key())) {
+            added << itr.key();
         }
     }
+
+    // 重新观察文件夹，文件夹不存在时将失败。文件夹被移动时原观察描述符仍然有效，
+    // 需先清除观察，否则 setDirectory() 判断为同一文件夹直接返回，继续以旧路径上报文件
+    m_pDirWatcher->clear();
+    if (m_pDirWatcher->setDirectory(dir)) {
+        QDir imageDir(dir);
+        const QStringList dirFiles = imageDir.entryList(QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot);
+        for (const QString &fileName : dirFiles) {
+            QString filePath = imageDir.absoluteFilePath(fileName);
+            if (!m_cacheFileInfo.contains(filePath)) {
+                added << filePath;
+            }
+        }
+    }
+
+    onImageDirFilesChanged(added, removed, QStringList());
 }
 
 void FileControl::terminateShortcutPanelProcess()
@@ -13,10 +13,10 @@
 #include <QImage>
 #include <QImageReader>
 #include <QMap>
-#include <QFileSystemWatcher>
 
 class OcrInterface;
 class QProcess;
+class ImageDirWatcher;
 
 class FileControl : public QObject
 {
@@ -34,6 +34,9 @@ public:
     //公共接口，删除list中的某项
     Q_INVOKABLE QStringList removeList(const QStringList &pathlist, int index);
 
+    //公共接口，将新增的图片按文件名排序插入list
+    Q_INVOKABLE QStringList insertImageFiles(const QStringList &pathlist, const QStringList &newPaths);
+
     //是否是图片
     Q_INVOKABLE bool isImage(const QString &path);
 
@@ -193,12 +196,18 @@ signals:
     void requestImageFileChanged(const QString &filePath, bool isMultiImage = false, bool isExist = false);
     // 缓存更新处理完成后，更新文件变更信号（被移动、替换、删除等）
     void imageFileChanged(const QString &filePath, bool isMultiImage = false, bool isExist = false);
+    // 图片文件夹中新增图片文件，filePaths 为url路径
+    void imageFilesAdded(const QStringList &filePaths);
 
 private:
     // 当处理的图片文件被移动、替换、删除时触发
     void onImageFileChanged(const QString &file);
-    // 当处理的图片文件夹变更(新增图片等)
-    void onImageDirChanged(const QString &dir);
+    // 当处理的图片文件夹变更(新增、移除、修改图片)，接收合并后的增量信息
+    void onImageDirFilesChanged(const QStringList &added, const QStringList &removed, const QStringList &modified);
+    // 文件夹观察失效(事件溢出、文件夹被移动等)，重新遍历文件夹
+    void onImageDirInvalidated(const QString &dir);
+    // 记录新增的图片文件并通知界面
+    void appendImageFiles(const QStringList &files);
     // 生成用于快捷键面板的字符串
     QString createShortcutString();
 
@@ -231,8 +240,8 @@ private :
     QStringList listsupportWallPaper;
 
     QHash<QString, QString>     m_cacheFileInfo;    // 缓存的图片信息，用于判断图片信息是否变更 QHash<完整路径, url信息>
-    QHash<QString, QString>     m_removedFile;      // 缓存被移除的文件信息(FileWatcher在文件删除/移动后将不会继续观察)
-    QFileSystemWatcher          *m_pFileWathcer;    // 文件观察类，用于提示文件变更
+    QHash<QString, QString>     m_removedFile;      // 缓存被移除的文件信息，文件恢复时重新提示变更
+    ImageDirWatcher             *m_pDirWatcher;     // 文件夹观察类，用于提示文件变更
     QString fileRenamed;                            // 文件重命名缓存，用于阻止文件变更操作
 };
 
@@ -0,0 +1,112 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "asyncimageprovider.h"
+
+#include <QDir>
+#include <QMetaObject>
+#include <QUrl>
+
+AsyncImageResponse::AsyncImageResponse(QQuickImageProvider *provider, ImageLoadPool::JobType type, const QString &path,
+                                       const QString &id, const QSize &requestedSize)
+{
+    // 对象在 finished() 发送后才会被释放，任务执行期间可安全访问
+    QMutexLocker _locker(&m_mutex);
+    m_jobId = ImageLoadPool::instance()->start(type, path, [this, provider, id, requestedSize]() {
+        load(provider, id, requestedSize);
+    });
+}
+
+QQuickTextureFactory *AsyncImageResponse::textureFactory() const
+{
+    QMutexLocker _locker(&m_mutex);
+    return QQuickTextureFactory::textureFactoryForImage(m_image);
+}
+
+QString AsyncImageResponse::errorString() const
+{
+    QMutexLocker _locker(&m_mutex);
+    return m_error;
+}
+
+/**
+ * @brief 取消请求，任务尚未执行时移出队列并通知完成，已在执行时由任务完成后通知
+ */
+void AsyncImageResponse::cancel()
+{
+    QMutexLocker _locker(&m_mutex);
+    if (m_canceled) {
+        return;
+    }
+    m_canceled = true;
+    m_error = QStringLiteral("Image request canceled");
+
+    if (ImageLoadPool::instance()->cancel(m_jobId)) {
+        QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief 在工作线程调用图片提供者加载图片，完成后在对象所在线程发送 finished()
+ */
+void AsyncImageResponse::load(QQuickImageProvider *provider, const QString &id, const QSize &requestedSize)
+{
+    QImage image;
+    bool canceled = false;
+    {
+        QMutexLocker _locker(&m_mutex);
+        canceled = m_canceled;
+    }
+
+    if (!canceled) {
+        QSize size;
+        image = provider->requestImage(id, &size, requestedSize);
+    }
+
+    QMutexLocker _locker(&m_mutex);
+    if (!m_canceled) {
+        m_image = image;
+        if (image.isNull()) {
+            m_error = QStringLiteral("Failed to load image: %1").arg(id);
+        }
+    }
+    QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+}
+
+AsyncImageProvider::AsyncImageProvider(QQuickImageProvider *provider, ImageLoadPool::JobType type)
+    : m_provider(provider)
+    , m_type(type)
+{
+}
+
+AsyncImageProvider::~AsyncImageProvider()
+{
+    delete m_provider;
+}
+
+/**
+ * @brief 创建异步请求，根据 \a id 解析文件路径和任务类型，用于计算加载优先级
+ */
+QQuickImageResponse *AsyncImageProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
+{
+    static const QString s_tagFrame = "#frame_";
+    static const QString s_tagThumbnail = "_thumbnail";
+
+    ImageLoadPool::JobType type = m_type;
+    if (id.endsWith(s_tagThumbnail)) {
+        type = ImageLoadPool::EThumbnail;
+    }
+
+    QString path = id;
+    int index = path.lastIndexOf(s_tagFrame);
+    if (-1 != index) {
+        path = path.left(index);
+    }
+    // 非文件路径的请求(如 OCR 文本区域截图)基于当前图片，按当前图片处理
+    if (!QUrl(path).isLocalFile() && !QDir::isAbsolutePath(path)) {
+        path.clear();
+    }
+
+    return new AsyncImageResponse(m_provider, type, path, id, requestedSize);
+}
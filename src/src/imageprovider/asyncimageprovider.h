@@ -0,0 +1,62 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef ASYNCIMAGEPROVIDER_H
+#define ASYNCIMAGEPROVIDER_H
+
+#include "imageloadpool.h"
+
+#include <QImage>
+#include <QMutex>
+#include <QQuickImageProvider>
+
+/**
+ * @brief 异步图片请求，在 ImageLoadPool 中调用同步图片提供者加载图片
+ *      cancel() 时若任务尚未执行则直接移出等待队列，已开始执行的任务完成后丢弃结果。
+ *      无论是否取消，finished() 均只发送一次，QML 引擎在接收后释放此对象。
+ */
+class AsyncImageResponse : public QQuickImageResponse
+{
+    Q_OBJECT
+public:
+    AsyncImageResponse(QQuickImageProvider *provider, ImageLoadPool::JobType type, const QString &path,
+                       const QString &id, const QSize &requestedSize);
+
+    QQuickTextureFactory *textureFactory() const override;
+    QString errorString() const override;
+
+public Q_SLOTS:
+    void cancel() override;
+
+private:
+    void load(QQuickImageProvider *provider, const QString &id, const QSize &requestedSize);
+
+private:
+    mutable QMutex  m_mutex;
+    quint64         m_jobId = 0;
+    bool            m_canceled = false;
+    QImage          m_image;
+    QString         m_error;
+};
+
+/**
+ * @brief 将同步的 QQuickImageProvider 包装为异步图片提供者，请求在 ImageLoadPool 中按优先级执行
+ *      被包装的 \a provider 仍可由 C++ 代码同步调用(如导航窗口获取多页图帧)，
+ *      所有权转移给此对象，随 QML 引擎释放此对象时一同释放。
+ *      \a id 包含 "#frame_帧号" 时以 # 前的部分作为文件路径，以 "_thumbnail" 结尾时视为缩略图请求。
+ */
+class AsyncImageProvider : public QQuickAsyncImageProvider
+{
+public:
+    AsyncImageProvider(QQuickImageProvider *provider, ImageLoadPool::JobType type);
+    ~AsyncImageProvider() override;
+
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
+
+private:
+    QQuickImageProvider     *m_provider = nullptr;
+    ImageLoadPool::JobType  m_type = ImageLoadPool::EImage;
+};
+
+#endif // ASYNCIMAGEPROVIDER_H
@@ -0,0 +1,194 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "imageloadpool.h"
+
+#include <QRunnable>
+#include <QUrl>
+
+/**
+ * @brief 执行单个任务，完成后通知线程池调度后续任务
+ */
+class ImageLoadPool::Runner : public QRunnable
+{
+public:
+    Runner(ImageLoadPool *pool, const Task &task)
+        : m_pool(pool)
+        , m_task(task)
+    {
+    }
+
+    void run() override
+    {
+        m_task.job();
+        m_pool->finish(m_task);
+    }
+
+private:
+    ImageLoadPool   *m_pool;
+    Task            m_task;
+};
+
+/**
+ * @return 传入的 \a path 可能为 file:// 格式的 url ，统一转换为本地路径
+ */
+static QString localPath(const QString &path)
+{
+    QUrl url(path);
+    return url.isLocalFile() ? url.toLocalFile() : path;
+}
+
+ImageLoadPool::ImageLoadPool()
+{
+    // 至少两个线程，保证缩略图加载时仍有线程可用于加载图片
+    m_pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+}
+
+ImageLoadPool *ImageLoadPool::instance()
+{
+    static ImageLoadPool s_pool;
+    return &s_pool;
+}
+
+/**
+ * @brief 提交 \a type 类型的任务 \a job ， \a path 为加载的文件路径，用于计算任务优先级
+ * @return 任务标识，用于取消任务
+ */
+quint64 ImageLoadPool::start(JobType type, const QString &path, const std::function<void()> &job)
+{
+    QMutexLocker _locker(&m_mutex);
+    Task task;
+    task.id = m_nextId++;
+    task.type = type;
+    task.path = localPath(path);
+    task.job = job;
+    m_queues[priority(task)].insert(task.id, task);
+
+    dispatch();
+    return task.id;
+}
+
+/**
+ * @brief 从等待队列中移除任务 \a id
+ * @return 任务被移除时返回 true ，任务已开始执行或已完成时返回 false
+ */
+bool ImageLoadPool::cancel(quint64 id)
+{
+    QMutexLocker _locker(&m_mutex);
+    for (TaskQueue &queue : m_queues) {
+        if (queue.remove(id) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 程序退出时调用，移除等待执行的任务，任务中引用的图片提供者随后由 QML 引擎释放
+ */
+void ImageLoadPool::shutdown()
+{
+    {
+        QMutexLocker _locker(&m_mutex);
+        for (TaskQueue &queue : m_queues) {
+            queue.clear();
+        }
+    }
+    m_pool.waitForDone();
+}
+
+void ImageLoadPool::setCurrentImage(const QString &path)
+{
+    QMutexLocker _locker(&m_mutex);
+    m_currentImage = localPath(path);
+    requeue();
+}
+
+void ImageLoadPool::setVisibleThumbnails(const QStringList &paths)
+{
+    QSet<QString> visible;
+    for (const QString &path : paths) {
+        visible.insert(localPath(path));
+    }
+
+    QMutexLocker _locker(&m_mutex);
+    m_visibleThumbnails.swap(visible);
+    requeue();
+}
+
+/**
+ * @return 任务 \a task 当前的优先级，当前图片的缩略图(如多页图的帧缩略图)视为可见缩略图
+ */
+ImageLoadPool::Priority ImageLoadPool::priority(const Task &task) const
+{
+    if (EImage == task.type) {
+        return (task.path.isEmpty() || task.path == m_currentImage) ? ECurrentImage : ENeighbourImage;
+    }
+
+    return (task.path == m_currentImage || m_visibleThumbnails.contains(task.path)) ? EVisibleThumbnail
+                                                                                    : EOffscreenThumbnail;
+}
+
+/**
+ * @brief 当前图片或可见缩略图变更后，将优先级变更的任务移至对应的等待队列，需在加锁后调用
+ */
+void ImageLoadPool::requeue()
+{
+    for (int i = 0; i < EPriorityCount; i++) {
+        TaskQueue &queue = m_queues[i];
+        for (auto itr = queue.begin(); itr != queue.end();) {
+            const Priority taskPriority = priority(itr.value());
+            if (taskPriority == i) {
+                ++itr;
+                continue;
+            }
+            m_queues[taskPriority].insert(itr.key(), itr.value());
+            itr = queue.erase(itr);
+        }
+    }
+}
+
+/**
+ * @brief 在存在空闲线程时取出优先级最高的任务执行，相同优先级按提交顺序执行，需在加锁后调用
+ */
+void ImageLoadPool::dispatch()
+{
+    const int maxThreads = m_pool.maxThreadCount();
+    while (m_running < maxThreads) {
+        const bool allowThumbnail = m_runningThumbnails < maxThreads - 1;
+
+        TaskQueue *queue = nullptr;
+        for (int i = 0; i < EPriorityCount; i++) {
+            // 缩略图的优先级低于图片，缩略图占用的线程已达上限时不再查找
+            if (i >= EVisibleThumbnail && !allowThumbnail) {
+                break;
+            }
+            if (!m_queues[i].isEmpty()) {
+                queue = &m_queues[i];
+                break;
+            }
+        }
+
+        if (!queue) {
+            break;
+        }
+
+        Task task = queue->take(queue->firstKey());
+        m_running++;
+        if (EThumbnail == task.type) {
+            m_runningThumbnails++;
+        }
+        m_pool.start(new Runner(this, task));
+    }
+}
+
+void ImageLoadPool::finish(const Task &task)
+{
+    QMutexLocker _locker(&m_mutex);
+    m_running--;
+    if (EThumbnail == task.type) {
+        m_runningThumbnails--;
+    }
+    dispatch();
+}
@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef IMAGELOADPOOL_H
+#define IMAGELOADPOOL_H
+
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <functional>
+
+/**
+ * @brief 按优先级调度的图片加载线程池
+ *      QQuickImageProvider 的同步接口由 Qt Quick 内部少量加载线程按请求顺序调用，
+ *      滑动浏览时大量缩略图请求会排在当前图片之前。此类维护独立的线程池和等待队列，
+ *      每次有空闲线程时取出优先级最高的任务执行，优先级依次为：
+ *      当前图片、相邻(预加载)图片、可见缩略图、不可见缩略图，相同优先级按提交顺序执行。
+ *      任务按优先级分别排队，取出任务时无需遍历整个队列；切换图片或滚动缩略图栏时重新计算已排队任务的优先级并立即生效。
+ *      缩略图任务最多占用 线程数 - 1 个线程，始终保留一个线程用于加载图片，缩略图不会延迟当前图片的加载。
+ * @threadsafe
+ */
+class ImageLoadPool
+{
+public:
+    // 任务优先级，数值越小越优先
+    enum Priority {
+        ECurrentImage,
+        ENeighbourImage,
+        EVisibleThumbnail,
+        EOffscreenThumbnail,
+        EPriorityCount,         // 优先级数量，用于分配各优先级的等待队列
+    };
+
+    // 任务类型
+    enum JobType {
+        EImage,         // 完整图片，空路径视为当前图片
+        EThumbnail,     // 缩略图
+    };
+
+    static ImageLoadPool *instance();
+
+    // 提交加载 \a path 文件的任务，返回任务标识
+    quint64 start(JobType type, const QString &path, const std::function<void()> &job);
+    // 取消尚未执行的任务，任务已开始或已完成时返回 false
+    bool cancel(quint64 id);
+    // 移除等待执行的任务并等待正在执行的任务完成，在释放图片提供者前调用
+    void shutdown();
+
+    // 设置当前展示的图片和缩略图栏中可见的图片，用于计算任务优先级
+    void setCurrentImage(const QString &path);
+    void setVisibleThumbnails(const QStringList &paths);
+
+private:
+    ImageLoadPool();
+    Q_DISABLE_COPY(ImageLoadPool)
+
+    struct Task {
+        quint64                 id = 0;
+        JobType                 type = EImage;
+        QString                 path;
+        std::function<void()>   job;
+    };
+    // 等待执行的任务，按任务标识(即提交顺序)排列
+    typedef QMap<quint64, Task> TaskQueue;
+
+    Priority priority(const Task &task) const;
+    void requeue();
+    void dispatch();
+    void finish(const Task &task);
+
+    class Runner;
+    friend class Runner;
+
+private:
+    QMutex          m_mutex;
+    QThreadPool     m_pool;
+    TaskQueue       m_queues[EPriorityCount];   // 各优先级等待执行的任务
+    quint64         m_nextId = 1;
+    int             m_running = 0;              // 正在执行的任务数
+    int             m_runningThumbnails = 0;    // 正在执行的缩略图任务数
+
+    QString         m_currentImage;             // 当前图片路径
+    QSet<QString>   m_visibleThumbnails;        // 可见缩略图路径
+};
+
+#endif // IMAGELOADPOOL_H
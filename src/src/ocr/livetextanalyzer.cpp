@@ -3,114 +3,596 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "livetextanalyzer.h"
+#include "ocrpreprocessor.h"
+#include "ocrresultcache.h"
 
+#include <QDataStream>
+#include <QHash>
+#include <QStringList>
+#include <QThread>
 #include <QVariant>
+#include <QVector>
+#include <QtConcurrent>
 
 #include <deepin-ocr-plugin-manager/deepinocrplugindef.h>
 #include <deepin-ocr-plugin-manager/deepinocrplugin.h>
 
-#include <QtConcurrent/QtConcurrent>
+#include <atomic>
+#include <type_traits>
+#include <utility>
+
+// 识别结果快照，分析完成后从 ocrDriver 拷贝，后续分析不会修改
+struct LiveTextAnalyzer::AnalyzeResult {
+    using TextBoxes = std::decay_t<decltype(std::declval<DeepinOCRPlugin::DeepinOCRDriver &>().getTextBoxes())>;
+
+    quint64 serial = 0;             // 请求序号，作为结果的标识
+    QString token;                  // 请求时传入的标识
+    QImage image;                   // 分析的图片
+    TextBoxes textBoxes;            // 文本块
+    QVector<TextBoxes> charBoxes;   // 各文本块的字符位置
+    QStringList texts;              // 各文本块的识别文本
+
+    // 以下为 requestImage() 使用的文本块区域图片缓存，由 cropMutex 保护
+    QMutex cropMutex;
+    QHash<int, QImage> crops;       // 各文本块区域，共享 image 的像素数据
+    QHash<int, QImage> scaledCrops; // 各文本块区域按最近一次请求的大小缩放的图片
+};
+
+// 单个分块的识别结果，坐标已映射到原图
+struct TileResult {
+    using TextBoxes = LiveTextAnalyzer::AnalyzeResult::TextBoxes;
+
+    bool ok = false;
+    TextBoxes textBoxes;
+    QVector<TextBoxes> charBoxes;
+    QStringList texts;
+};
+
+// 缓存数据的格式标识及版本，结果的结构或坐标含义变化时递增版本
+static const quint32 s_cacheMagic = 0x4F435252;
+static const quint32 s_cacheVersion = 1;
+
+static void writeBoxes(QDataStream &stream, const LiveTextAnalyzer::AnalyzeResult::TextBoxes &boxes)
+{
+    stream << static_cast<quint32>(boxes.size());
+    for (auto &box : boxes) {
+        stream << static_cast<quint32>(box.points.size());
+        for (auto &point : box.points) {
+            stream << static_cast<float>(point.first) << static_cast<float>(point.second);
+        }
+        stream << static_cast<float>(box.angle);
+    }
+}
+
+static bool readBoxes(QDataStream &stream, LiveTextAnalyzer::AnalyzeResult::TextBoxes &boxes)
+{
+    using TextBox = LiveTextAnalyzer::AnalyzeResult::TextBoxes::value_type;
+    using Point = std::decay_t<decltype(std::declval<TextBox &>().points)>::value_type;
+
+    quint32 boxCount = 0;
+    stream >> boxCount;
+    for (quint32 i = 0; i < boxCount && stream.status() == QDataStream::Ok; i++) {
+        TextBox box;
+        quint32 pointCount = 0;
+        stream >> pointCount;
+        for (quint32 j = 0; j < pointCount && stream.status() == QDataStream::Ok; j++) {
+            float x = 0;
+            float y = 0;
+            stream >> x >> y;
+            box.points.push_back(Point(x, y));
+        }
+        float angle = 0;
+        stream >> angle;
+        box.angle = angle;
+        boxes.push_back(box);
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+/**
+ * @return 序列化 \a result 中的文本块、字符位置及识别文本
+ */
+static QByteArray serializeResult(const LiveTextAnalyzer::AnalyzeResult &result)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    stream << s_cacheMagic << s_cacheVersion;
+    writeBoxes(stream, result.textBoxes);
+    stream << static_cast<quint32>(result.charBoxes.size());
+    for (auto &boxes : result.charBoxes) {
+        writeBoxes(stream, boxes);
+    }
+    stream << result.texts;
+    return data;
+}
+
+/**
+ * @brief 将缓存数据 \a data 反序列化至 \a result
+ * @return 格式及版本匹配且数据完整时返回 true
+ */
+static bool deserializeResult(const QByteArray &data, LiveTextAnalyzer::AnalyzeResult *result)
+{
+    QDataStream stream(data);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    if (magic != s_cacheMagic || version != s_cacheVersion) {
+        return false;
+    }
+
+    LiveTextAnalyzer::AnalyzeResult::TextBoxes textBoxes;
+    if (!readBoxes(stream, textBoxes)) {
+        return false;
+    }
+
+    quint32 charBoxCount = 0;
+    stream >> charBoxCount;
+    QVector<LiveTextAnalyzer::AnalyzeResult::TextBoxes> charBoxes;
+    for (quint32 i = 0; i < charBoxCount; i++) {
+        LiveTextAnalyzer::AnalyzeResult::TextBoxes boxes;
+        if (!readBoxes(stream, boxes)) {
+            return false;
+        }
+        charBoxes.append(boxes);
+    }
+
+    QStringList texts;
+    stream >> texts;
+    // 各文本块需有对应的字符位置及识别文本，否则按索引访问时越界
+    if (stream.status() != QDataStream::Ok
+            || static_cast<size_t>(charBoxes.size()) != textBoxes.size()
+            || static_cast<size_t>(texts.size()) != textBoxes.size()) {
+        return false;
+    }
+
+    result->textBoxes = textBoxes;
+    result->charBoxes = charBoxes;
+    result->texts = texts;
+    return true;
+}
+
+/**
+ * @return 创建并加载默认插件的 OCR 驱动
+ */
+static DeepinOCRPlugin::DeepinOCRDriver *createDriver()
+{
+    auto driver = new DeepinOCRPlugin::DeepinOCRDriver;
+    driver->loadDefaultPlugin();
+    driver->setUseHardware({{DeepinOCRPlugin::HardwareID::GPU_Vulkan, 0}});
+    return driver;
+}
+
+/**
+ * @return 识别引擎的标识，包含插件管理器版本及已安装的插件，插件或模型更新后缓存的结果不再使用
+ */
+static QString engineIdentity(DeepinOCRPlugin::DeepinOCRDriver *driver)
+{
+    QStringList parts {QStringLiteral(OCR_PLUGIN_VERSION)};
+    for (auto &name : driver->getPluginNames()) {
+        parts.append(QString::fromStdString(name));
+    }
+    return parts.join(';');
+}
+
+// 依次执行分析任务的工作线程
+class LiveTextAnalyzer::WorkerThread : public QThread
+{
+public:
+    explicit WorkerThread(LiveTextAnalyzer *analyzer)
+        : analyzer(analyzer)
+    {
+    }
+
+protected:
+    void run() override
+    {
+        analyzer->processJobs();
+    }
+
+private:
+    LiveTextAnalyzer *analyzer;
+};
 
 LiveTextAnalyzer::LiveTextAnalyzer(QObject *parent)
     : QObject(parent)
     , QQuickImageProvider(Image)
-    , ocrDriver(new DeepinOCRPlugin::DeepinOCRDriver)
+    , ocrDriver(createDriver())
+    , engineId(engineIdentity(ocrDriver))
+    , workerThread(new WorkerThread(this))
 {
-    ocrDriver->loadDefaultPlugin();
-    ocrDriver->setUseHardware({{DeepinOCRPlugin::HardwareID::GPU_Vulkan, 0}});
+    workerThread->start();
 }
 
-void LiveTextAnalyzer::setImage(const QImage &image)
+LiveTextAnalyzer::~LiveTextAnalyzer()
 {
+    {
+        QMutexLocker locker(&jobMutex);
+        quitWorker = true;
+        if (analyzing) {
+            breakDrivers();
+        }
+        jobCondition.wakeOne();
+    }
+
+    workerThread->wait();
+    delete workerThread;
+    qDeleteAll(tileDrivers);
+    delete ocrDriver;
+}
+
+/**
+ * @brief 设置待分析的图片 \a image ，\a screenGrab 为 true 时图片为截取的屏幕图像，分析时不再缩小
+ */
+void LiveTextAnalyzer::setImage(const QImage &image, bool screenGrab)
+{
+    QMutexLocker locker(&jobMutex);
     imageCache = image;
-    QImage image_copy = image.convertToFormat(QImage::Format_RGB888);
-    ocrDriver->setMatrix(image_copy.height(), image_copy.width(), image_copy.bits(),
-                         static_cast<size_t>(image_copy.bytesPerLine()), DeepinOCRPlugin::PixelType::Pixel_RGB);
+    imageIsGrab = screenGrab;
 }
 
 void LiveTextAnalyzer::analyze(const QString &token)
 {
-    //此处使用token来标记本次识别的目标，后续的识别结果也随token发出
-    //外部调用的时候也凭借收到的token判断是否采用此次的识别结果
-    //以此来解决QML的信号延迟问题，但仅降低此问题的复现概率，没有完全解决
-    QtConcurrent::run([this, token]() {
-        while(ocrDriver->isRunning()) {}; //等待之前的分析结束
-        emit analyzeFinished(ocrDriver->analyze(), token);
-    });
+    //此处使用token来标记本次识别的目标，识别结果快照同样记录token并随结果发出
+    //等待的请求仅保留最新一个，正在执行的旧请求被中断，旧请求的结果不会发出
+    QMutexLocker locker(&jobMutex);
+    pendingImage = imageCache;
+    pendingIsGrab = imageIsGrab;
+    pendingToken = token;
+    hasPendingJob = true;
+    jobSerial++;
+    if (analyzing) {
+        breakDrivers();
+    }
+    jobCondition.wakeOne();
 }
 
 void LiveTextAnalyzer::breakAnalyze()
+{
+    QMutexLocker locker(&jobMutex);
+    hasPendingJob = false;
+    pendingImage = QImage();
+    jobSerial++;
+    if (analyzing) {
+        breakDrivers();
+    }
+}
+
+/**
+ * @brief 中断所有驱动正在执行的分析，需在加锁后调用
+ */
+void LiveTextAnalyzer::breakDrivers()
 {
     ocrDriver->breakAnalyze();
+    for (auto driver : tileDrivers) {
+        driver->breakAnalyze();
+    }
+}
+
+bool LiveTextAnalyzer::isStale(quint64 serial) const
+{
+    QMutexLocker locker(&jobMutex);
+    return serial != jobSerial;
+}
+
+/**
+ * @brief 工作线程循环，无任务时等待条件变量唤醒，每次取出最新的任务执行
+ */
+void LiveTextAnalyzer::processJobs()
+{
+    forever {
+        QMutexLocker locker(&jobMutex);
+        while (!quitWorker && !hasPendingJob) {
+            jobCondition.wait(&jobMutex);
+        }
+        if (quitWorker) {
+            return;
+        }
+
+        const QImage image = pendingImage;
+        const bool screenGrab = pendingIsGrab;
+        const QString token = pendingToken;
+        const quint64 serial = jobSerial;
+        pendingImage = QImage();
+        hasPendingJob = false;
+        analyzing = true;
+        locker.unlock();
+
+        QSharedPointer<AnalyzeResult> snapshot(new AnalyzeResult);
+        snapshot->serial = serial;
+        snapshot->token = token;
+        snapshot->image = image;
+
+        // 相同内容的图片已分析过时直接使用缓存的结果，不运行驱动
+        const QString cacheKey = OcrResultCache::imageKey(image, engineId);
+        QByteArray cacheData;
+        bool resultCanUse = OcrResultCache::instance()->load(cacheKey, cacheData)
+                            && deserializeResult(cacheData, snapshot.data());
+        if (!resultCanUse) {
+            resultCanUse = analyzeImage(image, screenGrab, serial, snapshot.data());
+            // 被中断的分析结果可能不完整，不写入缓存
+            if (resultCanUse && !isStale(serial)) {
+                OcrResultCache::instance()->store(cacheKey, serializeResult(*snapshot));
+            }
+        }
+
+        locker.relock();
+        analyzing = false;
+        const bool stale = serial != jobSerial;
+        locker.unlock();
+        if (stale) {
+            continue;
+        }
+        if (!resultCanUse) {
+            snapshot.reset();
+        }
+
+        QMetaObject::invokeMethod(this, [this, serial, token, resultCanUse, snapshot]() {
+            publishResult(serial, token, resultCanUse, snapshot);
+        }, Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief 预处理 \a image 并分析，结果坐标映射回原图像素后写入 \a snapshot 。
+ *      图片按估算的文本尺度缩小(\a screenGrab 截取的屏幕图像不缩小)，较大的图片拆分为重叠的分块，
+ *      由多个驱动并行分析，中心位于分块核心区域内的文本块归属此分块，避免重叠区域的文本重复
+ * @return 至少一个分块分析成功时返回 true
+ */
+bool LiveTextAnalyzer::analyzeImage(const QImage &image, bool screenGrab, quint64 serial, AnalyzeResult *snapshot)
+{
+    const int factor = screenGrab ? 1 : OcrPreprocessor::estimateScaleFactor(image);
+    QImage working = OcrPreprocessor::toWorkingImage(image, factor);
+    if (working.isNull()) {
+        return false;
+    }
+
+    const QVector<OcrPreprocessor::Tile> tiles = OcrPreprocessor::splitTiles(working.size());
+    // 按分块数创建额外的驱动，加载模型耗时较长，在锁外创建
+    const int driverCount = qMin(tiles.size(), int(ETileParallelism));
+    QVector<DeepinOCRPlugin::DeepinOCRDriver *> drivers {ocrDriver};
+    if (driverCount > 1) {
+        QVector<DeepinOCRPlugin::DeepinOCRDriver *> created;
+        for (int i = 1; i < driverCount; i++) {
+            created.append(createDriver());
+        }
+
+        QMutexLocker locker(&jobMutex);
+        tileDrivers = created;
+        drivers.append(created);
+    }
+
+    uchar *bits = working.bits();
+    const int bytesPerLine = working.bytesPerLine();
+    // 各分块的结果互不相同，并行写入前取得数据指针，避免 QVector 的分离检查
+    QVector<TileResult> results(tiles.size());
+    TileResult *resultData = results.data();
+    std::atomic<int> nextTile(0);
+    auto analyzeTiles = [&](DeepinOCRPlugin::DeepinOCRDriver *driver) {
+        forever {
+            const int index = nextTile++;
+            if (index >= tiles.size() || isStale(serial)) {
+                return;
+            }
+
+            const OcrPreprocessor::Tile &tile = tiles.at(index);
+            driver->setMatrix(tile.rect.height(), tile.rect.width(), bits + tile.rect.y() * bytesPerLine + tile.rect.x() * 3,
+                              static_cast<size_t>(bytesPerLine), DeepinOCRPlugin::PixelType::Pixel_RGB);
+            TileResult &result = resultData[index];
+            result.ok = driver->analyze();
+            if (!result.ok) {
+                continue;
+            }
+
+            auto mapBox = [&tile, factor](TileResult::TextBoxes::value_type &box) {
+                for (auto &point : box.points) {
+                    point.first = (point.first + tile.rect.x()) * factor;
+                    point.second = (point.second + tile.rect.y()) * factor;
+                }
+            };
+
+            auto boxes = driver->getTextBoxes();
+            for (size_t i = 0; i != boxes.size(); ++i) {
+                auto box = boxes[i];
+                if (box.points.empty()) {
+                    continue;
+                }
+
+                QPointF center;
+                for (auto &point : box.points) {
+                    center += QPointF(point.first, point.second);
+                }
+                center /= box.points.size();
+                if (!tile.core.contains((center + tile.rect.topLeft()).toPoint())) {
+                    continue;
+                }
+
+                auto charBoxes = driver->getCharBoxes(i);
+                for (auto &charBox : charBoxes) {
+                    mapBox(charBox);
+                }
+                mapBox(box);
+                result.textBoxes.push_back(box);
+                result.charBoxes.append(charBoxes);
+                result.texts.append(QString(driver->getResultFromBox(i).c_str()));
+            }
+        }
+    };
+
+    QVector<QFuture<void>> futures;
+    for (int i = 1; i < drivers.size(); i++) {
+        auto driver = drivers.at(i);
+        futures.append(QtConcurrent::run([&analyzeTiles, driver]() {
+            analyzeTiles(driver);
+        }));
+    }
+    analyzeTiles(drivers.first());
+    for (auto &future : futures) {
+        future.waitForFinished();
+    }
+
+    // 额外的驱动各自持有模型数据，仅在分块分析期间使用，分析完成后释放
+    if (driverCount > 1) {
+        QMutexLocker locker(&jobMutex);
+        const QVector<DeepinOCRPlugin::DeepinOCRDriver *> created = tileDrivers;
+        tileDrivers.clear();
+        locker.unlock();
+        qDeleteAll(created);
+    }
+
+    bool resultCanUse = false;
+    for (const TileResult &result : results) {
+        if (!result.ok) {
+            continue;
+        }
+        resultCanUse = true;
+        snapshot->textBoxes.insert(snapshot->textBoxes.end(), result.textBoxes.begin(), result.textBoxes.end());
+        snapshot->charBoxes.append(result.charBoxes);
+        snapshot->texts.append(result.texts);
+    }
+    return resultCanUse;
+}
+
+/**
+ * @brief 在主线程更新识别结果，期间有新的请求或被取消时丢弃
+ */
+void LiveTextAnalyzer::publishResult(quint64 serial, const QString &token, bool resultCanUse,
+                                     const QSharedPointer<AnalyzeResult> &snapshot)
+{
+    {
+        QMutexLocker locker(&jobMutex);
+        if (serial != jobSerial) {
+            return;
+        }
+        result = snapshot;
+    }
+
+    emit analyzeFinished(resultCanUse, token);
+}
+
+QSharedPointer<LiveTextAnalyzer::AnalyzeResult> LiveTextAnalyzer::currentResult() const
+{
+    QMutexLocker locker(&jobMutex);
+    return result;
 }
 
 QVariant LiveTextAnalyzer::liveBlock() const
 {
-    auto boxes = ocrDriver->getTextBoxes();
+    QList<QVariant> blocks;
+    auto current = currentResult();
+    if (!current) {
+        return blocks;
+    }
 
-    QList<QVariant> result;
-    for(auto &box : boxes) {
+    for(auto &box : current->textBoxes) {
         QList<QVariant> temp;
         for(size_t i = 0;i != box.points.size();++i) {
             temp.push_back(box.points[i].first);
             temp.push_back(box.points[i].second);
         }
         temp.push_back(box.angle);
-        result.push_back(temp);
+        blocks.push_back(temp);
     }
 
-    return result;
+    return blocks;
 }
 
 QVariant LiveTextAnalyzer::charBox(int blockIndex) const
 {
-    if(static_cast<size_t>(blockIndex) >= ocrDriver->getTextBoxes().size()) {
+    auto current = currentResult();
+    if(!current || blockIndex < 0 || blockIndex >= current->charBoxes.size()) {
         return QVariant();
     }
 
-    auto boxes = ocrDriver->getCharBoxes(static_cast<size_t>(blockIndex));
+    auto &boxes = current->charBoxes.at(blockIndex);
+    if (boxes.empty()) {
+        return QVariant();
+    }
 
-    QList<QVariant> result;
+    QList<QVariant> charResult;
 
     float base = boxes[0].points[0].first;
-    result.push_back(0);
+    charResult.push_back(0);
     for(auto &box : boxes) {
-        result.push_back(box.points[1].first - base);
+        charResult.push_back(box.points[1].first - base);
     }
 
-    return result;
+    return charResult;
 }
 
 QString LiveTextAnalyzer::textResult(int blockIndex, int startIndex, int len) const
 {
-    if(static_cast<size_t>(blockIndex) >= ocrDriver->getTextBoxes().size() || startIndex < 0 || len <= 0) {
+    auto current = currentResult();
+    if(!current || blockIndex < 0 || blockIndex >= current->texts.size() || startIndex < 0 || len <= 0) {
         return "";
     }
 
-    QString fullStr(ocrDriver->getResultFromBox(static_cast<size_t>(blockIndex)).c_str());
-    return fullStr.mid(startIndex, len);
+    return current->texts.at(blockIndex).mid(startIndex, len);
 }
 
-//格式：random_index
+static void releaseParentImage(void *info)
+{
+    delete static_cast<QImage *>(info);
+}
+
+/**
+ * @return \a image 中 \a rect 区域的图片，直接引用 image 的像素数据(按原图的行字节数访问)，
+ *      并持有 image 的引用直至区域图片释放。像素不足 1 字节或带颜色表的格式无法按字节偏移引用，返回拷贝
+ */
+static QImage subImage(const QImage &image, const QRect &rect)
+{
+    const QRect area = rect.intersected(image.rect());
+    if (area.isEmpty()) {
+        return QImage();
+    }
+    if (image.depth() < 8 || image.colorCount() > 0) {
+        return image.copy(area);
+    }
+
+    const uchar *bits = image.constBits() + area.y() * image.bytesPerLine() + area.x() * (image.depth() / 8);
+    return QImage(bits, area.width(), area.height(), image.bytesPerLine(), image.format(),
+                  releaseParentImage, new QImage(image));
+}
+
+QString LiveTextAnalyzer::resultId() const
+{
+    auto current = currentResult();
+    return current ? QString::number(current->serial) : QString();
+}
+
+//格式：resultId_index ，resultId 为 resultId() 返回的结果标识，同一结果的区域图片只生成一次
 QImage LiveTextAnalyzer::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
 {
-    auto startIndex = id.indexOf("_") + 1;
-    size_t index = id.mid(startIndex).toUInt();
+    auto separator = id.indexOf("_");
+    quint64 serial = id.left(separator).toULongLong();
+    int index = id.mid(separator + 1).toInt();
 
-    if(index >= ocrDriver->getTextBoxes().size()) {
+    auto current = currentResult();
+    if(!current || current->serial != serial || index < 0 || static_cast<size_t>(index) >= current->textBoxes.size()) {
         return QImage();
     }
 
-    auto box = ocrDriver->getTextBoxes()[index];
-    QRect rect(QPoint(static_cast<int>(box.points[0].first), static_cast<int>(box.points[0].second)),
-               QPoint(static_cast<int>(box.points[2].first), static_cast<int>(box.points[2].second)));
-    QImage image = imageCache.copy(rect);
+    QMutexLocker locker(&current->cropMutex);
+    auto cropIt = current->crops.find(index);
+    if (cropIt == current->crops.end()) {
+        auto &box = current->textBoxes[static_cast<size_t>(index)];
+        QRect rect(QPoint(static_cast<int>(box.points[0].first), static_cast<int>(box.points[0].second)),
+                   QPoint(static_cast<int>(box.points[2].first), static_cast<int>(box.points[2].second)));
+        cropIt = current->crops.insert(index, subImage(current->image, rect));
+    }
+
+    const QImage image = cropIt.value();
     if(size != nullptr)
     {
         *size = image.size();
     }
-    if(requestedSize.width() > 0 && requestedSize.height() > 0) {
-        return image.scaled(requestedSize);
+    if(requestedSize.width() > 0 && requestedSize.height() > 0 && requestedSize != image.size()) {
+        auto scaledIt = current->scaledCrops.find(index);
+        if (scaledIt == current->scaledCrops.end() || scaledIt.value().size() != requestedSize) {
+            scaledIt = current->scaledCrops.insert(index, image.scaled(requestedSize));
+        }
+        return scaledIt.value();
     } else {
         return image;
     }
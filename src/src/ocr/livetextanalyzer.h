@@ -6,19 +6,45 @@
 
 #include <QObject>
 #include <QImage>
+#include <QMutex>
 #include <QQuickImageProvider>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+#include <QWaitCondition>
 
 namespace DeepinOCRPlugin {
     class DeepinOCRDriver;
 }
 
+class QThread;
+
+/**
+ * @brief 实况文本(Live Text)分析
+ *      分析任务由单独的工作线程依次执行，等待的任务仅保留最新一个(快速切换图片时中间的请求直接丢弃)，
+ *      新任务到达时中断正在执行的旧任务。分析前按文本尺度缩小图片，大图拆分为分块并行分析，
+ *      结果坐标映射回原图像素。截取的屏幕图像已是屏幕分辨率，缩小会使 4K/HiDPI 屏幕上的文字过小，不再缩小。识别结果完成后拷贝为快照，并标记请求时传入的 token ，
+ *      仅当结果对应最新的请求时才替换当前结果并发送 analyzeFinished() 。
+ *      完整的识别结果按图片像素内容缓存至磁盘(OcrResultCache)，再次分析相同内容时直接使用缓存。
+ *      文本块区域图片以 resultId() 及文本块索引作为稳定的标识，每个结果的区域图片仅生成一次。
+ */
 class LiveTextAnalyzer : public QObject, public QQuickImageProvider
 {
     Q_OBJECT
 public:
+    enum Constant {
+        ETileParallelism = 3,       // 拆分分块时最多同时使用的驱动数
+    };
+
+    // 识别结果快照
+    struct AnalyzeResult;
+
     explicit LiveTextAnalyzer(QObject *parent = nullptr);
-    Q_INVOKABLE void setImage(const QImage &image);
+    ~LiveTextAnalyzer() override;
+
+    Q_INVOKABLE void setImage(const QImage &image, bool screenGrab = false);
 
+    Q_INVOKABLE QString resultId() const;
     Q_INVOKABLE QVariant liveBlock() const;
     Q_INVOKABLE QVariant charBox(int blockIndex) const;
     Q_INVOKABLE QString textResult(int blockIndex, int startIndex, int len) const;
@@ -33,7 +59,34 @@ public slots:
 protected:
     QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
 
+private:
+    class WorkerThread;
+
+    void processJobs();
+    bool analyzeImage(const QImage &image, bool screenGrab, quint64 serial, AnalyzeResult *snapshot);
+    void breakDrivers();
+    bool isStale(quint64 serial) const;
+    void publishResult(quint64 serial, const QString &token, bool resultCanUse,
+                       const QSharedPointer<AnalyzeResult> &snapshot);
+    QSharedPointer<AnalyzeResult> currentResult() const;
+
 private:
     DeepinOCRPlugin::DeepinOCRDriver *ocrDriver;
-    QImage imageCache;
+    const QString engineId;                 // 识别引擎标识，作为结果缓存标识的一部分
+    QVector<DeepinOCRPlugin::DeepinOCRDriver *> tileDrivers;   // 分块并行分析使用的额外驱动，分析完成后释放，由 jobMutex 保护
+    QThread *workerThread;
+
+    // 以下数据由 jobMutex 保护
+    mutable QMutex jobMutex;
+    QWaitCondition jobCondition;
+    QImage imageCache;                      // setImage() 设置的待分析图片
+    bool imageIsGrab = false;               // 待分析图片是否为截取的屏幕图像
+    QImage pendingImage;                    // 等待分析的图片，仅保留最新的请求
+    bool pendingIsGrab = false;
+    QString pendingToken;
+    bool hasPendingJob = false;
+    bool analyzing = false;                 // 工作线程正在分析
+    bool quitWorker = false;
+    quint64 jobSerial = 0;                  // 请求序号，新请求或取消时递增，旧序号的结果被丢弃
+    QSharedPointer<AnalyzeResult> result;   // 当前展示的识别结果快照
 };
@@ -5,6 +5,78 @@
 
 #include "ocrinterface.h"
 #include <QDBusMetaType>
+#include <QDBusPendingCallWatcher>
+#include <QDBusUnixFileDescriptor>
+#include <QDir>
+#include <QStandardPaths>
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * @brief 创建包含 \a image 描述信息及像素数据的 memfd ，写入后封印为只读，接收方可安全地映射
+ * @return 文件描述符，失败或系统不支持时返回 -1
+ */
+int OcrInterface::createImageMemfd(const QImage &image)
+{
+#if defined(MFD_CLOEXEC) && defined(MFD_ALLOW_SEALING)
+    // 索引色图片附带颜色表，转换为 32 位格式后传递
+    QImage source = image;
+    if (source.format() == QImage::Format_Indexed8 || source.format() == QImage::Format_Mono
+            || source.format() == QImage::Format_MonoLSB) {
+        source = source.convertToFormat(source.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+    }
+    if (source.isNull()) {
+        return -1;
+    }
+
+    OcrSharedImageHeader header;
+    header.magic = OcrSharedImageHeader::EMagic;
+    header.version = OcrSharedImageHeader::EVersion;
+    header.width = source.width();
+    header.height = source.height();
+    header.bytesPerLine = source.bytesPerLine();
+    header.format = static_cast<qint32>(source.format());
+
+    const size_t pixelBytes = static_cast<size_t>(source.bytesPerLine()) * static_cast<size_t>(source.height());
+    const size_t totalBytes = sizeof(header) + pixelBytes;
+
+    int fd = memfd_create("deepin-image-viewer-ocr", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        qWarning() << "OcrInterface: memfd_create failed," << strerror(errno);
+        return -1;
+    }
+    if (ftruncate(fd, static_cast<off_t>(totalBytes)) != 0) {
+        qWarning() << "OcrInterface: ftruncate failed," << strerror(errno);
+        close(fd);
+        return -1;
+    }
+
+    void *mapped = mmap(nullptr, totalBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == mapped) {
+        qWarning() << "OcrInterface: mmap failed," << strerror(errno);
+        close(fd);
+        return -1;
+    }
+    uchar *dst = static_cast<uchar *>(mapped);
+    std::memcpy(dst, &header, sizeof(header));
+    std::memcpy(dst + sizeof(header), source.constBits(), pixelBytes);
+    munmap(mapped, totalBytes);
+
+    // 封印后大小及内容不可再修改，接收方映射时无需担心数据被截断
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0) {
+        qWarning() << "OcrInterface: seal memfd failed," << strerror(errno);
+    }
+    return fd;
+#else
+    Q_UNUSED(image)
+    return -1;
+#endif
+}
 
 OcrInterface::OcrInterface(const QString &serviceName, const QString &ObjectPath,
                            const QDBusConnection &connection, QObject *parent)
@@ -17,3 +89,47 @@ OcrInterface::~OcrInterface()
 {
 
 }
+
+QDBusPendingReply<> OcrInterface::openImageShared(const QImage &image, const QString &imageName)
+{
+    qDebug() << __FUNCTION__;
+    int fd = -1;
+    if (!sharedUnsupported && (connection().connectionCapabilities() & QDBusConnection::UnixFileDescriptorPassing)) {
+        fd = createImageMemfd(image);
+    }
+    if (fd < 0) {
+        return openImageByFile(image);
+    }
+
+    // QDBusUnixFileDescriptor 持有 fd 的副本，本地的 fd 可直接关闭
+    QDBusUnixFileDescriptor descriptor(fd);
+    close(fd);
+
+    // 异步调用，服务返回错误时在 GUI 线程回退至临时文件
+    QDBusPendingReply<> reply = asyncCall(QStringLiteral("openImageFd"), QVariant::fromValue(descriptor), imageName);
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(reply, this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, image](QDBusPendingCallWatcher *call) {
+        call->deleteLater();
+        if (!call->isError()) {
+            return;
+        }
+
+        // 旧版本服务未提供此接口，后续不再尝试
+        const QDBusError error = call->error();
+        if (QDBusError::UnknownMethod == error.type()) {
+            sharedUnsupported = true;
+        }
+        qWarning() << "OcrInterface: openImageFd failed, fallback to openFile," << error.message();
+        openImageByFile(image);
+    });
+    return reply;
+}
+
+QDBusPendingReply<> OcrInterface::openImageByFile(const QImage &image)
+{
+    auto tempFileName = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation) + QDir::separator() + "rec.png";
+    if (!image.save(tempFileName)) {
+        qWarning() << "OcrInterface: save temp image failed," << tempFileName;
+    }
+    return asyncCall(QStringLiteral("openFile"), tempFileName);
+}
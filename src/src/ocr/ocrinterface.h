@@ -18,6 +18,30 @@
 #include <QBuffer>
 #include <QDebug>
 
+/**
+ * @brief 共享内存传递图片时数据开头的描述信息，其后为 height * bytesPerLine 字节的像素数据，
+ *      format 为 QImage::Format 枚举值(不包含需要颜色表的索引色格式)，服务端可直接以此构造 QImage 而无需解码。
+ *
+ *      服务端接口： openImageFd(h fd, s imageName)
+ *      fd 为封印(F_SEAL_WRITE 等)后只读的 memfd ，服务端以只读方式映射，按本结构校验后读取像素数据，
+ *      参考 tests/ocrstub 中的 readSharedImage() 。未提供此接口的服务返回 UnknownMethod ，
+ *      调用方回退至临时文件及 openFile 。tests/ocrstub 为实现此接口的本地调试服务。
+ *      结构按本机字节序写入，字段变更时递增 EVersion 。
+ */
+struct OcrSharedImageHeader {
+    quint32 magic;          // 固定为 EMagic
+    quint32 version;        // 当前为 EVersion
+    qint32 width;
+    qint32 height;
+    qint32 bytesPerLine;
+    qint32 format;
+
+    enum Constant : quint32 {
+        EMagic = 0x52434F44,    // "DOCR"
+        EVersion = 1,
+    };
+};
+
 class OcrInterface: public QDBusAbstractInterface
 {
     Q_OBJECT
@@ -85,6 +109,31 @@ public Q_SLOTS: // METHODS
         return call(QStringLiteral("openImageAndName"), QVariant::fromValue(data), imageName);
     }
 
+    /*
+    * @bref:openImageShared 通过共享内存(memfd)传递原始像素数据，文件描述符作为 D-Bus 参数传递，
+    *       无需 PNG 编码、压缩及 base64 转换。异步调用，不阻塞调用线程。
+    *       连接不支持传递文件描述符、服务未提供 openImageFd 或调用失败时，回退至保存临时文件后 openFile
+    * @param: image 图片
+    * @param: imageName 图片名称
+    * @return: QDBusPendingReply
+    */
+    QDBusPendingReply<> openImageShared(const QImage &image, const QString &imageName);
+
+public:
+    /*
+    * @bref:createImageMemfd 创建包含 OcrSharedImageHeader 及图片像素数据的 memfd ，写入后封印为只读
+    * @param: image 图片，索引色图片转换为 32 位格式
+    * @return: 文件描述符，由调用方关闭，失败或系统不支持时返回 -1
+    */
+    static int createImageMemfd(const QImage &image);
+
+private:
+    // 保存临时文件后通过 openFile 打开，用于不支持 openImageFd 的服务
+    QDBusPendingReply<> openImageByFile(const QImage &image);
+
+private:
+    bool sharedUnsupported = false;     // 服务不支持 openImageFd ，后续直接使用临时文件
+
 Q_SIGNALS: // SIGNALS
 };
 
@@ -0,0 +1,234 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "ocrpreprocessor.h"
+
+#include <QPair>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+// 估算笔画宽度时采样的行数、边缘的亮度差阈值及统计的最大间隔
+static const int s_sampleRows = 64;
+static const int s_edgeThreshold = 48;
+static const int s_maxRunLength = 64;
+
+// 32 位像素中各颜色通道的字节偏移
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+static const int s_redOffset = 2;
+static const int s_greenOffset = 1;
+static const int s_blueOffset = 0;
+#else
+static const int s_redOffset = 1;
+static const int s_greenOffset = 2;
+static const int s_blueOffset = 3;
+#endif
+
+/**
+ * @return 转换为 32 位像素格式的图片，已是 32 位格式时不拷贝
+ */
+static QImage to32Bit(const QImage &image)
+{
+    switch (image.format()) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        return image;
+    default:
+        return image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                              : QImage::Format_RGB32);
+    }
+}
+
+static inline int luma(QRgb pixel)
+{
+    return (qRed(pixel) * 2 + qGreen(pixel) * 5 + qBlue(pixel)) >> 3;
+}
+
+/**
+ * @brief 将 \a row 的 \a bytes 个字节累加到 16 位累加器 \a acc
+ */
+static void accumulateRow(const uchar *row, quint16 *acc, int bytes)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i + 8));
+        lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(data, zero));
+        hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(data, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i + 8), hi);
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for (; i + 16 <= bytes; i += 16) {
+        uint8x16_t data = vld1q_u8(row + i);
+        vst1q_u16(acc + i, vaddw_u8(vld1q_u16(acc + i), vget_low_u8(data)));
+        vst1q_u16(acc + i + 8, vaddw_u8(vld1q_u16(acc + i + 8), vget_high_u8(data)));
+    }
+#endif
+    for (; i < bytes; i++) {
+        acc[i] = static_cast<quint16>(acc[i] + row[i]);
+    }
+}
+
+/**
+ * @brief 统计采样行中相邻亮度边缘的间隔，文本区域的间隔集中在笔画宽度及笔画间距附近，
+ *      取间隔的中位数作为笔画宽度，缩小后笔画宽度不低于 EMinStrokeWidth 。
+ *      未检测到足够的边缘(可能不含文本)时仅按 2 倍缩小
+ * @return 缩小系数，不超过 EMaxScaleFactor 且缩小后长边不低于 EMinWorkingSide
+ */
+int OcrPreprocessor::estimateScaleFactor(const QImage &image)
+{
+    const int longSide = qMax(image.width(), image.height());
+    const int maxFactor = qBound(1, longSide / EMinWorkingSide, int(EMaxScaleFactor));
+    if (maxFactor <= 1) {
+        return 1;
+    }
+
+    const QImage source = to32Bit(image);
+    QVector<int> histogram(s_maxRunLength, 0);
+    int total = 0;
+    const int rowStep = qMax(1, source.height() / s_sampleRows);
+    for (int y = rowStep / 2; y < source.height(); y += rowStep) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(source.constScanLine(y));
+        int previous = luma(line[0]);
+        int lastEdge = -1;
+        for (int x = 1; x < source.width(); x++) {
+            const int current = luma(line[x]);
+            if (qAbs(current - previous) >= s_edgeThreshold) {
+                // 抗锯齿的边缘可能连续两个像素超过阈值，忽略间隔为 1 的边缘
+                const int run = x - lastEdge;
+                if (lastEdge >= 0 && run > 1 && run < s_maxRunLength) {
+                    histogram[run]++;
+                    total++;
+                }
+                lastEdge = x;
+            }
+            previous = current;
+        }
+    }
+
+    if (total < s_sampleRows) {
+        return qMin(2, maxFactor);
+    }
+
+    int median = 0;
+    for (int count = 0; median < s_maxRunLength; median++) {
+        count += histogram.at(median);
+        if (count * 2 >= total) {
+            break;
+        }
+    }
+
+    return qBound(1, median / EMinStrokeWidth, maxFactor);
+}
+
+/**
+ * @brief 将 \a image 转换为 RGB888 格式，\a factor 大于 1 时同时按 factor x factor 区域平均缩小，
+ *      每 factor 行源数据累加后生成一行输出，仅遍历一次源图片。不足 factor 的右侧及底部边缘被舍弃
+ */
+QImage OcrPreprocessor::toWorkingImage(const QImage &image, int factor)
+{
+    if (image.isNull()) {
+        return QImage();
+    }
+    if (factor <= 1) {
+        return image.convertToFormat(QImage::Format_RGB888);
+    }
+
+    const QImage source = to32Bit(image);
+    const int width = source.width() / factor;
+    const int height = source.height() / factor;
+    if (width <= 0 || height <= 0) {
+        return image.convertToFormat(QImage::Format_RGB888);
+    }
+
+    QImage result(width, height, QImage::Format_RGB888);
+    if (result.isNull()) {
+        return QImage();
+    }
+
+    // 16 位累加器可容纳 EMaxScaleFactor 行的累加值
+    const int rowBytes = width * factor * 4;
+    QVector<quint16> acc(rowBytes);
+    const int area = factor * factor;
+    for (int y = 0; y < height; y++) {
+        acc.fill(0);
+        for (int i = 0; i < factor; i++) {
+            accumulateRow(source.constScanLine(y * factor + i), acc.data(), rowBytes);
+        }
+
+        uchar *dst = result.scanLine(y);
+        const quint16 *sum = acc.constData();
+        for (int x = 0; x < width; x++) {
+            quint32 red = 0;
+            quint32 green = 0;
+            quint32 blue = 0;
+            for (int i = 0; i < factor; i++) {
+                const quint16 *pixel = sum + (x * factor + i) * 4;
+                red += pixel[s_redOffset];
+                green += pixel[s_greenOffset];
+                blue += pixel[s_blueOffset];
+            }
+            dst[x * 3] = static_cast<uchar>((red + area / 2) / area);
+            dst[x * 3 + 1] = static_cast<uchar>((green + area / 2) / area);
+            dst[x * 3 + 2] = static_cast<uchar>((blue + area / 2) / area);
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @return 将长度 \a length 拆分的各区间 [起始, 结束) 及其核心区间，相邻区间重叠 ETileOverlap ，
+ *      核心区间以重叠部分的中点为界，相互连续且不重叠
+ */
+static QVector<QPair<QPair<int, int>, QPair<int, int>>> splitAxis(int length)
+{
+    QVector<QPair<QPair<int, int>, QPair<int, int>>> ranges;
+    if (length <= OcrPreprocessor::ETileSize) {
+        ranges.append(qMakePair(qMakePair(0, length), qMakePair(0, length)));
+        return ranges;
+    }
+
+    const int step = OcrPreprocessor::ETileSize - OcrPreprocessor::ETileOverlap;
+    const int count = (length - OcrPreprocessor::ETileOverlap + step - 1) / step;
+    for (int i = 0; i < count; i++) {
+        const int start = qMin(i * step, length - int(OcrPreprocessor::ETileSize));
+        ranges.append(qMakePair(qMakePair(start, start + int(OcrPreprocessor::ETileSize)), qMakePair(0, length)));
+    }
+    for (int i = 0; i + 1 < count; i++) {
+        const int boundary = (ranges[i].first.second + ranges[i + 1].first.first) / 2;
+        ranges[i].second.second = boundary;
+        ranges[i + 1].second.first = boundary;
+    }
+    return ranges;
+}
+
+/**
+ * @brief 工作图片边长不超过 ETileSize 时仅有一个分块，否则按行列拆分为相互重叠的分块
+ */
+QVector<OcrPreprocessor::Tile> OcrPreprocessor::splitTiles(const QSize &size)
+{
+    QVector<Tile> tiles;
+    const auto columns = splitAxis(size.width());
+    const auto rows = splitAxis(size.height());
+    for (const auto &row : rows) {
+        for (const auto &column : columns) {
+            Tile tile;
+            tile.rect = QRect(QPoint(column.first.first, row.first.first),
+                              QPoint(column.first.second - 1, row.first.second - 1));
+            tile.core = QRect(QPoint(column.second.first, row.second.first),
+                              QPoint(column.second.second - 1, row.second.second - 1));
+            tiles.append(tile);
+        }
+    }
+    return tiles;
+}
@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef OCRPREPROCESSOR_H
+#define OCRPREPROCESSOR_H
+
+#include <QImage>
+#include <QRect>
+#include <QVector>
+
+/**
+ * @brief OCR 分析前的图片预处理
+ *      文本检测并不需要原图的全部分辨率，完整拷贝大图(5000 万像素约 150MB)并分析耗时很长。
+ *      预处理根据图片中笔画宽度估算文本的尺度，选择整数倍的缩小系数，使笔画宽度不低于检测所需的像素数；
+ *      转换为 RGB888 和区域平均缩小在同一次遍历中完成(SSE2/NEON)。
+ *      缩小后仍然较大的图片拆分为相互重叠的分块，分别分析后按分块的核心区域合并结果，
+ *      避免跨越分块边界的文本重复。坐标按 工作图片坐标 * 缩小系数 映射回原图像素。
+ */
+class OcrPreprocessor
+{
+public:
+    enum Constant {
+        EMinStrokeWidth = 3,        // 缩小后笔画宽度不低于 3 像素
+        EMaxScaleFactor = 8,        // 最大缩小系数
+        EMinWorkingSide = 1280,     // 缩小后长边不低于 1280 像素
+        ETileSize = 2048,           // 分块边长
+        ETileOverlap = 160,         // 相邻分块重叠的像素数，需大于单行文本高度
+    };
+
+    // 分析分块，rect 为分块在工作图片中的区域，core 为合并结果时归属此分块的区域
+    struct Tile {
+        QRect   rect;
+        QRect   core;
+    };
+
+    // 根据 \a image 中的笔画宽度估算缩小系数
+    static int estimateScaleFactor(const QImage &image);
+    // 将 \a image 按 \a factor 倍区域平均缩小，并转换为 RGB888 格式
+    static QImage toWorkingImage(const QImage &image, int factor);
+    // 将大小为 \a size 的工作图片拆分为相互重叠的分块
+    static QVector<Tile> splitTiles(const QSize &size);
+};
+
+#endif // OCRPREPROCESSOR_H
@@ -0,0 +1,123 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "ocrresultcache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+/**
+ * @brief 计算识别引擎 \a engine 及 \a image 像素数据的哈希，仅包含每行的有效像素，不包含行尾的对齐填充
+ */
+static QByteArray hashPixels(const QImage &image, const QString &engine)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    // 以 '\0' 分隔引擎标识与像素数据
+    hash.addData(engine.toUtf8().append('\0'));
+    const int rowBytes = (image.width() * image.depth() + 7) / 8;
+    for (int y = 0; y < image.height(); y++) {
+        hash.addData(reinterpret_cast<const char *>(image.constScanLine(y)), rowBytes);
+    }
+    return hash.result();
+}
+
+OcrResultCache::OcrResultCache()
+{
+    m_cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/ocr";
+    QDir().mkpath(m_cacheDir);
+}
+
+OcrResultCache *OcrResultCache::instance()
+{
+    static OcrResultCache s_cache;
+    return &s_cache;
+}
+
+/**
+ * @return 缓存标识，格式为 哈希_宽x高_像素格式 ，空图片返回空字符串
+ */
+QString OcrResultCache::imageKey(const QImage &image, const QString &engine)
+{
+    if (image.isNull()) {
+        return QString();
+    }
+
+    return QString("%1_%2x%3_%4")
+           .arg(QString::fromLatin1(hashPixels(image, engine).toHex()))
+           .arg(image.width())
+           .arg(image.height())
+           .arg(static_cast<int>(image.format()));
+}
+
+QString OcrResultCache::filePath(const QString &key) const
+{
+    return m_cacheDir + "/" + key;
+}
+
+/**
+ * @brief 读取缓存数据，命中时更新文件修改时间，作为最近访问时间用于移除旧缓存
+ * @return 缓存存在且读取成功时返回 true
+ */
+bool OcrResultCache::load(const QString &key, QByteArray &data)
+{
+    if (key.isEmpty()) {
+        return false;
+    }
+
+    QFile file(filePath(key));
+    if (!file.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+
+    data = file.readAll();
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    return !data.isEmpty();
+}
+
+/**
+ * @brief 写入缓存数据，写入完成后替换缓存文件，并发读取不会读到不完整的数据
+ */
+void OcrResultCache::store(const QString &key, const QByteArray &data)
+{
+    if (key.isEmpty() || data.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker _locker(&m_mutex);
+    QSaveFile file(filePath(key));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "OcrResultCache: open cache file failed," << file.fileName() << file.errorString();
+        return;
+    }
+    if (file.write(data) != data.size() || !file.commit()) {
+        qWarning() << "OcrResultCache: write cache file failed," << file.fileName() << file.errorString();
+        return;
+    }
+
+    evict();
+}
+
+/**
+ * @brief 移除最久未访问的缓存文件，保证缓存总大小不超过 EMaxCacheBytes ，需在加锁后调用
+ */
+void OcrResultCache::evict()
+{
+    QDir dir(m_cacheDir);
+    // 按修改时间排序，最近访问的在前
+    QFileInfoList files = dir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot, QDir::Time);
+    qint64 totalBytes = 0;
+    for (const QFileInfo &file : files) {
+        totalBytes += file.size();
+        if (totalBytes > EMaxCacheBytes) {
+            QFile::remove(file.absoluteFilePath());
+            totalBytes -= file.size();
+        }
+    }
+}
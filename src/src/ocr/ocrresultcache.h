@@ -0,0 +1,50 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef OCRRESULTCACHE_H
+#define OCRRESULTCACHE_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+/**
+ * @brief OCR 识别结果的磁盘缓存
+ *      相同内容的图片再次展示时直接读取缓存的结果，无需重新运行 OCR 驱动。
+ *      缓存标识为识别引擎(插件及模型)标识与图片像素数据的 SHA-1 哈希，加上图片尺寸和格式，
+ *      插件或模型更新后不会命中旧的结果。每条结果保存为缓存目录中的单独文件，内容由调用方序列化。
+ *      缓存总大小超过上限时按最近访问时间移除旧结果。
+ * @threadsafe
+ */
+class OcrResultCache
+{
+public:
+    enum Constant {
+        EMaxCacheBytes = 32 * 1024 * 1024,  // 缓存总大小上限 32MB
+    };
+
+    static OcrResultCache *instance();
+
+    // 根据识别引擎标识 \a engine 及 \a image 的像素内容计算缓存标识
+    static QString imageKey(const QImage &image, const QString &engine);
+
+    // 读取 \a key 对应的缓存数据
+    bool load(const QString &key, QByteArray &data);
+    // 保存 \a key 对应的缓存数据
+    void store(const QString &key, const QByteArray &data);
+
+private:
+    OcrResultCache();
+    Q_DISABLE_COPY(OcrResultCache)
+
+    QString filePath(const QString &key) const;
+    void evict();
+
+private:
+    QString m_cacheDir;     // 缓存目录
+    QMutex  m_mutex;        // 写入及移除缓存文件时加锁
+};
+
+#endif // OCRRESULTCACHE_H
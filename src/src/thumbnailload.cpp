@@ -4,6 +4,72 @@
 
 #include "thumbnailload.h"
 #include "unionimage/unionimage.h"
+#include "unionimage/batchfilereader.h"
+#include "unionimage/imageresampler.h"
+#include "unionimage/ioscheduler.h"
+#include "unionimage/stagingcache.h"
+#include "imageprovider/imageloadpool.h"
+
+#include <QBuffer>
+#include <QFileInfo>
+#include <QScopedPointer>
+
+// 缩略图大小
+static const QSize s_thumbnailSize(100, 100);
+// 批量预读缩略图时按文件大小限制占用的内存：单个文件的大小上限、每批读取的总大小上限
+// (单个文件总能组成一批)及所有批次同时读取的总大小上限，超出的文件由 requestImage() 逐个加载
+static const qint64 s_maxPrefetchFileSize = 16 * 1024 * 1024;
+static const qint64 s_maxPrefetchBatchBytes = 16 * 1024 * 1024;
+static const qint64 s_maxPrefetchBytes = 64 * 1024 * 1024;
+static const int s_prefetchBatchSize = 8;
+
+/**
+ * @return 是否可由内存数据直接解码，与 loadStaticImageFromFile() 中使用 QImageReader 读取的格式一致，
+ *      远程文件需暂存至本地后读取，不在此批量读取。可解码时通过 \a size 返回文件大小
+ */
+static bool canDecodeFromMemory(const QString &path, qint64 *size)
+{
+    static const QSet<QString> s_suffixes {"JPG", "JPEG", "JPE", "PNG", "BMP", "WEBP"};
+
+    QFileInfo info(path);
+    *size = info.size();
+    return s_suffixes.contains(info.suffix().toUpper())
+           && info.size() > 0 && info.size() <= s_maxPrefetchFileSize
+           && !LibUnionImage_NameSpace::StagingCache::needStaging(path);
+}
+
+static QImage loadThumbnailFromFile(const QString &path)
+{
+    QImage Img;
+    QString error;
+    LibUnionImage_NameSpace::loadStaticImageFromFile(path, Img, error);
+    // 保存图片比例缩放
+    return LibUnionImage_NameSpace::ImageResampler::scale(Img, s_thumbnailSize, Qt::KeepAspectRatioByExpanding);
+}
+
+/**
+ * @brief 由内存数据 \a data 解码 \a path 文件的缩略图，JPEG 等格式在解码时直接缩小(短边不小于缩略图大小)
+ */
+static QImage loadThumbnailFromData(const QString &path, QByteArray data)
+{
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer, QFileInfo(path).suffix().toLower().toLatin1());
+    reader.setDecideFormatFromContent(true);
+    reader.setAutoTransform(true);
+
+    const QSize size = reader.size();
+    const int shortSide = qMin(size.width(), size.height());
+    if (shortSide > s_thumbnailSize.width()) {
+        reader.setScaledSize(size * (qreal(s_thumbnailSize.width()) / shortSide) + QSize(1, 1));
+    }
+
+    QImage Img = reader.read();
+    if (Img.isNull()) {
+        return QImage();
+    }
+    return LibUnionImage_NameSpace::ImageResampler::scale(Img, s_thumbnailSize, Qt::KeepAspectRatioByExpanding);
+}
 
 ThumbnailLoad::ThumbnailLoad()
     : QQuickImageProvider(QQuickImageProvider::Image)
@@ -11,32 +77,141 @@ ThumbnailLoad::ThumbnailLoad()
 
 }
 
+/**
+ * @brief 获取缩略图，未缓存时加载文件并生成缩略图。
+ *      加载期间不持有锁，相同文件的并发请求等待同一次加载的结果。
+ */
 QImage ThumbnailLoad::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
 {
     QString tempPath = QUrl(id).toLocalFile();
-    QImage Img;
-    QString error;
 
     QMutexLocker _locker(&m_mutex);
-    if (!m_imgMap.keys().contains(tempPath)) {
-        LibUnionImage_NameSpace::loadStaticImageFromFile(tempPath, Img, error);
-        // 保存图片比例缩放
-        QImage reImg = Img.scaled(100, 100, Qt::KeepAspectRatioByExpanding, Qt::FastTransformation);
-        m_imgMap[tempPath] = reImg;
-        return reImg;
-    } else {
-        return m_imgMap[tempPath];
+    auto itr = m_imgMap.constFind(tempPath);
+    if (itr != m_imgMap.constEnd()) {
+        return itr.value();
+    }
+    _locker.unlock();
+
+    QImage reImg = m_thumbnailFlight.run(tempPath, [&tempPath]() {
+        return loadThumbnailFromFile(tempPath);
+    });
+
+    _locker.relock();
+    m_imgMap[tempPath] = reImg;
+    return reImg;
+}
+
+/**
+ * @brief 通过 BatchFileReader 一次提交多个文件的读取请求，由内存数据解码缩略图，
+ *      避免缩略图栏滚动时逐个文件阻塞读取。已缓存或正在预读的文件被忽略
+ */
+void ThumbnailLoad::prefetchThumbnails(const QStringList &paths)
+{
+    QStringList loadPaths;
+    {
+        QMutexLocker _locker(&m_mutex);
+        for (const QString &path : paths) {
+            QString tempPath = QUrl(path).toLocalFile();
+            if (tempPath.isEmpty() || m_imgMap.contains(tempPath) || m_prefetching.contains(tempPath)) {
+                continue;
+            }
+            loadPaths << tempPath;
+        }
+    }
+
+    // 判断格式及文件大小需要访问文件信息，在锁外进行
+    QStringList candidates;
+    QVector<qint64> sizes;
+    for (const QString &path : loadPaths) {
+        qint64 size = 0;
+        if (canDecodeFromMemory(path, &size)) {
+            candidates << path;
+            sizes << size;
+        }
+    }
+    if (candidates.isEmpty()) {
+        return;
+    }
+
+    // 按文件大小分批，每批不超过 s_maxPrefetchBatchBytes ，所有批次不超过 s_maxPrefetchBytes
+    QMutexLocker _locker(&m_mutex);
+    QStringList group;
+    qint64 groupBytes = 0;
+    auto submitGroup = [this, &group, &groupBytes]() {
+        if (group.isEmpty()) {
+            return;
+        }
+        for (const QString &path : group) {
+            m_prefetching.insert(path);
+        }
+        m_prefetchingBytes += groupBytes;
+
+        const QStringList paths = group;
+        const qint64 bytes = groupBytes;
+        ImageLoadPool::instance()->start(ImageLoadPool::EThumbnail, paths.first(), [this, paths, bytes]() {
+            loadThumbnailBatch(paths, bytes);
+        });
+        group.clear();
+        groupBytes = 0;
+    };
+
+    for (int i = 0; i < candidates.size(); i++) {
+        const qint64 size = sizes.at(i);
+        if (m_prefetchingBytes + groupBytes + size > s_maxPrefetchBytes) {
+            break;
+        }
+        if (group.size() >= s_prefetchBatchSize || groupBytes + size > s_maxPrefetchBatchBytes) {
+            submitGroup();
+        }
+        group << candidates.at(i);
+        groupBytes += size;
+    }
+    submitGroup();
+}
+
+/**
+ * @brief 读取并解码一批文件 \a paths 的缩略图，\a bytes 为提交时统计的文件总大小
+ */
+void ThumbnailLoad::loadThumbnailBatch(const QStringList &paths, qint64 bytes)
+{
+    const auto results = LibUnionImage_NameSpace::BatchFileReader::readFiles(paths, 0);
+    for (const auto &result : results) {
+        {
+            QMutexLocker _locker(&m_mutex);
+            if (m_imgMap.contains(result.path)) {
+                m_prefetching.remove(result.path);
+                continue;
+            }
+        }
+
+        // 与 requestImage() 共享同一文件的加载，内存解码失败时按原方式读取文件
+        QImage reImg = m_thumbnailFlight.run(result.path, [&result]() {
+            QImage Img;
+            if (0 == result.error && !result.data.isEmpty()) {
+                Img = loadThumbnailFromData(result.path, result.data);
+            }
+            return Img.isNull() ? loadThumbnailFromFile(result.path) : Img;
+        });
+
+        QMutexLocker _locker(&m_mutex);
+        m_imgMap[result.path] = reImg;
+        m_prefetching.remove(result.path);
     }
+
+    QMutexLocker _locker(&m_mutex);
+    m_prefetchingBytes -= bytes;
 }
 
 QPixmap ThumbnailLoad::requestPixmap(const QString &id, QSize *size, const QSize &requestedSize)
 {
     QString tempPath = QUrl(id).toLocalFile();
-    QImage Img;
-    QString error;
 
-    QMutexLocker _locker(&m_mutex);
-    LibUnionImage_NameSpace::loadStaticImageFromFile(tempPath, Img, error);
+    QImage Img = m_imageFlight.run(tempPath, [&tempPath]() {
+        QImage Img;
+        QString error;
+        LibUnionImage_NameSpace::loadStaticImageFromFile(tempPath, Img, error);
+        return Img;
+    });
     return QPixmap::fromImage(Img);
 }
 
@@ -68,6 +243,7 @@ LoadImage::LoadImage(QObject *parent) :
     m_pThumbnail = new ThumbnailLoad();
     m_viewLoad = new ViewLoad();
     m_multiLoad = new MultiImageLoad();
+    m_navigationLoad = new NavigationImageLoad(m_viewLoad, m_multiLoad);
 }
 
 double LoadImage::getFitWindowScale(const QString &path, double WindowWidth, double WindowHeight)
@@ -133,6 +309,35 @@ void LoadImage::setReverseHeightWidth(bool b)
     m_bReverseHeightWidth = b;
 }
 
+/**
+ * @brief 设置当前展示的图片 \a path ，当前图片的加载请求优先于相邻图片和缩略图执行
+ */
+void LoadImage::setCurrentImage(const QString &path)
+{
+    ImageLoadPool::instance()->setCurrentImage(path);
+}
+
+/**
+ * @brief 设置缩略图栏中可见的图片 \a paths ，可见缩略图优先于不可见缩略图加载
+ */
+void LoadImage::setVisibleThumbnails(const QStringList &paths)
+{
+    ImageLoadPool::instance()->setVisibleThumbnails(paths);
+    m_pThumbnail->prefetchThumbnails(paths);
+}
+
+/**
+ * @brief 在后台将 \a paths 中的远程(SMB/MTP/PTP)图片暂存到本地，切换至相邻图片时无需等待远程读取
+ */
+void LoadImage::prefetchImages(const QStringList &paths)
+{
+    QStringList localPaths;
+    for (const QString &path : paths) {
+        localPaths.append(QUrl(path).toLocalFile());
+    }
+    LibUnionImage_NameSpace::StagingCache::instance()->prefetch(localPaths);
+}
+
 void LoadImage::loadThumbnail(const QString path)
 {
     QString tempPath = QUrl(path).toLocalFile();
@@ -201,6 +406,7 @@ void LoadImage::onImageFileChanged(const QString &path, bool isMultiImage, bool
     if (isMultiImage) {
         m_multiLoad->removeImageCache(path);
     }
+    m_navigationLoad->removeImageCache(path);
 
     // 判断变更后文件是否存在，若存在，重新加载缩略图(防止文件被替换), 重新获取图像大小信息
     if (isExist) {
@@ -236,46 +442,70 @@ QImage ViewLoad::requestImage(const QString &id, QSize *size, const QSize &reque
 {
     QString tempPath = QUrl(id).toLocalFile();
 
-    QMutexLocker _locker(&m_mutex);
-    if (tempPath == m_currentPath) {
-        if (m_Img.size() != requestedSize && requestedSize.width() > 0 && requestedSize.height() > 0) {
-            m_Img = m_Img.scaled(requestedSize);
-        }
-        return m_Img;
+    QSharedPointer<LibUnionImage_NameSpace::MipmapPyramid> pyramid = currentPyramid(tempPath);
+    if (!pyramid) {
+        pyramid = loadCurrentImage(tempPath);
     }
-    _locker.unlock(); //重新划分临界区，将最费时的图片加载环节移出临界区
 
-    QImage Img;
-    QString error;
-    LibUnionImage_NameSpace::loadStaticImageFromFile(tempPath, Img, error);
+    // 在锁外从不小于请求大小的最近一级缩放，不覆盖原图
+    return pyramid ? pyramid->image(requestedSize) : QImage();
+}
 
-    _locker.relock();
-    m_imgSizes[tempPath] = Img.size() ;
-    m_Img = Img;
-    m_currentPath = tempPath;
-    if (m_Img.size() != requestedSize && requestedSize.width() > 0 && requestedSize.height() > 0) {
-        Img = m_Img.scaled(requestedSize);
+QPixmap ViewLoad::requestPixmap(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    QString tempPath = QUrl(id).toLocalFile();
+
+    QSharedPointer<LibUnionImage_NameSpace::MipmapPyramid> pyramid = currentPyramid(tempPath);
+    if (!pyramid) {
+        pyramid = loadCurrentImage(tempPath);
     }
-    _locker.unlock();
+    return pyramid ? QPixmap::fromImage(pyramid->original()) : QPixmap();
+}
 
-    return Img;
+/**
+ * @return \a path 为当前图片时返回当前图片的金字塔，否则返回空。
+ *      金字塔自身线程安全，临界区仅包含复制指针，生成各级图片及缩放在锁外进行
+ */
+QSharedPointer<LibUnionImage_NameSpace::MipmapPyramid> ViewLoad::currentPyramid(const QString &path)
+{
+    QMutexLocker _locker(&m_mutex);
+    if (path == m_currentPath) {
+        return m_pyramid;
+    }
+    return QSharedPointer<LibUnionImage_NameSpace::MipmapPyramid>();
 }
 
-QPixmap ViewLoad::requestPixmap(const QString &id, QSize *size, const QSize &requestedSize)
+/**
+ * @brief 加载 \a path 文件图片，统一为纹理使用的格式，主视图分块展示时直接使用相同的图片数据和金字塔。
+ *      相同文件的并发请求等待同一次加载的结果
+ */
+QImage ViewLoad::loadImage(const QString &path)
 {
-    QString tempPath = QUrl(id).toLocalFile();
-    QImage Img;
-    QString error;
+    return m_loadFlight.run(path, [&path]() {
+        QImage Img;
+        QString error;
+        LibUnionImage_NameSpace::loadStaticImageFromFile(path, Img, error);
+        return LibUnionImage_NameSpace::MipmapPyramid::normalized(Img);
+    });
+}
+
+/**
+ * @brief 在锁外加载 \a path 文件图片，完成后更新图片大小信息和当前图片。
+ *      多次请求共享同一个 Mipmap 金字塔，不会重复生成
+ * @return 加载图片的金字塔，加载期间当前图片已切换时仍返回该图片的金字塔，加载失败时返回空
+ */
+QSharedPointer<LibUnionImage_NameSpace::MipmapPyramid> ViewLoad::loadCurrentImage(const QString &path)
+{
+    const QImage Img = loadImage(path);
+    QSharedPointer<LibUnionImage_NameSpace::MipmapPyramid> pyramid = LibUnionImage_NameSpace::MipmapPyramid::shared(Img);
 
     QMutexLocker _locker(&m_mutex);
-    if (tempPath == m_currentPath) {
-        return QPixmap::fromImage(m_Img);
+    m_imgSizes[path] = Img.size();
+    if (path != m_currentPath || !m_pyramid) {
+        m_pyramid = pyramid;
+        m_currentPath = path;
     }
-    LibUnionImage_NameSpace::loadStaticImageFromFile(tempPath, Img, error);
-    m_imgSizes[tempPath] = Img.size();
-    m_Img = Img;
-    m_currentPath = tempPath;
-    return QPixmap::fromImage(Img);
+    return pyramid;
 }
 
 int ViewLoad::getImageWidth(const QString &path)
@@ -324,6 +554,7 @@ void ViewLoad::removeImageCache(const QString &path)
     // 为当前展示的图片，移除缓存的信息
     if (tempPath == m_currentPath) {
         m_currentPath.clear();
+        m_pyramid.reset();
     }
 }
 
@@ -336,12 +567,38 @@ void ViewLoad::reloadImageCache(const QString &path)
     QImage Img;
     QString error;
     LibUnionImage_NameSpace::loadStaticImageFromFile(tempPath, Img, error);
+    Img = LibUnionImage_NameSpace::MipmapPyramid::normalized(Img);
 
     QMutexLocker _locker(&m_mutex);
     m_imgSizes[tempPath] = Img.size();
     if (tempPath == m_currentPath) {
-        m_Img = Img;
+        m_pyramid = LibUnionImage_NameSpace::MipmapPyramid::shared(Img);
+    }
+}
+
+/**
+ * @brief 获取 \a path 文件缩小至 \a boundSize 范围内(保持宽高比，不放大)的预览图片。
+ *      为当前图片时从 Mipmap 金字塔中最近的一级缩小，否则加载文件后缩小
+ */
+QImage ViewLoad::requestPreview(const QString &path, const QSize &boundSize)
+{
+    QString tempPath = QUrl(path).toLocalFile();
+    auto fitSize = [&boundSize](const QSize &imageSize) {
+        if (!boundSize.isValid() || (imageSize.width() <= boundSize.width() && imageSize.height() <= boundSize.height())) {
+            return imageSize;
+        }
+        return imageSize.scaled(boundSize, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+    };
+
+    QSharedPointer<LibUnionImage_NameSpace::MipmapPyramid> pyramid = currentPyramid(tempPath);
+    if (!pyramid) {
+        // 和主视图共享加载过程，同时请求相同文件时仅加载一次
+        pyramid = LibUnionImage_NameSpace::MipmapPyramid::shared(loadImage(tempPath));
     }
+    if (!pyramid) {
+        return QImage();
+    }
+    return pyramid->image(fitSize(pyramid->original().size()));
 }
 
 
@@ -388,33 +645,64 @@ QImage MultiImageLoad::requestImage(const QString &id, QSize *size, const QSize
     QString tempPath = QUrl(path).toLocalFile();
     QImage img;
 
-    // 数据变更前加锁
-    QMutexLocker _locker(&m_mutex);
-    if (tempPath != m_imageReader.fileName()
-            || !m_imageReader.canRead()) {
-        // 重新设置图像读取类
-        m_imageReader.setFileName(tempPath);
-    }
-
-    // 获取图像数据
+    // 仅在访问缓存时加锁
     auto key = qMakePair(tempPath, frame);
+    QMutexLocker _locker(&m_mutex);
     bool hasThumbnail = m_imageCache.contains(key);
     if (hasThumbnail && useThumbnail) {
         // 返回缓存缩略图信息
         img = m_imageCache.object(key)->imgThumbnail;
-    } else {
-        if (m_imageReader.jumpToImage(frame)) {
-            // 读取图像数据
-            img = m_imageReader.read();
-            // 判断是否正常读取
-            if (img.isNull()) {
-                return img;
+    }
+    _locker.unlock();
+
+    if (img.isNull()) {
+        // 在锁外读取图像数据，每次读取使用独立的图像读取类，相同帧的并发请求仅读取一次
+        img = m_readFlight.run(key, [this, &tempPath, frame]() {
+            // 远程路径读取本地副本(读取期间持有)，按文件所在设备限制并发读取
+            const LibUnionImage_NameSpace::StagingCache::LocalFile staged(tempPath);
+            QString readPath = staged.path();
+            if (readPath.isEmpty()) {
+                readPath = tempPath;
+            }
+
+            // 未暂存的远程文件仅在读取首个帧时预读，本地文件(含暂存的副本)在读取期间占用设备额度
+            QMutexLocker _locker(&m_mutex);
+            const bool readAhead = m_readAheadFiles.contains(readPath);
+            _locker.unlock();
+            QScopedPointer<LibUnionImage_NameSpace::IoScheduler::Guard> ioGuard;
+            if (!readAhead) {
+                const qint64 size = QFileInfo(readPath).size();
+                if (LibUnionImage_NameSpace::IoScheduler::readAhead(readPath, size)) {
+                    _locker.relock();
+                    m_readAheadFiles.insert(readPath);
+                    _locker.unlock();
+                } else {
+                    ioGuard.reset(new LibUnionImage_NameSpace::IoScheduler::Guard(readPath, size));
+                }
             }
 
-            // 不存在缩略图信息，缓存图片
-            if (!hasThumbnail) {
-                m_imageCache.insert(key, new CacheImage(img));
+            QImageReader reader(readPath);
+            if (!reader.jumpToImage(frame)) {
+                return QImage();
             }
+            return reader.read();
+        });
+        // 判断是否正常读取
+        if (img.isNull()) {
+            return img;
+        }
+
+        // 不存在缩略图信息，缓存图片
+        if (!hasThumbnail) {
+            CacheImage *cache = new CacheImage(img);
+
+            _locker.relock();
+            if (!m_imageCache.contains(key)) {
+                m_imageCache.insert(key, cache);
+            } else {
+                delete cache;
+            }
+            _locker.unlock();
         }
     }
 
@@ -500,6 +788,8 @@ void MultiImageLoad::removeImageCache(const QString &path)
 {
     QString tempPath = QUrl(path).toLocalFile();
     QMutexLocker _locker(&m_mutex);
+    // 文件变更后需重新预读
+    m_readAheadFiles.remove(tempPath);
     // 移除关联的图像
     QList<QPair<QString, int> > keys = m_imageCache.keys();
     for (auto itr = keys.begin(); itr != keys.end(); ++itr) {
@@ -507,16 +797,77 @@ void MultiImageLoad::removeImageCache(const QString &path)
             m_imageCache.remove(*itr);
         }
     }
-    // 移除图像读取类
-    if (m_imageReader.fileName() == tempPath) {
-        m_imageReader.setDevice(nullptr);
-    }
 }
 
 MultiImageLoad::CacheImage::CacheImage(const QImage &img)
 {
     // 缩略图大小
     static const QSize s_ThumbnailSize(100, 100);
-    imgThumbnail = img.scaled(s_ThumbnailSize, Qt::KeepAspectRatioByExpanding, Qt::FastTransformation);
+    imgThumbnail = LibUnionImage_NameSpace::ImageResampler::scale(img, s_ThumbnailSize, Qt::KeepAspectRatioByExpanding);
     originSize = img.size();
 }
+
+
+NavigationImageLoad::NavigationImageLoad(ViewLoad *viewLoad, MultiImageLoad *multiLoad)
+    : QQuickImageProvider(QQuickImageProvider::Image)
+    , m_viewLoad(viewLoad)
+    , m_multiLoad(multiLoad)
+{
+}
+
+/**
+ * @brief 请求缩小至 \a requestedSize 范围内的预览图片，\a id 包含 "#frame_帧号" 时为多页图的指定帧
+ */
+QImage NavigationImageLoad::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    QMutexLocker _locker(&m_mutex);
+    if (id == m_lastId && requestedSize == m_lastSize && !m_lastImage.isNull()) {
+        if (size) {
+            *size = m_lastImage.size();
+        }
+        return m_lastImage;
+    }
+    _locker.unlock();
+
+    const int frameIndex = id.lastIndexOf(QRegExp("#frame_\\d+$"));
+    QString path;
+    QImage img;
+    if (-1 != frameIndex) {
+        // 多页图读取完整帧后缩小
+        path = id.left(frameIndex);
+        QSize frameSize;
+        img = m_multiLoad->requestImage(id, &frameSize, QSize());
+        if (!img.isNull() && requestedSize.isValid()
+                && (img.width() > requestedSize.width() || img.height() > requestedSize.height())) {
+            img = LibUnionImage_NameSpace::ImageResampler::scale(img, requestedSize, Qt::KeepAspectRatio);
+        }
+    } else {
+        path = id;
+        img = m_viewLoad->requestPreview(id, requestedSize);
+    }
+
+    if (size) {
+        *size = img.size();
+    }
+
+    _locker.relock();
+    m_lastId = id;
+    m_lastPath = QUrl(path).toLocalFile();
+    m_lastSize = requestedSize;
+    m_lastImage = img;
+    return img;
+}
+
+/**
+ * @brief 移除缓存的 \a path 文件预览图片，文件变更后重新生成
+ */
+void NavigationImageLoad::removeImageCache(const QString &path)
+{
+    QString tempPath = QUrl(path).toLocalFile();
+    QMutexLocker _locker(&m_mutex);
+    if (tempPath == m_lastPath) {
+        m_lastId.clear();
+        m_lastPath.clear();
+        m_lastImage = QImage();
+    }
+}
@@ -5,12 +5,16 @@
 #ifndef THUMBNAILLOAD_H
 #define THUMBNAILLOAD_H
 
+#include "unionimage/mipmappyramid.h"
+#include "utils/singleflight.h"
+
 #include <QQuickImageProvider>
 #include <QQuickWindow>
 #include <QImageReader>
 #include <QImage>
 #include <QCache>
 #include <QMutex>
+#include <QSet>
 
 class ThumbnailLoad : public QQuickImageProvider
 {
@@ -23,10 +27,21 @@ public:
 
     // 移除缓存的缩略图信息
     void removeImageCache(const QString &path);
+    // 批量预读并生成 \a paths 中尚未缓存的缩略图
+    void prefetchThumbnails(const QStringList &paths);
 
-    QMutex m_mutex;
+    QMutex m_mutex;                     // 仅保护缓存数据，不在加载图片期间持有
     QImage m_Img;                       // 当前图片
     QMap<QString, QImage> m_imgMap;     // 缩略图缓存
+
+private:
+    void loadThumbnailBatch(const QStringList &paths, qint64 bytes);
+
+    QSet<QString> m_prefetching;        // 正在批量预读的文件，由 m_mutex 保护
+    qint64 m_prefetchingBytes = 0;      // 正在批量预读的文件总大小，由 m_mutex 保护
+
+    SingleFlight<QString, QImage> m_thumbnailFlight;    // 合并相同文件的并发缩略图加载
+    SingleFlight<QString, QImage> m_imageFlight;        // 合并相同文件的并发原图加载
 };
 
 class ViewLoad : public QQuickImageProvider
@@ -46,11 +61,23 @@ public:
     void removeImageCache(const QString &path);
     // 重新加载图片大小信息
     void reloadImageCache(const QString &path);
+    // 获取缩小至 \a boundSize 范围内的预览图片
+    QImage requestPreview(const QString &path, const QSize &boundSize);
 
-    QMutex                  m_mutex;
-    QImage                  m_Img;          // 当前图片
+    QMutex                  m_mutex;        // 仅保护以下缓存数据，不在加载、生成及缩放图片期间持有
+    QSharedPointer<LibUnionImage_NameSpace::MipmapPyramid> m_pyramid;   // 当前图片，保留原图，按需生成各级缩小的图片，和主视图共享
     QString                 m_currentPath;  // 加载路径
     QMap<QString, QSize>    m_imgSizes;     // 图片大小
+
+private:
+    // \a path 为当前图片时返回当前图片的金字塔
+    QSharedPointer<LibUnionImage_NameSpace::MipmapPyramid> currentPyramid(const QString &path);
+    // 加载 \a path 文件图片，相同文件的并发请求仅加载一次
+    QImage loadImage(const QString &path);
+    // 加载 \a path 文件图片并更新当前图片
+    QSharedPointer<LibUnionImage_NameSpace::MipmapPyramid> loadCurrentImage(const QString &path);
+
+    SingleFlight<QString, QImage> m_loadFlight;     // 合并相同文件的并发加载
 };
 
 /**
@@ -78,8 +105,9 @@ public:
     void removeImageCache(const QString &path);
 
 private:
-    QMutex              m_mutex;
-    QImageReader        m_imageReader;      // 图像读取类
+    QMutex              m_mutex;            // 仅保护缓存数据，不在读取图像期间持有
+    SingleFlight<QPair<QString, int>, QImage> m_readFlight;     // 合并相同帧的并发读取
+    QSet<QString>       m_readAheadFiles;   // 已预读至页缓存的远程文件，读取其它帧时不再预读
 
     // 缓存图片信息
     struct CacheImage {
@@ -91,6 +119,35 @@ private:
     QCache<QPair<QString, int>, CacheImage> m_imageCache;   // 缩略图缓存(默认最多缓存256组图像)
 };
 
+/**
+ * @brief 导航窗口(NavigationWidget)使用的缩略预览图加载类
+ *      导航窗口仅 150px 宽，加载完整图片由场景图缩小会额外占用一份原图大小的纹理。
+ *      此类按请求大小返回缩小后的图片：普通图片从 ViewLoad 的 Mipmap 金字塔获取，
+ *      多页图缩小指定帧，并缓存最近一次的结果，导航窗口重复显示时无需重新处理。
+ *      \a id 格式与 viewImage 及 multiimage 一致，在 QML 中注册的标识为 "navigationImage"
+ * @warning QQuickImageProvider 派生的接口可能多线程调用，必须保证实现函数是可重入的。
+ */
+class NavigationImageLoad : public QQuickImageProvider
+{
+public:
+    explicit NavigationImageLoad(ViewLoad *viewLoad, MultiImageLoad *multiLoad);
+
+    virtual QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+
+    // 移除缓存的 \a path 文件预览图片
+    void removeImageCache(const QString &path);
+
+private:
+    ViewLoad        *m_viewLoad = nullptr;
+    MultiImageLoad  *m_multiLoad = nullptr;
+
+    QMutex          m_mutex;
+    QString         m_lastId;           // 最近一次请求的标识
+    QString         m_lastPath;         // 最近一次请求的文件路径
+    QSize           m_lastSize;         // 最近一次请求的大小
+    QImage          m_lastImage;        // 最近一次请求的预览图片
+};
+
 class LoadImage : public QObject
 {
     Q_OBJECT
@@ -103,6 +160,7 @@ public:
     ThumbnailLoad   *m_pThumbnail{nullptr};
     ViewLoad        *m_viewLoad{nullptr};
     MultiImageLoad  *m_multiLoad{nullptr};
+    NavigationImageLoad *m_navigationLoad{nullptr};
 
     Q_INVOKABLE double getFitWindowScale(const QString &path, double WindowWidth, double WindowHeight);
     Q_INVOKABLE bool imageIsNull(const QString &path);
@@ -116,6 +174,11 @@ public:
     Q_INVOKABLE void setMultiFrameIndex(int index = Invalid);
     // 设置是否互换宽度高度值(旋转图片时使用)
     Q_INVOKABLE void setReverseHeightWidth(bool b);
+    // 设置当前展示的图片和缩略图栏可见的图片，用于调整图片加载的优先级
+    Q_INVOKABLE void setCurrentImage(const QString &path);
+    Q_INVOKABLE void setVisibleThumbnails(const QStringList &paths);
+    // 后台暂存相邻的远程图片
+    Q_INVOKABLE void prefetchImages(const QStringList &paths);
 
 public slots:
     //加载多张
@@ -0,0 +1,652 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "tiledimageitem.h"
+#include "unionimage/unionimage.h"
+
+#include <QCache>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QLineF>
+#include <QMutex>
+#include <QPointer>
+#include <QQmlEngine>
+#include <QQuickImageProvider>
+#include <QQuickWindow>
+#include <QSGSimpleTextureNode>
+#include <QSet>
+#include <QtConcurrent>
+#include <QtMath>
+
+using LibUnionImage_NameSpace::MipmapPyramid;
+
+/**
+ * @brief 分块的根节点，记录当前展示的各分块节点及预览节点，随节点树一同释放
+ */
+class TileRootNode : public QSGNode
+{
+public:
+    ~TileRootNode() override
+    {
+        // 预览节点未加入节点树时不会随子节点释放
+        if (preview && !preview->parent()) {
+            delete preview;
+        }
+    }
+
+    QHash<TiledImageItem::TileKey, QSGSimpleTextureNode *> tiles;
+    QSGSimpleTextureNode *preview = nullptr;    // 分块未完全覆盖可见区域时在下方展示
+    qint64 zoomKey = 0;                         // 已完整展示的分块缩放比例，缩放过程中沿用
+
+    void clearTiles()
+    {
+        for (QSGSimpleTextureNode *node : tiles) {
+            removeChildNode(node);
+            delete node;
+        }
+        tiles.clear();
+    }
+
+    void clear()
+    {
+        clearTiles();
+        if (preview) {
+            if (preview->parent()) {
+                removeChildNode(preview);
+            }
+            delete preview;
+            preview = nullptr;
+        }
+        zoomKey = 0;
+    }
+};
+
+/**
+ * @brief 分块缓存，在渲染线程和生成分块的工作线程之间共享，组件释放后由未完成的任务持有
+ * @threadsafe 除 item 外的数据由 mutex 保护
+ */
+class TileStore
+{
+public:
+    QMutex                                  mutex;
+    int                                     generation = 0; // 图片或采样方式变更时递增，丢弃旧的生成结果
+    QCache<TiledImageItem::TileKey, QImage> tiles;          // 已生成的分块，生成失败的分块记录为空图片
+    QSet<TiledImageItem::TileKey>           pending;        // 等待生成的分块，移出视口时移除
+    QPointer<TiledImageItem>                item;           // 仅在 GUI 线程访问
+};
+
+uint qHash(const TiledImageItem::TileKey &key, uint seed)
+{
+    return qHash(key.zoom, seed) ^ qHash(key.column, seed) ^ (qHash(key.row, seed) << 1);
+}
+
+static QSize zoomedImageSize(const QSize &imageSize, qreal zoom)
+{
+    return QSize(qCeil(imageSize.width() * zoom), qCeil(imageSize.height() * zoom));
+}
+
+/**
+ * @brief 在工作线程中统一图片格式并生成全部各级图片，获取和图片提供者共享的金字塔，
+ *      图片已是 32 位格式时不复制。渲染线程和 GUI 线程中仅查找已生成的各级图片
+ */
+static QSharedPointer<MipmapPyramid> preparePyramid(const QImage &image)
+{
+    QSharedPointer<MipmapPyramid> pyramid = MipmapPyramid::shared(MipmapPyramid::normalized(image));
+    if (pyramid) {
+        pyramid->buildLevels(QSize(1, 1));
+    }
+    return pyramid;
+}
+
+/**
+ * @brief 在工作线程加载图片，通过图片提供者 \a provider 请求 \a id 对应的原始大小图片，
+ *      \a provider 为空时读取本地文件 \a path
+ */
+static QSharedPointer<MipmapPyramid> loadImage(QQuickImageProvider *provider, const QString &id, const QString &path)
+{
+    QImage image;
+    if (provider) {
+        QSize size;
+        image = provider->requestImage(id, &size, QSize());
+    } else {
+        QString error;
+        LibUnionImage_NameSpace::loadStaticImageFromFile(path, image, error);
+    }
+    return preparePyramid(image);
+}
+
+/**
+ * @brief 生成分块 \a key 的图片，分块标识中的缩放比例为每个源图片像素对应的设备像素数。
+ *      放大时从原图最近邻采样，保持像素清晰；缩小时从不小于当前分辨率的 Mipmap 级采样，缩小比例不超过 2 倍，
+ *      \a smooth 为 true 时双线性插值，否则最近邻采样
+ */
+static QImage renderTile(MipmapPyramid *pyramid, const TiledImageItem::TileKey &key, bool smooth)
+{
+    const QImage original = pyramid->original();
+    const qreal zoom = qreal(key.zoom) / TiledImageItem::EZoomPrecision;
+    const QSize zoomedSize = zoomedImageSize(original.size(), zoom);
+    const int left = key.column * TiledImageItem::ETileSize;
+    const int top = key.row * TiledImageItem::ETileSize;
+    const int tileWidth = qMin(int(TiledImageItem::ETileSize), zoomedSize.width() - left);
+    const int tileHeight = qMin(int(TiledImageItem::ETileSize), zoomedSize.height() - top);
+    if (original.isNull() || tileWidth <= 0 || tileHeight <= 0) {
+        return QImage();
+    }
+
+    const QImage source = zoom >= 1.0 ? original : pyramid->levelForScale(zoom);
+    if (source.isNull()) {
+        return QImage();
+    }
+
+    // 设备像素到采样图片像素的比例
+    const qreal stepX = source.width() / (original.width() * zoom);
+    const qreal stepY = source.height() / (original.height() * zoom);
+    const int maxX = source.width() - 1;
+    const int maxY = source.height() - 1;
+
+    QImage tile(tileWidth, tileHeight, source.format());
+    if (tile.isNull()) {
+        return QImage();
+    }
+
+    if (!smooth || zoom >= 1.0) {
+        QVector<int> columns(tileWidth);
+        for (int x = 0; x < tileWidth; x++) {
+            columns[x] = qMin(maxX, int((left + x + 0.5) * stepX));
+        }
+        for (int y = 0; y < tileHeight; y++) {
+            const int sourceY = qMin(maxY, int((top + y + 0.5) * stepY));
+            const quint32 *in = reinterpret_cast<const quint32 *>(source.constScanLine(sourceY));
+            quint32 *out = reinterpret_cast<quint32 *>(tile.scanLine(y));
+            for (int x = 0; x < tileWidth; x++) {
+                out[x] = in[columns[x]];
+            }
+        }
+        return tile;
+    }
+
+    // 双线性插值，权重为 8 位定点数
+    QVector<int> columns(tileWidth);
+    QVector<int> weightsX(tileWidth);
+    for (int x = 0; x < tileWidth; x++) {
+        const qreal sourceX = qBound(0.0, (left + x + 0.5) * stepX - 0.5, qreal(maxX));
+        columns[x] = qMin(int(sourceX), qMax(0, maxX - 1));
+        weightsX[x] = qRound((sourceX - columns[x]) * 256);
+    }
+    const int nextColumn = maxX > 0 ? 1 : 0;
+
+    for (int y = 0; y < tileHeight; y++) {
+        const qreal sourceY = qBound(0.0, (top + y + 0.5) * stepY - 0.5, qreal(maxY));
+        const int row = qMin(int(sourceY), qMax(0, maxY - 1));
+        const int weightY = qRound((sourceY - row) * 256);
+        const uchar *row0 = source.constScanLine(row);
+        const uchar *row1 = source.constScanLine(qMin(row + 1, maxY));
+        uchar *out = tile.scanLine(y);
+
+        for (int x = 0; x < tileWidth; x++) {
+            const uchar *p00 = row0 + columns[x] * 4;
+            const uchar *p01 = p00 + nextColumn * 4;
+            const uchar *p10 = row1 + columns[x] * 4;
+            const uchar *p11 = p10 + nextColumn * 4;
+            const int wx = weightsX[x];
+            for (int c = 0; c < 4; c++) {
+                const int top0 = p00[c] * (256 - wx) + p01[c] * wx;
+                const int bottom0 = p10[c] * (256 - wx) + p11[c] * wx;
+                out[x * 4 + c] = static_cast<uchar>((top0 * (256 - weightY) + bottom0 * weightY + (1 << 15)) >> 16);
+            }
+        }
+    }
+
+    return tile;
+}
+
+/**
+ * @brief 在工作线程生成分块 \a key ，完成后写入缓存并通知组件更新。
+ *      排队期间分块移出视口或图片已切换( \a generation 变更)时不再生成
+ */
+static void renderTileJob(const QSharedPointer<TileStore> &store, const QSharedPointer<MipmapPyramid> &pyramid,
+                          int generation, const TiledImageItem::TileKey &key, bool smooth)
+{
+    {
+        QMutexLocker _locker(&store->mutex);
+        if (generation != store->generation || !store->pending.contains(key)) {
+            return;
+        }
+    }
+
+    const QImage tile = renderTile(pyramid.data(), key, smooth);
+
+    QMutexLocker _locker(&store->mutex);
+    if (generation != store->generation) {
+        return;
+    }
+    store->pending.remove(key);
+    store->tiles.insert(key, new QImage(tile), qMax(1, int(tile.sizeInBytes() / 1024)));
+    _locker.unlock();
+
+    QMetaObject::invokeMethod(qApp, [store]() {
+        if (store->item) {
+            store->item->update();
+        }
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @return 分块 \a key 的节点区域，按分块自身的缩放比例计算，和当前缩放比例不同时按比例缩放展示。
+ *      \a unit 为每个源图片像素对应的本地坐标单位
+ */
+static QRectF tileNodeRect(const TiledImageItem::TileKey &key, const QSize &textureSize, const QRectF &painted, qreal unit)
+{
+    const qreal pixelSize = unit * TiledImageItem::EZoomPrecision / key.zoom;
+    return QRectF(painted.x() + key.column * TiledImageItem::ETileSize * pixelSize,
+                  painted.y() + key.row * TiledImageItem::ETileSize * pixelSize,
+                  textureSize.width() * pixelSize, textureSize.height() * pixelSize);
+}
+
+TiledImageItem::TiledImageItem(QQuickItem *parent)
+    : QQuickItem(parent)
+    , m_store(new TileStore)
+{
+    setFlag(ItemHasContents, true);
+    m_store->tiles.setMaxCost(ETileCacheBytes / 1024);
+    m_store->item = this;
+
+    m_zoomTimer.setSingleShot(true);
+    m_zoomTimer.setInterval(EZoomSettleInterval);
+    connect(&m_zoomTimer, &QTimer::timeout, this, [this]() {
+        m_zooming = false;
+        update();
+    });
+
+    connect(&m_loadWatcher, &QFutureWatcherBase::finished, this, &TiledImageItem::onImageLoaded);
+    // 平移、缩放、旋转时可见区域变更，重新计算可见分块
+    connect(this, &QQuickItem::xChanged, this, &QQuickItem::update);
+    connect(this, &QQuickItem::yChanged, this, &QQuickItem::update);
+    connect(this, &QQuickItem::scaleChanged, this, &TiledImageItem::onZoomChanged);
+    connect(this, &QQuickItem::rotationChanged, this, &QQuickItem::update);
+    // 采样方式变更，重新生成分块
+    connect(this, &QQuickItem::smoothChanged, this, [this]() {
+        resetTiles();
+        update();
+    });
+}
+
+TiledImageItem::~TiledImageItem()
+{
+    cancelResponse();
+
+    // 排队中的分块任务不再生成
+    QMutexLocker _locker(&m_store->mutex);
+    m_store->generation++;
+    m_store->pending.clear();
+}
+
+QUrl TiledImageItem::source() const
+{
+    return m_source;
+}
+
+/**
+ * @brief 设置图片 \a source ，在后台线程加载，加载完成前展示空白
+ */
+void TiledImageItem::setSource(const QUrl &source)
+{
+    if (m_source == source) {
+        return;
+    }
+
+    m_source = source;
+    m_pyramid.reset();
+    m_preview = QImage();
+    m_imageSize = QSize();
+    resetTiles();
+
+    if (isComponentComplete()) {
+        load();
+    }
+
+    Q_EMIT sourceChanged();
+    Q_EMIT sourceSizeChanged();
+    Q_EMIT paintedGeometryChanged();
+    update();
+}
+
+TiledImageItem::Status TiledImageItem::status() const
+{
+    return m_status;
+}
+
+QSize TiledImageItem::sourceSize() const
+{
+    return m_imageSize;
+}
+
+qreal TiledImageItem::paintedWidth() const
+{
+    return paintedRect().width();
+}
+
+qreal TiledImageItem::paintedHeight() const
+{
+    return paintedRect().height();
+}
+
+/**
+ * @brief 更新可见区域的分块节点。每个分块为屏幕分辨率的纹理，节点按本地坐标放置，
+ *      经过组件的缩放变换后与设备像素一一对应。缺少的分块提交到工作线程生成，
+ *      生成完成前展示其他缩放比例的分块及预览图片。
+ * @note 调用时 GUI 线程阻塞，可读取组件数据
+ */
+QSGNode *TiledImageItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data)
+{
+    Q_UNUSED(data)
+    TileRootNode *root = static_cast<TileRootNode *>(oldNode);
+    if (m_imageChanged) {
+        if (root) {
+            root->clear();
+        }
+        m_imageChanged = false;
+    }
+
+    const QRectF painted = paintedRect();
+    if (!m_pyramid || painted.isEmpty() || !window() || !parentItem()) {
+        delete root;
+        return nullptr;
+    }
+    if (!root) {
+        root = new TileRootNode;
+    }
+
+    // 每个本地坐标单位对应的设备像素数，包含组件及父组件的缩放
+    const qreal deviceScale = QLineF(mapToScene(QPointF(0, 0)), mapToScene(QPointF(1, 0))).length()
+                              * window()->effectiveDevicePixelRatio();
+    // 每个源图片像素对应的设备像素数
+    const qreal zoom = deviceScale * painted.width() / m_imageSize.width();
+    if (deviceScale <= 0 || zoom <= 0) {
+        root->clear();
+        return root;
+    }
+    // 每个源图片像素对应的本地坐标单位
+    const qreal unit = painted.width() / m_imageSize.width();
+    // 放大(不低于 100%)时始终最近邻采样，smooth 仅影响缩小时的采样
+    const QSGTexture::Filtering filtering = smooth() && zoom < 1.0 ? QSGTexture::Linear : QSGTexture::Nearest;
+
+    // 缩放过程中沿用已完整展示的缩放比例，仅使用缓存的分块；缩放停止后生成当前比例的分块
+    const qint64 zoomKey = m_zooming ? root->zoomKey : qMax<qint64>(1, qRound64(zoom * EZoomPrecision));
+
+    // 父组件裁剪区域内可见的图片区域
+    const QRectF visible = mapRectFromItem(parentItem(), parentItem()->boundingRect()).intersected(painted);
+    QSet<TileKey> visibleKeys;
+    QVector<TileKey> missingKeys;
+    if (zoomKey > 0 && !visible.isEmpty()) {
+        // 转换为该缩放比例下图片的设备像素坐标
+        const qreal tileZoom = qreal(zoomKey) / EZoomPrecision;
+        const QSize zoomedSize = zoomedImageSize(m_imageSize, tileZoom);
+        const QRectF deviceRect((visible.x() - painted.x()) / unit * tileZoom, (visible.y() - painted.y()) / unit * tileZoom,
+                                visible.width() / unit * tileZoom, visible.height() / unit * tileZoom);
+        const int firstColumn = qMax(0, qFloor(deviceRect.left() / ETileSize));
+        const int firstRow = qMax(0, qFloor(deviceRect.top() / ETileSize));
+        const int lastColumn = qMin(qCeil(deviceRect.right() / ETileSize), (zoomedSize.width() + ETileSize - 1) / ETileSize);
+        const int lastRow = qMin(qCeil(deviceRect.bottom() / ETileSize), (zoomedSize.height() + ETileSize - 1) / ETileSize);
+
+        TileKey key;
+        key.zoom = zoomKey;
+        for (key.row = firstRow; key.row < lastRow; key.row++) {
+            for (key.column = firstColumn; key.column < lastColumn; key.column++) {
+                visibleKeys.insert(key);
+                if (!root->tiles.contains(key)) {
+                    missingKeys.append(key);
+                }
+            }
+        }
+    }
+
+    // 从缓存中取出已生成的分块，未生成的分块提交到工作线程
+    QVector<QPair<TileKey, QImage>> readyTiles;
+    {
+        QMutexLocker _locker(&m_store->mutex);
+        for (const TileKey &key : missingKeys) {
+            QImage *cached = m_store->tiles.object(key);
+            if (cached) {
+                readyTiles.append(qMakePair(key, *cached));
+            } else if (!m_zooming && !m_store->pending.contains(key)) {
+                m_store->pending.insert(key);
+                QtConcurrent::run(renderTileJob, m_store, m_pyramid, m_store->generation, key, smooth());
+            }
+        }
+
+        // 移出视口的分块不再生成
+        for (auto itr = m_store->pending.begin(); itr != m_store->pending.end();) {
+            if (!visibleKeys.contains(*itr)) {
+                itr = m_store->pending.erase(itr);
+            } else {
+                ++itr;
+            }
+        }
+    }
+
+    for (const QPair<TileKey, QImage> &tile : readyTiles) {
+        if (tile.second.isNull()) {
+            continue;
+        }
+        QSGSimpleTextureNode *node = new QSGSimpleTextureNode;
+        node->setOwnsTexture(true);
+        node->setTexture(window()->createTextureFromImage(tile.second));
+        // 后加入的节点绘制在上层，覆盖其他缩放比例的分块
+        root->appendChildNode(node);
+        root->tiles.insert(tile.first, node);
+    }
+
+    // 可见区域的分块均已生成
+    const bool complete = zoomKey > 0 && readyTiles.size() == missingKeys.size();
+    if (complete) {
+        root->zoomKey = zoomKey;
+    }
+
+    // 组件大小变更时图片展示区域可能移动，每次更新分块位置。
+    // 当前比例的分块展示完整后，移除其他比例的分块；其他比例的分块仅保留可见的部分
+    for (auto itr = root->tiles.begin(); itr != root->tiles.end();) {
+        QSGSimpleTextureNode *node = itr.value();
+        const bool current = itr.key().zoom == zoomKey;
+        const QRectF rect = tileNodeRect(itr.key(), node->texture()->textureSize(), painted, unit);
+        if (current ? !visibleKeys.contains(itr.key()) : (complete || !rect.intersects(visible))) {
+            root->removeChildNode(node);
+            delete node;
+            itr = root->tiles.erase(itr);
+            continue;
+        }
+
+        node->setRect(rect);
+        // 当前比例的分块与设备像素一一对应，无需插值
+        node->setFiltering(current && !m_zooming ? QSGTexture::Nearest : filtering);
+        ++itr;
+    }
+
+    // 分块未完全覆盖可见区域时，在最下层展示按比例缩放的预览图片
+    if (!complete && !m_preview.isNull()) {
+        if (!root->preview) {
+            root->preview = new QSGSimpleTextureNode;
+            root->preview->setOwnsTexture(true);
+            root->preview->setTexture(window()->createTextureFromImage(m_preview));
+        }
+        if (!root->preview->parent()) {
+            root->prependChildNode(root->preview);
+        }
+        root->preview->setRect(painted);
+        root->preview->setFiltering(filtering);
+    } else if (root->preview && root->preview->parent()) {
+        root->removeChildNode(root->preview);
+    }
+
+    return root;
+}
+
+void TiledImageItem::geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChanged(newGeometry, oldGeometry);
+    if (newGeometry.size() != oldGeometry.size()) {
+        Q_EMIT paintedGeometryChanged();
+        // 展示区域大小变更，缩放比例随之变更
+        onZoomChanged();
+    }
+    update();
+}
+
+void TiledImageItem::componentComplete()
+{
+    QQuickItem::componentComplete();
+    load();
+}
+
+/**
+ * @brief 在后台线程加载当前图片，image:// 格式的图片通过 QML 引擎中注册的图片提供者请求，
+ *      异步图片提供者的请求在其调度的线程中执行
+ */
+void TiledImageItem::load()
+{
+    cancelResponse();
+    if (m_source.isEmpty()) {
+        m_loadWatcher.setFuture(QFuture<QSharedPointer<MipmapPyramid>>());
+        setStatus(Null);
+        return;
+    }
+
+    QQuickImageProvider *provider = nullptr;
+    QString id;
+    QString path;
+    if (m_source.scheme() == QLatin1String("image")) {
+        QQmlEngine *engine = qmlEngine(this);
+        QQmlImageProviderBase *base = engine ? engine->imageProvider(m_source.host()) : nullptr;
+        // 和 QQuickPixmap 一致，移除 "image://provider/" 前缀
+        id = m_source.toString(QUrl::RemoveScheme | QUrl::RemoveAuthority).mid(1);
+
+        if (base && base->imageType() == QQmlImageProviderBase::ImageResponse) {
+            m_loadWatcher.setFuture(QFuture<QSharedPointer<MipmapPyramid>>());
+            setStatus(Loading);
+            m_response = static_cast<QQuickAsyncImageProvider *>(base)->requestImageResponse(id, QSize());
+            connect(m_response, &QQuickImageResponse::finished, m_response, &QObject::deleteLater);
+            connect(m_response, &QQuickImageResponse::finished, this, &TiledImageItem::onResponseFinished);
+            return;
+        }
+
+        if (!base || base->imageType() != QQmlImageProviderBase::Image) {
+            qWarning() << "TiledImageItem: unsupported image provider," << m_source;
+            m_loadWatcher.setFuture(QFuture<QSharedPointer<MipmapPyramid>>());
+            setStatus(Error);
+            return;
+        }
+        provider = static_cast<QQuickImageProvider *>(base);
+    } else {
+        path = m_source.isLocalFile() ? m_source.toLocalFile() : m_source.toString();
+    }
+
+    setStatus(Loading);
+    m_loadWatcher.setFuture(QtConcurrent::run(loadImage, provider, id, path));
+}
+
+void TiledImageItem::setStatus(Status status)
+{
+    if (m_status != status) {
+        m_status = status;
+        Q_EMIT statusChanged();
+    }
+}
+
+/**
+ * @brief 取消未完成的异步请求，请求对象在发送 finished() 后自行释放
+ */
+void TiledImageItem::cancelResponse()
+{
+    if (m_response) {
+        disconnect(m_response, nullptr, this, nullptr);
+        m_response->cancel();
+        m_response = nullptr;
+    }
+}
+
+/**
+ * @brief 异步请求完成，在后台线程生成金字塔后由 onImageLoaded() 更新
+ */
+void TiledImageItem::onResponseFinished()
+{
+    QQuickImageResponse *response = m_response;
+    m_response = nullptr;
+    if (!response) {
+        return;
+    }
+
+    QImage image;
+    QQuickTextureFactory *factory = response->textureFactory();
+    if (factory) {
+        image = factory->image();
+        delete factory;
+    }
+
+    if (image.isNull()) {
+        qWarning() << "TiledImageItem: load image failed," << m_source << response->errorString();
+        setStatus(Error);
+        return;
+    }
+
+    m_loadWatcher.setFuture(QtConcurrent::run(preparePyramid, image));
+}
+
+void TiledImageItem::onImageLoaded()
+{
+    // 切换图片源时设置的空任务，无加载结果
+    if (m_loadWatcher.isCanceled() || 0 == m_loadWatcher.future().resultCount()) {
+        return;
+    }
+
+    const QSharedPointer<MipmapPyramid> pyramid = m_loadWatcher.result();
+    if (!pyramid) {
+        setStatus(Error);
+        return;
+    }
+
+    m_pyramid = pyramid;
+    m_imageSize = pyramid->original().size();
+    // 长边不小于 EPreviewSize 的一级，已在加载时生成
+    m_preview = pyramid->levelForScale(qMin(1.0, qreal(EPreviewSize) / qMax(m_imageSize.width(), m_imageSize.height())));
+    resetTiles();
+    Q_EMIT sourceSizeChanged();
+    Q_EMIT paintedGeometryChanged();
+    setStatus(Ready);
+    update();
+}
+
+/**
+ * @return 按 PreserveAspectFit 方式计算的图片展示区域
+ */
+QRectF TiledImageItem::paintedRect() const
+{
+    if (m_imageSize.isEmpty() || width() <= 0 || height() <= 0) {
+        return QRectF();
+    }
+
+    QSizeF paintedSize = QSizeF(m_imageSize).scaled(size(), Qt::KeepAspectRatio);
+    return QRectF(QPointF((width() - paintedSize.width()) / 2, (height() - paintedSize.height()) / 2), paintedSize);
+}
+
+/**
+ * @brief 缩放比例变更，缩放过程中不生成新的分块，停止 EZoomSettleInterval 后生成当前比例的分块
+ */
+void TiledImageItem::onZoomChanged()
+{
+    m_zooming = true;
+    m_zoomTimer.start();
+    update();
+}
+
+/**
+ * @brief 图片或采样方式变更，丢弃已生成及正在生成的分块，已展示的分块在下次更新时清除
+ */
+void TiledImageItem::resetTiles()
+{
+    QMutexLocker _locker(&m_store->mutex);
+    m_store->generation++;
+    m_store->tiles.clear();
+    m_store->pending.clear();
+    m_imageChanged = true;
+}
@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TILEDIMAGEITEM_H
+#define TILEDIMAGEITEM_H
+
+#include "unionimage/mipmappyramid.h"
+
+#include <QFutureWatcher>
+#include <QQuickItem>
+#include <QTimer>
+#include <QUrl>
+
+class QQuickImageResponse;
+class TileStore;
+
+/**
+ * @brief 按视口分块绘制的图片展示组件，替代主视图的 QML Image
+ *      Image 将整张图片作为纹理，由场景图按 scale 缩放绘制。放大至 2000% 时仅有很小的区域可见，
+ *      在软件渲染(无 GPU 的云桌面)下缩放整张纹理耗时很长。
+ *      此组件仅绘制父组件裁剪区域内可见的部分，按屏幕分辨率分块(Tile)生成纹理：
+ *      放大(不低于 100%)时从原图最近邻采样，保持像素清晰；缩小时从 Mipmap 金字塔中不小于屏幕分辨率的一级采样，
+ *      smooth 为 true 时双线性插值，否则最近邻采样。
+ *      分块在工作线程生成，完成后替换展示，渲染线程仅创建纹理；已生成的分块被缓存，平移时仅生成新进入视口的分块。
+ *      缩放过程中不生成分块，沿用已生成的分块及低分辨率的预览图按比例缩放展示，缩放停止后生成当前比例的分块。
+ *      图片按 PreserveAspectFit 方式居中展示，source 支持 image:// 图片提供者及本地文件。
+ *      在 QML 中注册为 TiledImageView
+ */
+class TiledImageItem : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QUrl source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(Status status READ status NOTIFY statusChanged)
+    Q_PROPERTY(QSize sourceSize READ sourceSize NOTIFY sourceSizeChanged)
+    Q_PROPERTY(qreal paintedWidth READ paintedWidth NOTIFY paintedGeometryChanged)
+    Q_PROPERTY(qreal paintedHeight READ paintedHeight NOTIFY paintedGeometryChanged)
+
+public:
+    // 和 QML Image.status 取值保持一致
+    enum Status {
+        Null,
+        Ready,
+        Loading,
+        Error
+    };
+    Q_ENUM(Status)
+
+    enum Constant {
+        ETileSize = 256,                        // 分块边长(设备像素)
+        ETileCacheBytes = 64 * 1024 * 1024,     // 分块缓存上限 64MB
+        EZoomPrecision = 65536,                 // 分块标识中缩放比例的定点数精度
+        EZoomSettleInterval = 150,              // 缩放停止 150ms 后生成当前比例的分块
+        EPreviewSize = 1024,                    // 分块生成完成前展示的预览图片最小边长
+    };
+
+    explicit TiledImageItem(QQuickItem *parent = nullptr);
+    ~TiledImageItem() override;
+
+    QUrl source() const;
+    void setSource(const QUrl &source);
+
+    Status status() const;
+    QSize sourceSize() const;
+    qreal paintedWidth() const;
+    qreal paintedHeight() const;
+
+    // 分块标识，缩放比例按定点数量化
+    struct TileKey {
+        qint64  zoom = 0;
+        int     column = 0;
+        int     row = 0;
+
+        bool operator==(const TileKey &other) const
+        {
+            return zoom == other.zoom && column == other.column && row == other.row;
+        }
+    };
+
+Q_SIGNALS:
+    void sourceChanged();
+    void statusChanged();
+    void sourceSizeChanged();
+    void paintedGeometryChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+    void geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+    void componentComplete() override;
+
+private:
+    void load();
+    void setStatus(Status status);
+    void cancelResponse();
+    void onResponseFinished();
+    void onImageLoaded();
+    void onZoomChanged();
+    void resetTiles();
+    QRectF paintedRect() const;
+
+private:
+    QUrl                    m_source;
+    Status                  m_status = Null;
+    QFutureWatcher<QSharedPointer<LibUnionImage_NameSpace::MipmapPyramid>> m_loadWatcher;   // 后台加载图片并生成金字塔
+    QQuickImageResponse     *m_response = nullptr;  // 异步图片提供者的请求
+    QTimer                  m_zoomTimer;        // 缩放停止后生成当前比例的分块
+
+    // 以下数据在 GUI 线程设置，在 updatePaintNode() (GUI 线程阻塞)中读取
+    QSharedPointer<LibUnionImage_NameSpace::MipmapPyramid> m_pyramid;  // 和图片提供者共享
+    QImage                  m_preview;          // 分块生成完成前展示的低分辨率图片，为金字塔中的一级
+    QSize                   m_imageSize;
+    bool                    m_imageChanged = false;     // 需要清除已展示的分块
+    bool                    m_zooming = false;          // 正在缩放，不生成新的分块
+
+    QSharedPointer<TileStore> m_store;          // 分块缓存，和生成分块的工作线程共享
+};
+
+uint qHash(const TiledImageItem::TileKey &key, uint seed = 0);
+
+#endif // TILEDIMAGEITEM_H
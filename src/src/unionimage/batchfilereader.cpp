@@ -0,0 +1,482 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "batchfilereader.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QtConcurrent>
+
+#include <numeric>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define UNIONIMAGE_HAS_IO_URING
+#endif
+
+namespace LibUnionImage_NameSpace {
+
+namespace {
+
+// 单个读取请求的状态
+struct ReadRequest {
+    int     fd = -1;
+    qint64  target = 0;     // 需要读取的长度
+    qint64  done = 0;       // 已读取的长度
+    iovec   iov;            // io_uring 读取使用的缓冲区
+};
+
+/**
+ * @brief 打开文件 \a request 并根据文件大小分配缓冲区
+ * @return 是否需要读取数据
+ */
+bool prepareRequest(BatchFileReader::Result &result, ReadRequest &request, qint64 length)
+{
+    request.fd = ::open(QFile::encodeName(result.path).constData(), O_RDONLY | O_CLOEXEC | O_NOCTTY);
+    if (-1 == request.fd) {
+        result.error = errno;
+        return false;
+    }
+
+    struct stat st;
+    if (0 != fstat(request.fd, &st)) {
+        result.error = errno;
+        return false;
+    }
+
+    // QByteArray 的长度为 int ，限制单个文件的读取长度
+    if (length <= 0 && st.st_size > BatchFileReader::EMaxReadSize) {
+        result.error = EFBIG;
+        return false;
+    }
+    request.target = length > 0 ? qMin<qint64>(qMin<qint64>(length, BatchFileReader::EMaxReadSize), st.st_size)
+                                : st.st_size;
+    if (request.target <= 0) {
+        return false;
+    }
+
+    result.data.resize(static_cast<int>(request.target));
+    return true;
+}
+
+void finishRequest(BatchFileReader::Result &result, ReadRequest &request)
+{
+    if (-1 != request.fd) {
+        ::close(request.fd);
+        request.fd = -1;
+    }
+    if (request.done < result.data.size()) {
+        result.data.truncate(static_cast<int>(request.done));
+    }
+}
+
+/**
+ * @brief 线程池读取，io_uring 不可用时使用
+ */
+void readFilesByThreadPool(QVector<BatchFileReader::Result> &results, qint64 length)
+{
+    QVector<int> indexes(results.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+
+    QtConcurrent::blockingMap(indexes, [&results, length](int index) {
+        BatchFileReader::Result &result = results[index];
+        ReadRequest request;
+        if (prepareRequest(result, request, length)) {
+            while (request.done < request.target) {
+                ssize_t len = pread(request.fd, result.data.data() + request.done,
+                                    static_cast<size_t>(request.target - request.done), request.done);
+                if (len < 0 && EINTR == errno) {
+                    continue;
+                }
+                if (len < 0) {
+                    result.error = errno;
+                    break;
+                }
+                if (0 == len) {
+                    break;
+                }
+                request.done += len;
+            }
+        }
+        finishRequest(result, request);
+    });
+}
+
+#ifdef UNIONIMAGE_HAS_IO_URING
+
+/**
+ * @brief io_uring 的简单封装，直接使用系统调用，不依赖 liburing
+ */
+class IoUring
+{
+public:
+    explicit IoUring(unsigned entries)
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        m_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (m_fd < 0) {
+            m_fd = -1;
+            return;
+        }
+
+        m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+#ifdef IORING_FEAT_SINGLE_MMAP
+        // 5.4 以上内核提交队列及完成队列共用一次映射
+        bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+#else
+        bool singleMmap = false;
+#endif
+        if (singleMmap) {
+            m_sqRingSize = m_cqRingSize = qMax(m_sqRingSize, m_cqRingSize);
+        }
+
+        m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+        if (MAP_FAILED == m_sqRing) {
+            m_sqRing = nullptr;
+            release();
+            return;
+        }
+        if (singleMmap) {
+            m_cqRing = m_sqRing;
+        } else {
+            m_cqRing = mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+            if (MAP_FAILED == m_cqRing) {
+                m_cqRing = nullptr;
+                release();
+                return;
+            }
+        }
+
+        m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+        if (MAP_FAILED == sqes) {
+            release();
+            return;
+        }
+        m_sqes = static_cast<io_uring_sqe *>(sqes);
+
+        char *sq = static_cast<char *>(m_sqRing);
+        m_sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        m_sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        m_sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+        char *cq = static_cast<char *>(m_cqRing);
+        m_cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        m_cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        m_cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+        m_entries = params.sq_entries;
+    }
+
+    ~IoUring()
+    {
+        release();
+    }
+
+    bool isValid() const
+    {
+        return nullptr != m_sqes;
+    }
+
+    unsigned entries() const
+    {
+        return m_entries;
+    }
+
+    // 添加读取请求到提交队列，需调用 submitAndWait() 提交
+    void prepareRead(ReadRequest &request, quint64 userData)
+    {
+        unsigned tail = *m_sqTail + m_pending;
+        unsigned index = tail & m_sqMask;
+        io_uring_sqe *sqe = &m_sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        // 使用 READV 兼容 5.1 内核，IORING_OP_READ 需要 5.6 以上版本
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = request.fd;
+        sqe->off = static_cast<quint64>(request.done);
+        sqe->addr = reinterpret_cast<quint64>(&request.iov);
+        sqe->len = 1;
+        sqe->user_data = userData;
+        m_sqArray[index] = index;
+        m_pending++;
+    }
+
+    // 提交队列中的请求，并等待至少 \a minComplete 个请求完成
+    bool submitAndWait(unsigned minComplete)
+    {
+        __atomic_store_n(m_sqTail, *m_sqTail + m_pending, __ATOMIC_RELEASE);
+        m_unsubmitted += m_pending;
+        m_pending = 0;
+
+        int retry = 0;
+        forever {
+            long ret = syscall(__NR_io_uring_enter, m_fd, m_unsubmitted, minComplete, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (ret >= 0) {
+                // 可能只提交了部分请求，其余请求仍在提交队列中，下次调用时提交
+                m_unsubmitted -= static_cast<unsigned>(ret);
+                m_submitted += static_cast<unsigned>(ret);
+                return true;
+            }
+            if (EINTR == errno) {
+                continue;
+            }
+            if (EAGAIN != errno && EBUSY != errno) {
+                return false;
+            }
+
+            // 内核暂时无法分配请求(EAGAIN)或完成队列已满(EBUSY)，
+            // 有已提交的请求时仅等待其完成，未提交的请求在下次调用时提交
+            if (m_submitted > 0) {
+                return waitCompletions(1);
+            }
+            if (++retry > EMaxSubmitRetry) {
+                return false;
+            }
+            usleep(1000);
+        }
+    }
+
+    /**
+     * @brief 等待已提交的请求全部完成并丢弃结果，释放读取缓冲区前调用，
+     *      确保内核不会继续写入缓冲区。未提交的请求被丢弃。
+     * @return 是否成功等待全部请求完成
+     */
+    bool drain()
+    {
+        m_pending = 0;
+        while (m_submitted > 0) {
+            forEachCompletion([](quint64, int) {});
+            if (0 == m_submitted) {
+                break;
+            }
+            if (!waitCompletions(m_submitted)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 遍历完成队列
+    template<typename Func>
+    void forEachCompletion(Func func)
+    {
+        unsigned head = *m_cqHead;
+        unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe &cqe = m_cqes[head & m_cqMask];
+            m_submitted--;
+            func(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+    }
+
+private:
+    enum {
+        EMaxSubmitRetry = 100,      // 无请求可等待时，提交失败的最大重试次数，每次间隔 1ms
+    };
+
+    // 仅等待至少 \a minComplete 个已提交的请求完成，不提交新请求
+    bool waitCompletions(unsigned minComplete)
+    {
+        forever {
+            long ret = syscall(__NR_io_uring_enter, m_fd, 0, minComplete, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (ret >= 0) {
+                return true;
+            }
+            if (EINTR != errno) {
+                return false;
+            }
+        }
+    }
+
+    void release()
+    {
+        if (m_sqes) {
+            munmap(m_sqes, m_sqesSize);
+            m_sqes = nullptr;
+        }
+        if (m_cqRing && m_cqRing != m_sqRing) {
+            munmap(m_cqRing, m_cqRingSize);
+        }
+        m_cqRing = nullptr;
+        if (m_sqRing) {
+            munmap(m_sqRing, m_sqRingSize);
+            m_sqRing = nullptr;
+        }
+        if (-1 != m_fd) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+private:
+    int             m_fd = -1;
+    unsigned        m_entries = 0;
+    unsigned        m_pending = 0;          // 已添加未提交的请求数
+    unsigned        m_unsubmitted = 0;      // 已加入提交队列但内核尚未接收的请求数
+    unsigned        m_submitted = 0;        // 内核已接收但尚未取得完成结果的请求数
+
+    void            *m_sqRing = nullptr;
+    void            *m_cqRing = nullptr;
+    size_t          m_sqRingSize = 0;
+    size_t          m_cqRingSize = 0;
+    size_t          m_sqesSize = 0;
+
+    unsigned        *m_sqTail = nullptr;
+    unsigned        m_sqMask = 0;
+    unsigned        *m_sqArray = nullptr;
+    io_uring_sqe    *m_sqes = nullptr;
+
+    unsigned        *m_cqHead = nullptr;
+    unsigned        *m_cqTail = nullptr;
+    unsigned        m_cqMask = 0;
+    io_uring_cqe    *m_cqes = nullptr;
+};
+
+/**
+ * @brief 通过 io_uring 批量读取，保持队列中最多 EQueueDepth 个请求
+ * @return io_uring 是否可用，不可用时由调用方回退至线程池读取
+ */
+bool readFilesByIoUring(QVector<BatchFileReader::Result> &results, qint64 length)
+{
+    IoUring ring(BatchFileReader::EQueueDepth);
+    if (!ring.isValid()) {
+        return false;
+    }
+
+    QVector<ReadRequest> requests(results.size());
+    int next = 0;
+    unsigned inflight = 0;
+
+    while (next < results.size() || inflight > 0) {
+        // 填充提交队列
+        unsigned queued = 0;
+        while (next < results.size() && inflight + queued < ring.entries()) {
+            BatchFileReader::Result &result = results[next];
+            ReadRequest &request = requests[next];
+            if (prepareRequest(result, request, length)) {
+                request.iov.iov_base = result.data.data();
+                request.iov.iov_len = static_cast<size_t>(request.target);
+                ring.prepareRead(request, static_cast<quint64>(next));
+                queued++;
+            } else {
+                finishRequest(result, request);
+            }
+            next++;
+        }
+
+        inflight += queued;
+        if (0 == inflight) {
+            continue;
+        }
+
+        if (!ring.submitAndWait(1)) {
+            // 提交失败，未完成的请求记录错误，由调用方决定是否重新读取
+            int error = errno;
+            qWarning() << "BatchFileReader: io_uring_enter failed," << strerror(error);
+            // 内核可能仍在向已提交请求的缓冲区写入数据，需等待完成后才能释放缓冲区
+            if (!ring.drain()) {
+                qWarning() << "BatchFileReader: io_uring drain failed, keep read buffers alive," << strerror(errno);
+                // 有意不释放，避免内核写入已释放的内存
+                QVector<QByteArray> *buffers = new QVector<QByteArray>;
+                for (int i = 0; i < next; ++i) {
+                    if (-1 != requests[i].fd) {
+                        buffers->append(results[i].data);
+                        results[i].data = QByteArray();
+                    }
+                }
+            }
+            for (int i = 0; i < next; ++i) {
+                if (-1 != requests[i].fd) {
+                    results[i].error = error;
+                    finishRequest(results[i], requests[i]);
+                }
+            }
+            for (int i = next; i < results.size(); ++i) {
+                results[i].error = error;
+            }
+            return true;
+        }
+
+        ring.forEachCompletion([&](quint64 userData, int res) {
+            int index = static_cast<int>(userData);
+            BatchFileReader::Result &result = results[index];
+            ReadRequest &request = requests[index];
+
+            if (res > 0) {
+                request.done += res;
+                if (request.done < request.target) {
+                    // 读取不完整，继续读取剩余部分
+                    request.iov.iov_base = result.data.data() + request.done;
+                    request.iov.iov_len = static_cast<size_t>(request.target - request.done);
+                    ring.prepareRead(request, userData);
+                    return;
+                }
+            } else if (res < 0 && -EINTR != res && -EAGAIN != res) {
+                result.error = -res;
+            } else if (res < 0) {
+                ring.prepareRead(request, userData);
+                return;
+            }
+
+            inflight--;
+            finishRequest(result, request);
+        });
+        // 重新添加的请求仍计入 inflight ，在下一轮循环中随新请求一同提交
+    }
+
+    return true;
+}
+
+#endif // UNIONIMAGE_HAS_IO_URING
+
+}  // namespace
+
+QVector<BatchFileReader::Result> BatchFileReader::readFiles(const QStringList &paths, qint64 length)
+{
+    QVector<Result> results(paths.size());
+    for (int i = 0; i < paths.size(); ++i) {
+        results[i].path = paths.at(i);
+    }
+
+#ifdef UNIONIMAGE_HAS_IO_URING
+    if (ioUringAvailable() && readFilesByIoUring(results, length)) {
+        return results;
+    }
+#endif
+
+    readFilesByThreadPool(results, length);
+    return results;
+}
+
+bool BatchFileReader::ioUringAvailable()
+{
+#ifdef UNIONIMAGE_HAS_IO_URING
+    // 内核不支持或通过 kernel.io_uring_disabled 禁用时创建失败
+    static const bool s_available = []() {
+        IoUring ring(1);
+        if (!ring.isValid()) {
+            qInfo() << "BatchFileReader: io_uring unavailable, fallback to thread pool," << strerror(errno);
+        }
+        return ring.isValid();
+    }();
+    return s_available;
+#else
+    return false;
+#endif
+}
+
+}  // namespace LibUnionImage_NameSpace
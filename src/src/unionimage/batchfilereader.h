@@ -0,0 +1,52 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef BATCHFILEREADER_H
+#define BATCHFILEREADER_H
+
+#include "unionimage.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace LibUnionImage_NameSpace {
+
+/**
+ * @brief 批量读取文件数据，用于文件头探测、元数据及缩略图读取
+ *      优先通过 io_uring 一次提交多个读取请求，减少冷启动及机械硬盘下逐个阻塞读取的等待；
+ *      系统不支持 io_uring (内核版本过低或被禁用)时，使用线程池并发 pread 读取。
+ *      读取的数据可直接交由 QImageReader(QBuffer) 等内存解码器处理。
+ */
+class UNIONIMAGESHARED_EXPORT BatchFileReader
+{
+public:
+    enum Constant {
+        EDefaultReadSize = 64 * 1024,   // 默认读取文件头 64KB
+        EQueueDepth = 64,               // io_uring 队列深度，同时进行的读取请求数
+        EMaxReadSize = 512 * 1024 * 1024,   // 单个文件最多读取 512MB ，超过时读取完整文件的请求返回 EFBIG
+    };
+
+    // 单个文件的读取结果
+    struct Result {
+        QString     path;       // 文件路径
+        QByteArray  data;       // 读取的数据，长度可能小于请求长度(文件较小)
+        int         error = 0;  // 错误码 errno ，0 表示成功
+    };
+
+    /**
+     * @brief 批量读取 \a paths 文件的前 \a length 字节，\a length <= 0 时读取完整文件。
+     *      \a length 超过 EMaxReadSize 时按 EMaxReadSize 读取，完整文件超过 EMaxReadSize 时不读取
+     * @return 与 \a paths 顺序一致的读取结果
+     */
+    static QVector<Result> readFiles(const QStringList &paths, qint64 length = EDefaultReadSize);
+
+    // 当前系统是否支持 io_uring
+    static bool ioUringAvailable();
+};
+
+}  // namespace LibUnionImage_NameSpace
+
+#endif // BATCHFILEREADER_H
@@ -0,0 +1,426 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "imageresampler.h"
+
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrent>
+#include <QtMath>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace LibUnionImage_NameSpace {
+
+enum Constant {
+    EPrecisionBits = 14,                // 定点数权重精度，权重和为 1 << 14 ，int16 可表示
+    EMinBandRows = 16,                  // 每个分段的最小输出行数
+    EParallelPixels = 512 * 512,        // 源图片像素数超过此值时并行处理
+};
+
+static const int s_rounding = 1 << (EPrecisionBits - 1);
+
+/**
+ * @brief 采样权重表，输出位置 i 使用源位置 start[i] 起的 count[i] 个采样，
+ *      权重为定点数，每个输出位置占用 maxCount 个权重
+ */
+struct Contributors {
+    QVector<int>    start;
+    QVector<int>    count;
+    QVector<qint16> weights;
+    int             maxCount = 0;
+};
+
+static double boxKernel(double x)
+{
+    return (x >= -0.5 && x < 0.5) ? 1.0 : 0.0;
+}
+
+static double triangleKernel(double x)
+{
+    x = qAbs(x);
+    return x < 1.0 ? 1.0 - x : 0.0;
+}
+
+static double sinc(double x)
+{
+    if (qFuzzyIsNull(x)) {
+        return 1.0;
+    }
+    x *= M_PI;
+    return qSin(x) / x;
+}
+
+static double lanczosKernel(double x)
+{
+    return (x > -3.0 && x < 3.0) ? sinc(x) * sinc(x / 3.0) : 0.0;
+}
+
+/**
+ * @brief 计算由长度 \a srcLength 缩放至 \a dstLength 的采样权重表，缩小时按比例扩大滤波范围
+ */
+static Contributors computeContributors(int srcLength, int dstLength, ImageResampler::Filter filter)
+{
+    double (*kernel)(double) = triangleKernel;
+    double kernelSupport = 1.0;
+    switch (filter) {
+    case ImageResampler::Box:
+        kernel = boxKernel;
+        kernelSupport = 0.5;
+        break;
+    case ImageResampler::Lanczos:
+        kernel = lanczosKernel;
+        kernelSupport = 3.0;
+        break;
+    default:
+        break;
+    }
+
+    const double scale = double(srcLength) / dstLength;
+    const double filterScale = qMax(scale, 1.0);
+    const double support = kernelSupport * filterScale;
+
+    Contributors table;
+    table.maxCount = qCeil(support) * 2 + 1;
+    table.start.resize(dstLength);
+    table.count.resize(dstLength);
+    table.weights.fill(0, dstLength * table.maxCount);
+
+    QVector<double> weights(table.maxCount);
+    for (int i = 0; i < dstLength; i++) {
+        const double center = (i + 0.5) * scale;
+        const int begin = qMax(0, int(center - support + 0.5));
+        const int end = qMin(srcLength, int(center + support + 0.5));
+        int count = qMin(end - begin, table.maxCount);
+
+        double total = 0.0;
+        for (int j = 0; j < count; j++) {
+            weights[j] = kernel((begin + j - center + 0.5) / filterScale);
+            total += weights[j];
+        }
+        if (qFuzzyIsNull(total)) {
+            // 滤波范围内无有效采样(如 Box 滤波放大时)，使用最近的采样
+            weights[0] = 1.0;
+            total = 1.0;
+            count = 1;
+        }
+
+        // 定点数舍入误差累加到最大的权重，保证权重和为 1 << EPrecisionBits
+        qint16 *fixed = table.weights.data() + i * table.maxCount;
+        int fixedTotal = 0;
+        int peak = 0;
+        for (int j = 0; j < count; j++) {
+            fixed[j] = static_cast<qint16>(qRound(weights[j] / total * (1 << EPrecisionBits)));
+            fixedTotal += fixed[j];
+            if (fixed[j] > fixed[peak]) {
+                peak = j;
+            }
+        }
+        fixed[peak] = static_cast<qint16>(fixed[peak] + (1 << EPrecisionBits) - fixedTotal);
+        table.start[i] = begin;
+        table.count[i] = count;
+    }
+
+    return table;
+}
+
+static inline uchar clampChannel(int value)
+{
+    value >>= EPrecisionBits;
+    return static_cast<uchar>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+#if defined(__SSE2__)
+// 两个 int16 权重组合为 32 位，用于 _mm_madd_epi16 同时计算两个采样
+static inline int pairWeights(qint16 w0, qint16 w1)
+{
+    return static_cast<int>((quint32(quint16(w1)) << 16) | quint16(w0));
+}
+#endif
+
+/**
+ * @brief 水平方向重采样一行像素，\a in 为源图片行，\a out 输出 \a width 个像素
+ */
+static void horizontalRow(const quint32 *in, quint32 *out, int width, const Contributors &table)
+{
+    for (int x = 0; x < width; x++) {
+        const quint32 *pixels = in + table.start[x];
+        const qint16 *weights = table.weights.constData() + x * table.maxCount;
+        const int count = table.count[x];
+
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        __m128i sum = _mm_set1_epi32(s_rounding);
+        int j = 0;
+        for (; j + 1 < count; j += 2) {
+            // 交错排列两个像素的通道: p0c0 p1c0 p0c1 p1c1 ...
+            __m128i pix = _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(pixels[j])), _mm_cvtsi32_si128(int(pixels[j + 1])));
+            pix = _mm_unpacklo_epi8(pix, zero);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(pix, _mm_set1_epi32(pairWeights(weights[j], weights[j + 1]))));
+        }
+        for (; j < count; j++) {
+            __m128i pix = _mm_unpacklo_epi8(_mm_cvtsi32_si128(int(pixels[j])), zero);
+            pix = _mm_unpacklo_epi16(pix, zero);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(pix, _mm_set1_epi32(quint16(weights[j]))));
+        }
+        sum = _mm_srai_epi32(sum, EPrecisionBits);
+        sum = _mm_packs_epi32(sum, sum);
+        sum = _mm_packus_epi16(sum, sum);
+        out[x] = quint32(_mm_cvtsi128_si32(sum));
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        int32x4_t sum = vdupq_n_s32(s_rounding);
+        for (int j = 0; j < count; j++) {
+            uint8x8_t bytes = vreinterpret_u8_u32(vdup_n_u32(pixels[j]));
+            int16x4_t pix = vget_low_s16(vreinterpretq_s16_u16(vmovl_u8(bytes)));
+            sum = vmlal_n_s16(sum, pix, weights[j]);
+        }
+        int16x4_t narrow = vqmovn_s32(vshrq_n_s32(sum, EPrecisionBits));
+        uint8x8_t result = vqmovun_s16(vcombine_s16(narrow, narrow));
+        out[x] = vget_lane_u32(vreinterpret_u32_u8(result), 0);
+#else
+        int sum[4] = {s_rounding, s_rounding, s_rounding, s_rounding};
+        for (int j = 0; j < count; j++) {
+            const uchar *pix = reinterpret_cast<const uchar *>(pixels + j);
+            for (int c = 0; c < 4; c++) {
+                sum[c] += pix[c] * weights[j];
+            }
+        }
+        uchar *dst = reinterpret_cast<uchar *>(out + x);
+        for (int c = 0; c < 4; c++) {
+            dst[c] = clampChannel(sum[c]);
+        }
+#endif
+    }
+}
+
+/**
+ * @brief 垂直方向重采样，将 \a count 行 \a rows 按权重 \a weights 合并，从第 \a begin 个通道起计算，
+ *      输出至 \a out ，总通道数为 \a channels (像素数 x 4)
+ */
+static void verticalRowScalar(const uchar *const *rows, const qint16 *weights, int count,
+                              uchar *out, int begin, int channels)
+{
+    for (int i = begin; i < channels; i++) {
+        int sum = s_rounding;
+        for (int k = 0; k < count; k++) {
+            sum += rows[k][i] * weights[k];
+        }
+        out[i] = clampChannel(sum);
+    }
+}
+
+#if defined(__SSE2__)
+/**
+ * @brief SSE2 版本，从第 \a begin 个通道起计算
+ * @return 已处理到的通道位置，不足 16 个通道的剩余部分由调用方处理
+ */
+static int verticalRowSse2(const uchar *const *rows, const qint16 *weights, int count,
+                           uchar *out, int begin, int channels)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = begin;
+    // 每次处理 16 个通道(4 个像素)
+    for (; i + 16 <= channels; i += 16) {
+        __m128i s0 = _mm_set1_epi32(s_rounding);
+        __m128i s1 = s0;
+        __m128i s2 = s0;
+        __m128i s3 = s0;
+        int k = 0;
+        for (; k < count; k += 2) {
+            const bool single = (k + 1 == count);
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[k] + i));
+            __m128i b = single ? zero : _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[k + 1] + i));
+            __m128i mmk = _mm_set1_epi32(single ? quint16(weights[k]) : pairWeights(weights[k], weights[k + 1]));
+
+            // 交错排列两行的通道后与权重对相乘
+            __m128i lo = _mm_unpacklo_epi8(a, b);
+            __m128i hi = _mm_unpackhi_epi8(a, b);
+            s0 = _mm_add_epi32(s0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), mmk));
+            s1 = _mm_add_epi32(s1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), mmk));
+            s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), mmk));
+            s3 = _mm_add_epi32(s3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), mmk));
+        }
+
+        s0 = _mm_srai_epi32(s0, EPrecisionBits);
+        s1 = _mm_srai_epi32(s1, EPrecisionBits);
+        s2 = _mm_srai_epi32(s2, EPrecisionBits);
+        s3 = _mm_srai_epi32(s3, EPrecisionBits);
+        __m128i result = _mm_packus_epi16(_mm_packs_epi32(s0, s1), _mm_packs_epi32(s2, s3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), result);
+    }
+    return i;
+}
+
+/**
+ * @brief AVX2 版本，每次处理 32 个通道，解交错及打包操作均在 128 位通道内进行，输出顺序与输入一致
+ */
+__attribute__((target("avx2")))
+static int verticalRowAvx2(const uchar *const *rows, const qint16 *weights, int count,
+                           uchar *out, int begin, int channels)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    int i = begin;
+    for (; i + 32 <= channels; i += 32) {
+        __m256i s0 = _mm256_set1_epi32(s_rounding);
+        __m256i s1 = s0;
+        __m256i s2 = s0;
+        __m256i s3 = s0;
+        for (int k = 0; k < count; k += 2) {
+            const bool single = (k + 1 == count);
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows[k] + i));
+            __m256i b = single ? zero : _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows[k + 1] + i));
+            __m256i mmk = _mm256_set1_epi32(single ? quint16(weights[k]) : pairWeights(weights[k], weights[k + 1]));
+
+            __m256i lo = _mm256_unpacklo_epi8(a, b);
+            __m256i hi = _mm256_unpackhi_epi8(a, b);
+            s0 = _mm256_add_epi32(s0, _mm256_madd_epi16(_mm256_unpacklo_epi8(lo, zero), mmk));
+            s1 = _mm256_add_epi32(s1, _mm256_madd_epi16(_mm256_unpackhi_epi8(lo, zero), mmk));
+            s2 = _mm256_add_epi32(s2, _mm256_madd_epi16(_mm256_unpacklo_epi8(hi, zero), mmk));
+            s3 = _mm256_add_epi32(s3, _mm256_madd_epi16(_mm256_unpackhi_epi8(hi, zero), mmk));
+        }
+
+        s0 = _mm256_srai_epi32(s0, EPrecisionBits);
+        s1 = _mm256_srai_epi32(s1, EPrecisionBits);
+        s2 = _mm256_srai_epi32(s2, EPrecisionBits);
+        s3 = _mm256_srai_epi32(s3, EPrecisionBits);
+        __m256i result = _mm256_packus_epi16(_mm256_packs_epi32(s0, s1), _mm256_packs_epi32(s2, s3));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), result);
+    }
+    return i;
+}
+
+static bool hasAvx2()
+{
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+static int verticalRowNeon(const uchar *const *rows, const qint16 *weights, int count,
+                           uchar *out, int begin, int channels)
+{
+    int i = begin;
+    // 每次处理 16 个通道(4 个像素)
+    for (; i + 16 <= channels; i += 16) {
+        int32x4_t s0 = vdupq_n_s32(s_rounding);
+        int32x4_t s1 = s0;
+        int32x4_t s2 = s0;
+        int32x4_t s3 = s0;
+        for (int k = 0; k < count; k++) {
+            uint8x16_t v = vld1q_u8(rows[k] + i);
+            int16x8_t lo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(v)));
+            int16x8_t hi = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(v)));
+            s0 = vmlal_n_s16(s0, vget_low_s16(lo), weights[k]);
+            s1 = vmlal_n_s16(s1, vget_high_s16(lo), weights[k]);
+            s2 = vmlal_n_s16(s2, vget_low_s16(hi), weights[k]);
+            s3 = vmlal_n_s16(s3, vget_high_s16(hi), weights[k]);
+        }
+
+        int16x8_t lo = vcombine_s16(vqmovn_s32(vshrq_n_s32(s0, EPrecisionBits)),
+                                    vqmovn_s32(vshrq_n_s32(s1, EPrecisionBits)));
+        int16x8_t hi = vcombine_s16(vqmovn_s32(vshrq_n_s32(s2, EPrecisionBits)),
+                                    vqmovn_s32(vshrq_n_s32(s3, EPrecisionBits)));
+        vst1q_u8(out + i, vcombine_u8(vqmovun_s16(lo), vqmovun_s16(hi)));
+    }
+    return i;
+}
+#endif
+
+static void verticalRow(const uchar *const *rows, const qint16 *weights, int count, uchar *out, int channels)
+{
+    // 各实现处理到的位置，剩余部分由下一级实现处理
+    int done = 0;
+#if defined(__SSE2__)
+    if (hasAvx2()) {
+        done = verticalRowAvx2(rows, weights, count, out, done, channels);
+    }
+    done = verticalRowSse2(rows, weights, count, out, done, channels);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    done = verticalRowNeon(rows, weights, count, out, done, channels);
+#endif
+    verticalRowScalar(rows, weights, count, out, done, channels);
+}
+
+QImage ImageResampler::scale(const QImage &image, const QSize &size, Filter filter)
+{
+    if (image.isNull() || size.isEmpty()) {
+        return QImage();
+    }
+    if (image.size() == size) {
+        return image;
+    }
+
+    // 线性插值需要在预乘格式下计算，避免透明像素的颜色混入
+    QImage src = image;
+    if (src.format() != QImage::Format_RGB32 && src.format() != QImage::Format_ARGB32_Premultiplied) {
+        src = src.convertToFormat(src.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+    }
+
+    QImage dst(size, src.format());
+    if (dst.isNull()) {
+        return QImage();
+    }
+
+    const Contributors horizontal = computeContributors(src.width(), size.width(), filter);
+    const Contributors vertical = computeContributors(src.height(), size.height(), filter);
+    const int dstChannels = size.width() * 4;
+    uchar *dstBits = dst.bits();
+    const qint64 dstBytesPerLine = dst.bytesPerLine();
+
+    // 每段先水平缩放所需的源图片行，再垂直缩放，分段之间仅重复计算边界处少量的行
+    auto processBand = [&](const QPair<int, int> &band) {
+        const int srcBegin = vertical.start[band.first];
+        int srcEnd = srcBegin;
+        for (int y = band.first; y < band.second; y++) {
+            srcEnd = qMax(srcEnd, vertical.start[y] + vertical.count[y]);
+        }
+
+        QVector<quint32> buffer((srcEnd - srcBegin) * size.width());
+        for (int row = srcBegin; row < srcEnd; row++) {
+            horizontalRow(reinterpret_cast<const quint32 *>(src.constScanLine(row)),
+                          buffer.data() + (row - srcBegin) * size.width(), size.width(), horizontal);
+        }
+
+        QVector<const uchar *> rows(vertical.maxCount);
+        for (int y = band.first; y < band.second; y++) {
+            const int count = vertical.count[y];
+            for (int k = 0; k < count; k++) {
+                rows[k] = reinterpret_cast<const uchar *>(buffer.constData() + (vertical.start[y] + k - srcBegin) * size.width());
+            }
+            verticalRow(rows.constData(), vertical.weights.constData() + y * vertical.maxCount, count,
+                        dstBits + y * dstBytesPerLine, dstChannels);
+        }
+    };
+
+    const int threads = QThreadPool::globalInstance()->maxThreadCount();
+    const int rows = size.height();
+    if (qint64(src.width()) * src.height() < EParallelPixels || threads <= 1 || rows < EMinBandRows * 2) {
+        processBand(qMakePair(0, rows));
+    } else {
+        // 分段数多于线程数，平衡各线程的负载
+        const int bandRows = qMax(int(EMinBandRows), (rows + threads * 4 - 1) / (threads * 4));
+        QVector<QPair<int, int>> bands;
+        for (int begin = 0; begin < rows; begin += bandRows) {
+            bands.append(qMakePair(begin, qMin(rows, begin + bandRows)));
+        }
+        QtConcurrent::blockingMap(bands, processBand);
+    }
+
+    dst.setDotsPerMeterX(image.dotsPerMeterX());
+    dst.setDotsPerMeterY(image.dotsPerMeterY());
+    return dst;
+}
+
+QImage ImageResampler::scale(const QImage &image, const QSize &size, Qt::AspectRatioMode mode, Filter filter)
+{
+    if (image.isNull()) {
+        return QImage();
+    }
+    return scale(image, image.size().scaled(size, mode), filter);
+}
+
+}  // namespace LibUnionImage_NameSpace
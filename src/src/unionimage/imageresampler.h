@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef IMAGERESAMPLER_H
+#define IMAGERESAMPLER_H
+
+#include "unionimage.h"
+
+#include <QImage>
+
+namespace LibUnionImage_NameSpace {
+
+/**
+ * @brief 图片重采样(缩放)，替代 QImage::scaled()
+ *      QImage::scaled() 的 FastTransformation 为最近邻采样，缩小后锯齿明显；
+ *      SmoothTransformation 单线程处理，大图缩放耗时长。
+ *      此处使用可分离滤波(Box / Triangle / Lanczos3)，缩小时按比例扩大滤波范围抗锯齿，
+ *      采样权重预先计算为定点数，内层循环使用 AVX2 / SSE2 / NEON 指令，
+ *      按输出行分段通过 QtConcurrent 并行处理。
+ *      处理的图片格式为 RGB32 或 ARGB32_Premultiplied ，其它格式转换后处理。
+ */
+class UNIONIMAGESHARED_EXPORT ImageResampler
+{
+public:
+    enum Filter {
+        Box,        // 区域平均，速度最快
+        Triangle,   // 三角(双线性)滤波，默认
+        Lanczos     // Lanczos3 滤波，画质最好
+    };
+
+    // 按滤波算法 \a filter 将图片 \a image 缩放至 \a size ，不保持宽高比
+    static QImage scale(const QImage &image, const QSize &size, Filter filter = Triangle);
+    // 按 \a mode 计算缩放后的大小，与 QImage::scaled() 一致
+    static QImage scale(const QImage &image, const QSize &size, Qt::AspectRatioMode mode, Filter filter = Triangle);
+};
+
+}  // namespace LibUnionImage_NameSpace
+
+#endif // IMAGERESAMPLER_H
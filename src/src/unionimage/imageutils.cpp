@@ -4,6 +4,7 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "baseutils.h"
+#include "imageresampler.h"
 #include "imageutils.h"
 #include "unionimage.h"
 #include <fstream>
@@ -23,11 +24,270 @@
 #include <QReadWriteLock>
 #include <QUrl>
 #include <QApplication>
+#include <QRunnable>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 namespace Libutils {
 
 namespace image {
 
+namespace {
+
+// getdents64 返回的目录项结构，glibc 未导出此定义
+struct LinuxDirent64 {
+    ino64_t         d_ino;
+    off64_t         d_off;
+    unsigned short  d_reclen;
+    unsigned char   d_type;
+    char            d_name[];
+};
+
+// 判断图片时读取的文件头长度，需包含 BMP 的文件头(14 字节)及信息头长度字段
+const int MAGIC_HEADER_SIZE = 18;
+
+/**
+ * @return 支持读取的图片后缀(大写)，与 imageSupportRead() 的判断一致
+ */
+const QSet<QString> &imageSuffixSet()
+{
+    static const QSet<QString> s_suffixes = []() {
+        QSet<QString> suffixes = LibUnionImage_NameSpace::unionImageSupportFormat().toSet();
+        suffixes.remove("X3F");
+        return suffixes;
+    }();
+    return s_suffixes;
+}
+
+inline quint32 readLE32(const uchar *data)
+{
+    return quint32(data[0]) | (quint32(data[1]) << 8) | (quint32(data[2]) << 16) | (quint32(data[3]) << 24);
+}
+
+/**
+ * @brief 检查 BMP 文件头，"BM" 仅 2 字节，容易与其它文件误判，
+ *      同时要求文件头中的文件大小及像素偏移不超过实际大小 \a fileSize ，信息头长度为已知的版本
+ */
+bool isBmpHeader(const uchar *data, ssize_t len, qint64 fileSize)
+{
+    if (len < 18) {
+        return false;
+    }
+
+    const quint32 declaredSize = readLE32(data + 2);
+    const quint32 pixelOffset = readLE32(data + 10);
+    const quint32 dibSize = readLE32(data + 14);
+    switch (dibSize) {
+    case 12:    // BITMAPCOREHEADER
+    case 40:    // BITMAPINFOHEADER
+    case 52:    // BITMAPV2INFOHEADER
+    case 56:    // BITMAPV3INFOHEADER
+    case 64:    // OS22XBITMAPHEADER
+    case 108:   // BITMAPV4HEADER
+    case 124:   // BITMAPV5HEADER
+        break;
+    default:
+        return false;
+    }
+
+    // 部分编码器写入的文件大小为 0 ，仅检查非 0 的值
+    if (declaredSize != 0 && (declaredSize < 14 + dibSize || qint64(declaredSize) > fileSize)) {
+        return false;
+    }
+    return pixelOffset >= 14 + dibSize && qint64(pixelOffset) <= fileSize;
+}
+
+/**
+ * @brief 根据文件头 \a data 判断是否为图片文件，用于无后缀或后缀未知的文件，\a fileSize 为文件大小
+ */
+bool isImageMagic(const uchar *data, ssize_t len, qint64 fileSize)
+{
+    if (len < 4) {
+        return false;
+    }
+
+    const char *head = reinterpret_cast<const char *>(data);
+    // jpeg png gif bmp
+    if ((data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF)
+            || 0 == memcmp(head, "\x89PNG", 4)
+            || 0 == memcmp(head, "GIF8", 4)) {
+        return true;
+    }
+    if (0 == memcmp(head, "BM", 2)) {
+        return isBmpHeader(data, len, fileSize);
+    }
+    // tiff 及基于 tiff 的 raw 格式(little-endian, big-endian, orf, rw2)
+    if (0 == memcmp(head, "II*\0", 4) || 0 == memcmp(head, "MM\0*", 4)
+            || 0 == memcmp(head, "IIRO", 4) || 0 == memcmp(head, "IIRS", 4)
+            || 0 == memcmp(head, "IIU\0", 4)) {
+        return true;
+    }
+    // mng psd dds icns
+    if (0 == memcmp(head, "\x8aMNG", 4) || 0 == memcmp(head, "8BPS", 4)
+            || 0 == memcmp(head, "DDS ", 4) || 0 == memcmp(head, "icns", 4)) {
+        return true;
+    }
+    if (len >= 12) {
+        // webp jp2 cr3
+        if ((0 == memcmp(head, "RIFF", 4) && 0 == memcmp(head + 8, "WEBP", 4))
+                || 0 == memcmp(head, "\0\0\0\x0cjP  ", 8)
+                || 0 == memcmp(head + 4, "ftypcrx ", 8)) {
+            return true;
+        }
+    }
+    if (len >= 15 && 0 == memcmp(head, "FUJIFILMCCD-RAW", 15)) {
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief 判断文件夹 \a dirFd 下的文件 \a name 是否为图片，优先通过后缀判断，
+ *      后缀未知时读取文件头判断。
+ */
+bool isImageEntry(int dirFd, const char *name)
+{
+    const char *dot = strrchr(name, '.');
+    if (dot && dot[1] != '\0') {
+        if (imageSuffixSet().contains(QString::fromUtf8(dot + 1).toUpper())) {
+            return true;
+        }
+    }
+
+    int fd = openat(dirFd, name, O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+    if (-1 == fd) {
+        return false;
+    }
+    uchar header[MAGIC_HEADER_SIZE];
+    ssize_t len = pread(fd, header, sizeof(header), 0);
+    struct stat st;
+    const qint64 fileSize = 0 == fstat(fd, &st) ? qint64(st.st_size) : 0;
+    close(fd);
+
+    return isImageMagic(header, len, fileSize);
+}
+
+/**
+ * @brief 遍历单个文件夹的任务，子文件夹作为新的任务投递到线程池中并行处理。
+ *      任务仅记录文件夹路径，执行时才打开文件夹，执行完成即关闭，
+ *      同时打开的文件描述符数不超过线程池的线程数，不受等待中任务数量的影响。
+ */
+class EnumerateTask : public QRunnable
+{
+public:
+    EnumerateTask(const QString &dirPath, bool recursive, QThreadPool *pool,
+                  const std::function<void(const QStringList &)> &callback)
+        : m_dirPath(dirPath)
+        , m_recursive(recursive)
+        , m_pool(pool)
+        , m_callback(callback)
+    {
+    }
+
+    void run() override
+    {
+        // 根目录的路径记录为空字符串，拼接子路径时不产生重复的分隔符
+        const QByteArray openPath = QFile::encodeName(m_dirPath.isEmpty() ? QString("/") : m_dirPath);
+        m_dirFd = open(openPath.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (-1 == m_dirFd) {
+            qWarning() << "enumerateImages: open dir failed," << m_dirPath << strerror(errno);
+            return;
+        }
+
+        QStringList images;
+        char buffer[32 * 1024];
+
+        forever {
+            long len = syscall(SYS_getdents64, m_dirFd, buffer, sizeof(buffer));
+            if (len <= 0) {
+                break;
+            }
+
+            for (long offset = 0; offset < len;) {
+                const LinuxDirent64 *entry = reinterpret_cast<const LinuxDirent64 *>(buffer + offset);
+                offset += entry->d_reclen;
+
+                // 跳过 . .. 及隐藏文件
+                if ('.' == entry->d_name[0]) {
+                    continue;
+                }
+
+                unsigned char type = entry->d_type;
+                if (DT_UNKNOWN == type || DT_LNK == type) {
+                    // 文件系统未提供类型或为链接，取链接指向的文件类型
+                    struct stat st;
+                    if (0 != fstatat(m_dirFd, entry->d_name, &st, 0)) {
+                        continue;
+                    }
+                    // 不跟随链接遍历文件夹，防止循环
+                    if (S_ISDIR(st.st_mode)) {
+                        type = DT_LNK == type ? DT_UNKNOWN : DT_DIR;
+                    } else {
+                        type = S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+                    }
+                }
+
+                if (DT_DIR == type) {
+                    if (m_recursive) {
+                        m_pool->start(new EnumerateTask(m_dirPath + "/" + QString::fromUtf8(entry->d_name),
+                                                        m_recursive, m_pool, m_callback));
+                    }
+                } else if (DT_REG == type && isImageEntry(m_dirFd, entry->d_name)) {
+                    images << m_dirPath + "/" + QString::fromUtf8(entry->d_name);
+                }
+            }
+        }
+
+        close(m_dirFd);
+        m_dirFd = -1;
+
+        if (!images.isEmpty()) {
+            m_callback(images);
+        }
+    }
+
+private:
+    int             m_dirFd = -1;
+    QString         m_dirPath;
+    bool            m_recursive;
+    QThreadPool     *m_pool;
+    std::function<void(const QStringList &)> m_callback;
+};
+
+}  // namespace
+
+/**
+ * @brief 快速遍历文件夹 \a dir 下的图片文件，\a recursive 为 true 时遍历子文件夹。
+ *      通过 getdents64/openat 直接读取目录项，按后缀或文件头判断图片，
+ *      不再为每个文件解析元数据。各文件夹在独立的线程池中并行遍历，
+ *      每个文件夹的结果完成后即通过 \a callback 返回，函数在遍历全部完成后返回。
+ * @note \a callback 会在多个线程中并发调用，需要保证线程安全。
+ */
+void enumerateImages(const QString &dir, bool recursive, const std::function<void(const QStringList &)> &callback)
+{
+    QString dirPath = QDir(dir).absolutePath();
+    if (!QFileInfo(dirPath).isDir()) {
+        qWarning() << "enumerateImages: not a dir," << dirPath;
+        return;
+    }
+
+    // 使用独立的线程池，避免占用全局线程池及嵌套等待
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+    pool.start(new EnumerateTask(dirPath == "/" ? QString() : dirPath, recursive, &pool, callback));
+    pool.waitForDone();
+}
+
 const QImage scaleImage(const QString &path, const QSize &size)
 {
     if (!imageSupportRead(path)) {
@@ -45,7 +305,7 @@ const QImage scaleImage(const QString &path, const QSize &size)
         qDebug() << errMsg;
     }
     if (tImg.size() != size) { //调用加速接口失败，主动进行缩放
-        tImg = tImg.scaled(size);
+        tImg = LibUnionImage_NameSpace::ImageResampler::scale(tImg, size);
     }
     return tImg;
 }
@@ -181,27 +441,14 @@ const QPixmap cutSquareImage(const QPixmap &pixmap, const QSize &size)
 const QFileInfoList getImagesInfo(const QString &dir, bool recursive)
 {
     QFileInfoList infos;
+    QMutex infoMutex;
 
-    if (! recursive) {
-        auto nsl = QDir(dir).entryInfoList(QDir::Files);
-        for (QFileInfo info : nsl) {
-            if (imageSupportRead(info.absoluteFilePath())) {
-                infos << info;
-            }
-        }
-        return infos;
-    }
-
-    QDirIterator dirIterator(dir,
-                             QDir::Files,
-                             QDirIterator::Subdirectories);
-    while (dirIterator.hasNext()) {
-        dirIterator.next();
-        if (imageSupportRead(dirIterator.fileInfo().absoluteFilePath())) {
-            infos << dirIterator.fileInfo();
-#include "imageutils.h"
+    enumerateImages(dir, recursive, [&](const QStringList &paths) {
+        QMutexLocker locker(&infoMutex);
+        for (const QString &path : paths) {
+            infos << QFileInfo(path);
         }
-    }
+    });
 
     return infos;
 }
@@ -353,10 +600,10 @@ bool generateThumbnail(const QString &path)
                              QSize(THUMBNAIL_MAX_SIZE, THUMBNAIL_MAX_SIZE));
 
     // Normal thumbnail
-    QImage nImg = lImg.scaled(
-                      QSize(THUMBNAIL_NORMAL_SIZE, THUMBNAIL_NORMAL_SIZE)
-                      , Qt::KeepAspectRatio
-                      , Qt::SmoothTransformation);
+    QImage nImg = LibUnionImage_NameSpace::ImageResampler::scale(
+                      lImg
+                      , QSize(THUMBNAIL_NORMAL_SIZE, THUMBNAIL_NORMAL_SIZE)
+                      , Qt::KeepAspectRatio);
 
     // Create filed thumbnail
     if (lImg.isNull() || nImg.isNull()) {
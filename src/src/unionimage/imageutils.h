@@ -13,6 +13,8 @@
 #include <QPixmap>
 #include <QDir>
 
+#include <functional>
+
 #define VAULT_DECRYPT_DIR_NAME          "vault_unlocked"
 #define VAULT_BASE_PATH (QDir::homePath() + QString("/.local/share/applications"))  //! 获取保险箱创建的目录地址
 namespace Libutils {
@@ -36,6 +38,9 @@ const QMap<QString, QString>        getAllMetaData(const QString &path);
 const QDateTime                     getCreateDateTime(const QString &path);
 const QFileInfoList                 getImagesInfo(const QString &dir,
                                                   bool recursive = true);
+// 快速遍历文件夹 dir 下的图片文件，结果按文件夹分批通过 callback 返回(会在多个线程中调用)
+void                                enumerateImages(const QString &dir, bool recursive,
+                                                    const std::function<void(const QStringList &)> &callback);
 int                                 getOrientation(const QString &path);
 const QImage                        getRotatedImage(const QString &path);
 
@@ -0,0 +1,294 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "ioscheduler.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <map>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace LibUnionImage_NameSpace {
+
+// 当前线程持有的 Guard 层数，嵌套时不重复占用额度
+static thread_local int t_guardDepth = 0;
+
+// 等待并发额度的读取请求
+struct IoScheduler::Waiter {
+    QWaitCondition  condition;
+    bool            granted = false;
+};
+
+// 设备的并发状态及吞吐量统计
+struct IoScheduler::Device {
+    int             limit = 1;          // 当前并发上限
+    int             minLimit = 1;
+    int             maxLimit = 1;
+    int             running = 0;        // 正在进行的读取数
+
+    std::multimap<QString, Waiter *> waiters;  // 按路径排序的等待请求
+    QString         lastPath;           // 最近一次开始读取的路径，按目录顺序选择下一个请求
+
+    QElapsedTimer   window;             // 本轮统计开始时间
+    QElapsedTimer   busy;               // 设备上存在读取的起始时间
+    qint64          windowBusyTime = 0; // 本轮设备上存在读取的时间(毫秒)，不包含设备空闲的时间
+    qint64          windowBytes = 0;    // 本轮读取的数据量
+    int             windowCount = 0;    // 本轮完成的读取数
+    bool            saturated = false;  // 本轮是否出现等待，未达到并发上限时不调整
+    double          lastThroughput = 0; // 上一轮吞吐量(字节/秒)
+    int             direction = 1;      // 并发数的调整方向
+};
+
+/**
+ * @brief 根据路径类型 \a type 取得设备的初始、最小及最大并发数
+ */
+static void concurrencyRange(imageViewerSpace::PathType type, int &initial, int &minimum, int &maximum)
+{
+    switch (type) {
+    case imageViewerSpace::PathTypeMTP:
+    case imageViewerSpace::PathTypePTP:
+    case imageViewerSpace::PathTypeAPPLE:
+        // MTP/PTP 协议同一时间仅能处理一个传输，并发请求只会排队并增加切换开销
+        initial = minimum = maximum = 1;
+        break;
+    case imageViewerSpace::PathTypeSMB:
+    case imageViewerSpace::PathTypeFTP:
+    case imageViewerSpace::PathTypeSAFEBOX:
+        initial = 2;
+        minimum = 1;
+        maximum = 4;
+        break;
+    default: {
+        const int threads = qMax(2, QThread::idealThreadCount());
+        initial = threads;
+        minimum = 1;
+        maximum = threads * 2;
+        break;
+    }
+    }
+}
+
+IoScheduler::Guard::Guard(const QString &path, qint64 bytes)
+    : m_bytes(bytes)
+{
+    if (t_guardDepth++ > 0) {
+        return;
+    }
+
+    m_device = IoScheduler::deviceKey(path);
+    IoScheduler::instance()->acquire(m_device, path);
+    m_acquired = true;
+}
+
+IoScheduler::Guard::~Guard()
+{
+    t_guardDepth--;
+    if (m_acquired) {
+        IoScheduler::instance()->release(m_device, m_bytes);
+    }
+}
+
+IoScheduler *IoScheduler::instance()
+{
+    static IoScheduler s_scheduler;
+    return &s_scheduler;
+}
+
+/**
+ * @brief 在设备的并发额度内顺序读取 \a path 文件(大小为 \a size )，读取的数据由内核保留在页缓存中，
+ *      随后解码器按路径读取文件头、元数据及图像数据时不再访问设备，解码在额度外进行。
+ *      仅预读远程设备(SMB 、MTP 等)上的文件，本地文件随机读取代价低，预读只会重复读取文件，
+ *      且 RAW 等格式通常仅需读取内嵌的预览图；超过 EMaxReadAheadBytes 的文件不预读，避免挤出页缓存中的其他数据
+ * @return 完整读取文件时返回 true ，未预读时调用方需在读取文件期间持有 Guard
+ */
+bool IoScheduler::readAhead(const QString &path, qint64 size)
+{
+    if (size <= 0 || size > EMaxReadAheadBytes || isLocalDevice(deviceKey(path))) {
+        return false;
+    }
+
+    Guard ioGuard(path, size);
+    const int fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    QByteArray buffer(EReadAheadBlockSize, Qt::Uninitialized);
+    ssize_t count = 0;
+    do {
+        count = ::read(fd, buffer.data(), static_cast<size_t>(buffer.size()));
+    } while (count > 0 || (count < 0 && EINTR == errno));
+
+    ::close(fd);
+    return 0 == count;
+}
+
+/**
+ * @return \a path 所属设备的标识，格式为 "路径类型:设备"。
+ *      gvfs 路径以挂载目录名(如 "mtp:host=xxx")区分设备，本地文件以 st_dev 区分
+ */
+QString IoScheduler::deviceKey(const QString &path)
+{
+    const imageViewerSpace::PathType type = getPathType(path);
+    switch (type) {
+    case imageViewerSpace::PathTypeSMB:
+    case imageViewerSpace::PathTypeMTP:
+    case imageViewerSpace::PathTypePTP:
+    case imageViewerSpace::PathTypeAPPLE: {
+        // 如 /run/user/1000/gvfs/smb-share:server=host,share=dir/a.jpg
+        const QStringList sections = path.split('/', QString::SkipEmptyParts);
+        for (const QString &section : sections) {
+            if (section.contains(':') && section.contains('=')) {
+                return QString("%1:%2").arg(type).arg(section);
+            }
+        }
+        return QString("%1:").arg(type);
+    }
+    case imageViewerSpace::PathTypeSAFEBOX:
+        return QString("%1:").arg(type);
+    default:
+        break;
+    }
+
+    struct stat info;
+    if (0 == ::stat(QFile::encodeName(path).constData(), &info)) {
+        return QString("%1:%2").arg(imageViewerSpace::PathTypeLOCAL).arg(quint64(info.st_dev));
+    }
+    return QString("%1:").arg(imageViewerSpace::PathTypeLOCAL);
+}
+
+bool IoScheduler::isLocalDevice(const QString &device)
+{
+    return imageViewerSpace::PathTypeLOCAL == device.section(':', 0, 0).toInt();
+}
+
+int IoScheduler::concurrency(const QString &device)
+{
+    QMutexLocker _locker(&m_mutex);
+    Device *state = m_devices.value(device);
+    return state ? state->limit : 0;
+}
+
+/**
+ * @return 设备 \a key 的状态，首次访问时按设备类型初始化并发范围，需在加锁后调用
+ */
+IoScheduler::Device &IoScheduler::device(const QString &key)
+{
+    Device *state = m_devices.value(key);
+    if (!state) {
+        state = new Device;
+        const auto type = static_cast<imageViewerSpace::PathType>(key.section(':', 0, 0).toInt());
+        concurrencyRange(type, state->limit, state->minLimit, state->maxLimit);
+        state->window.start();
+        m_devices.insert(key, state);
+    }
+    return *state;
+}
+
+/**
+ * @brief 等待设备 \a key 的并发额度，有空闲额度且无等待请求时直接返回
+ */
+void IoScheduler::acquire(const QString &key, const QString &path)
+{
+    QMutexLocker _locker(&m_mutex);
+    Device &state = device(key);
+    if (state.running < state.limit && state.waiters.empty()) {
+        if (0 == state.running++) {
+            state.busy.start();
+        }
+        state.lastPath = path;
+        return;
+    }
+
+    state.saturated = true;
+    Waiter waiter;
+    state.waiters.emplace(path, &waiter);
+    while (!waiter.granted) {
+        waiter.condition.wait(&m_mutex);
+    }
+}
+
+/**
+ * @brief 释放设备 \a key 的并发额度，记录读取的数据量 \a bytes 并唤醒后续请求
+ */
+void IoScheduler::release(const QString &key, qint64 bytes)
+{
+    QMutexLocker _locker(&m_mutex);
+    Device &state = device(key);
+    if (0 == --state.running) {
+        state.windowBusyTime += state.busy.elapsed();
+    }
+    state.windowBytes += qMax<qint64>(0, bytes);
+    state.windowCount++;
+
+    adjustLimit(state);
+    grantNext(state);
+}
+
+/**
+ * @brief 按路径顺序唤醒等待的请求直至达到并发上限，从最近读取的路径向后选择，到达末尾后从头开始
+ */
+void IoScheduler::grantNext(Device &state)
+{
+    while (state.running < state.limit && !state.waiters.empty()) {
+        auto itr = state.waiters.lower_bound(state.lastPath);
+        if (itr == state.waiters.end()) {
+            itr = state.waiters.begin();
+        }
+
+        Waiter *waiter = itr->second;
+        state.lastPath = itr->first;
+        state.waiters.erase(itr);
+        if (0 == state.running++) {
+            state.busy.start();
+        }
+
+        waiter->granted = true;
+        waiter->condition.wakeOne();
+    }
+}
+
+/**
+ * @brief 每完成一组读取计算吞吐量，吞吐量未明显下降时沿当前方向调整并发数，下降超过 10% 时反向调整。
+ *      吞吐量按设备上存在读取的时间计算，不包含设备空闲(如各线程均在解码)的时间。
+ *      本轮未出现等待时说明请求数未达到并发上限，吞吐量不能反映并发数的影响，不做调整
+ */
+void IoScheduler::adjustLimit(Device &state)
+{
+    if (state.windowCount < EAdjustSamples || state.window.elapsed() < EAdjustMinInterval) {
+        return;
+    }
+
+    qint64 busyTime = state.windowBusyTime;
+    if (state.running > 0) {
+        busyTime += state.busy.restart();
+    }
+
+    if (state.saturated && state.minLimit < state.maxLimit) {
+        const double throughput = state.windowBytes * 1000.0 / qMax<qint64>(1, busyTime);
+        if (state.lastThroughput > 0 && throughput < state.lastThroughput * 0.9) {
+            state.direction = -state.direction;
+        }
+
+        state.limit = qBound(state.minLimit, state.limit + state.direction, state.maxLimit);
+        state.lastThroughput = throughput;
+    }
+
+    state.windowBytes = 0;
+    state.windowBusyTime = 0;
+    state.windowCount = 0;
+    state.saturated = !state.waiters.empty();
+    state.window.restart();
+}
+
+}  // namespace LibUnionImage_NameSpace
@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef IOSCHEDULER_H
+#define IOSCHEDULER_H
+
+#include "unionimage.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+namespace LibUnionImage_NameSpace {
+
+/**
+ * @brief 按存储设备限制并发的文件读取调度
+ *      MTP/PTP 设备(手机、相机)及 gvfs 挂载的 SMB 共享并发访问时会相互抢占，整体速度反而下降。
+ *      此类按读取路径所属的设备分组：本地文件按 st_dev 区分，gvfs 路径按挂载点(如 smb-share:server=...)区分，
+ *      每个设备单独限制同时进行的读取数，MTP/PTP 每次仅允许一个读取，本地磁盘允许较多并发。
+ *      等待的请求按路径排序，按目录内顺序依次读取(到达末尾后从头开始)，减少机械硬盘及网络设备的随机访问。
+ *      每完成一组读取统计设备的吞吐量(按设备上存在读取的时间计算)，吞吐量上升时继续调整并发数，下降时反向调整。
+ *      额度仅应覆盖读取文件的过程，解码等计算不应占用额度，否则并发上限会限制解码且吞吐量统计失真。
+ *      远程设备的文件先预读至页缓存再在额度外解码；本地文件不重复读取，由调用方在打开及读取文件期间持有额度。
+ *
+ * @code
+ *  QScopedPointer<IoScheduler::Guard> ioGuard;
+ *  if (!IoScheduler::readAhead(path, fileSize)) {      // 远程设备等待空闲后读取文件至页缓存
+ *      ioGuard.reset(new IoScheduler::Guard(path));    // 本地文件在读取期间占用额度
+ *  }
+ *  image = reader.read();
+ * @endcode
+ * @threadsafe
+ */
+class UNIONIMAGESHARED_EXPORT IoScheduler
+{
+public:
+    enum Constant {
+        EAdjustSamples = 8,         // 每完成 8 次读取统计一次吞吐量
+        EAdjustMinInterval = 200,   // 吞吐量统计的最短时间间隔 200ms
+        EMaxReadAheadBytes = 256 * 1024 * 1024,     // 预读文件大小上限 256MB
+        EReadAheadBlockSize = 1024 * 1024,          // 预读时每次读取 1MB
+    };
+
+    /**
+     * @brief 读取期间占用设备的一个并发额度，构造时阻塞等待额度，析构时释放并记录读取的数据量
+     *      同一线程嵌套构造时(读取函数之间相互调用)不重复占用额度
+     */
+    class UNIONIMAGESHARED_EXPORT Guard
+    {
+    public:
+        explicit Guard(const QString &path, qint64 bytes = 0);
+        ~Guard();
+
+    private:
+        Q_DISABLE_COPY(Guard)
+
+        QString         m_device;
+        qint64          m_bytes = 0;
+        bool            m_acquired = false;
+    };
+
+    static IoScheduler *instance();
+
+    // 占用设备额度顺序读取远程设备上的 \a path 文件至页缓存，之后按路径解码时无需访问设备
+    static bool readAhead(const QString &path, qint64 size);
+
+    // 取得 \a path 所属设备的标识
+    static QString deviceKey(const QString &path);
+    // 设备 \a device 是否为本地存储
+    static bool isLocalDevice(const QString &device);
+    // 取得设备 \a device 当前的并发上限
+    int concurrency(const QString &device);
+
+private:
+    IoScheduler() = default;
+    Q_DISABLE_COPY(IoScheduler)
+
+    struct Waiter;
+    struct Device;
+
+    void acquire(const QString &device, const QString &path);
+    void release(const QString &device, qint64 bytes);
+    Device &device(const QString &key);
+    void grantNext(Device &device);
+    void adjustLimit(Device &device);
+
+private:
+    QMutex                  m_mutex;
+    QHash<QString, Device*> m_devices;  // 设备标识 - 设备状态，进程内长期保留
+};
+
+}  // namespace LibUnionImage_NameSpace
+
+#endif // IOSCHEDULER_H
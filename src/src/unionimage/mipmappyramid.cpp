@@ -0,0 +1,271 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "mipmappyramid.h"
+#include "imageresampler.h"
+
+#include <QHash>
+#include <QtMath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace LibUnionImage_NameSpace {
+
+/**
+ * @brief 对上下两行 \a row0 \a row1 的 32 位像素进行 2x2 区域平均，输出 \a width 个像素到 \a dst
+ */
+static void halveRow(const uchar *row0, const uchar *row1, uchar *dst, int width)
+{
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(2);
+    // 每次处理 8 个源像素，输出 4 个像素
+    for (; x + 4 <= width; x += 4) {
+        const uchar *src0 = row0 + x * 8;
+        const uchar *src1 = row1 + x * 8;
+        __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src0));
+        __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src0 + 16));
+        __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src1));
+        __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src1 + 16));
+
+        // 垂直求和，每个寄存器包含 2 个像素的 16 位通道值
+        __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+        __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+        __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+        __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+        // 水平相邻像素求和，结果位于低 64 位
+        s0 = _mm_add_epi16(s0, _mm_srli_si128(s0, 8));
+        s1 = _mm_add_epi16(s1, _mm_srli_si128(s1, 8));
+        s2 = _mm_add_epi16(s2, _mm_srli_si128(s2, 8));
+        s3 = _mm_add_epi16(s3, _mm_srli_si128(s3, 8));
+
+        __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s0, s1), round), 2);
+        __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s2, s3), round), 2);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), _mm_packus_epi16(lo, hi));
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for (; x + 4 <= width; x += 4) {
+        // 按 32 位解交错加载，分离偶数和奇数位置的像素
+        uint32x4x2_t a = vld2q_u32(reinterpret_cast<const uint32_t *>(row0 + x * 8));
+        uint32x4x2_t b = vld2q_u32(reinterpret_cast<const uint32_t *>(row1 + x * 8));
+        uint8x16_t a0 = vreinterpretq_u8_u32(a.val[0]);
+        uint8x16_t a1 = vreinterpretq_u8_u32(a.val[1]);
+        uint8x16_t b0 = vreinterpretq_u8_u32(b.val[0]);
+        uint8x16_t b1 = vreinterpretq_u8_u32(b.val[1]);
+
+        uint16x8_t lo = vaddq_u16(vaddl_u8(vget_low_u8(a0), vget_low_u8(a1)),
+                                  vaddl_u8(vget_low_u8(b0), vget_low_u8(b1)));
+        uint16x8_t hi = vaddq_u16(vaddl_u8(vget_high_u8(a0), vget_high_u8(a1)),
+                                  vaddl_u8(vget_high_u8(b0), vget_high_u8(b1)));
+        vst1q_u8(dst + x * 4, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+    }
+#endif
+    for (; x < width; x++) {
+        const uchar *src0 = row0 + x * 8;
+        const uchar *src1 = row1 + x * 8;
+        for (int c = 0; c < 4; c++) {
+            dst[x * 4 + c] = static_cast<uchar>((src0[c] + src0[c + 4] + src1[c] + src1[c + 4] + 2) >> 2);
+        }
+    }
+}
+
+MipmapPyramid::MipmapPyramid(const QImage &image)
+{
+    setImage(image);
+}
+
+/**
+ * @brief 获取图片 \a image 的共享金字塔，按图片数据标识记录，所有使用者释放后移除
+ */
+QSharedPointer<MipmapPyramid> MipmapPyramid::shared(const QImage &image)
+{
+    if (image.isNull()) {
+        return QSharedPointer<MipmapPyramid>();
+    }
+
+    static QMutex s_mutex;
+    static QHash<qint64, QWeakPointer<MipmapPyramid>> s_pyramids;
+
+    QMutexLocker _locker(&s_mutex);
+    QSharedPointer<MipmapPyramid> pyramid = s_pyramids.value(image.cacheKey()).toStrongRef();
+    if (pyramid) {
+        return pyramid;
+    }
+
+    // 移除已释放的金字塔记录
+    for (auto itr = s_pyramids.begin(); itr != s_pyramids.end();) {
+        if (itr.value().isNull()) {
+            itr = s_pyramids.erase(itr);
+        } else {
+            ++itr;
+        }
+    }
+
+    pyramid.reset(new MipmapPyramid(image));
+    s_pyramids.insert(image.cacheKey(), pyramid);
+    return pyramid;
+}
+
+QImage MipmapPyramid::normalized(const QImage &image)
+{
+    if (image.isNull() || image.format() == QImage::Format_RGB32
+            || image.format() == QImage::Format_ARGB32_Premultiplied) {
+        return image;
+    }
+    return image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                         : QImage::Format_RGB32);
+}
+
+void MipmapPyramid::setImage(const QImage &image)
+{
+    QMutexLocker _locker(&m_mutex);
+    m_levels.clear();
+    if (!image.isNull()) {
+        m_levels.append(image);
+    }
+}
+
+void MipmapPyramid::clear()
+{
+    QMutexLocker _locker(&m_mutex);
+    m_levels.clear();
+}
+
+bool MipmapPyramid::isNull() const
+{
+    QMutexLocker _locker(&m_mutex);
+    return m_levels.isEmpty();
+}
+
+QImage MipmapPyramid::original() const
+{
+    QMutexLocker _locker(&m_mutex);
+    return m_levels.isEmpty() ? QImage() : m_levels.first();
+}
+
+int MipmapPyramid::levelCount() const
+{
+    QMutexLocker _locker(&m_mutex);
+    return m_levels.size();
+}
+
+/**
+ * @brief 获取大小为 \a requestedSize 的图片，按需生成宽高均不小于请求大小的最小一级，
+ *      并从该级平滑缩放至请求大小。请求大小大于原图时从原图缩放。
+ */
+QImage MipmapPyramid::image(const QSize &requestedSize)
+{
+    QMutexLocker _locker(&m_mutex);
+    if (m_levels.isEmpty()) {
+        return QImage();
+    }
+    if (requestedSize.width() <= 0 || requestedSize.height() <= 0) {
+        return m_levels.first();
+    }
+
+    const QImage source = m_levels.at(levelIndex(requestedSize));
+    _locker.unlock();
+
+    if (source.size() == requestedSize) {
+        return source;
+    }
+    return ImageResampler::scale(source, requestedSize);
+}
+
+/**
+ * @brief 获取相对原图缩放比例不小于 \a scale 的最小一级图片，
+ *      各级宽高按整数减半，实际缩放比例需通过图片大小计算
+ */
+QImage MipmapPyramid::levelForScale(qreal scale)
+{
+    QMutexLocker _locker(&m_mutex);
+    if (m_levels.isEmpty()) {
+        return QImage();
+    }
+
+    const QSize originalSize = m_levels.first().size();
+    const QSize minSize(qMax(1, qCeil(originalSize.width() * scale)), qMax(1, qCeil(originalSize.height() * scale)));
+    return m_levels.at(levelIndex(minSize));
+}
+
+/**
+ * @brief 在加载图片的线程中预先生成各级图片，后续请求时仅需查找，不会在调用线程中生成
+ */
+void MipmapPyramid::buildLevels(const QSize &minSize)
+{
+    QMutexLocker _locker(&m_mutex);
+    if (!m_levels.isEmpty()) {
+        levelIndex(minSize);
+    }
+}
+
+/**
+ * @return 宽高均不小于 \a minSize 的最小一级的索引，不存在时继续生成，需在加锁后调用
+ */
+int MipmapPyramid::levelIndex(const QSize &minSize)
+{
+    int level = 0;
+    forever {
+        if (level + 1 < m_levels.size()) {
+            const QSize nextSize = m_levels.at(level + 1).size();
+            if (nextSize.width() < minSize.width() || nextSize.height() < minSize.height()) {
+                break;
+            }
+            level++;
+            continue;
+        }
+
+        const QImage &current = m_levels.at(level);
+        if (current.width() / 2 < minSize.width() || current.height() / 2 < minSize.height()) {
+            break;
+        }
+        QImage next = halve(current);
+        if (next.isNull()) {
+            break;
+        }
+        m_levels.append(next);
+        level++;
+    }
+
+    return level;
+}
+
+QImage MipmapPyramid::halve(const QImage &image)
+{
+    if (image.width() < 2 || image.height() < 2) {
+        return QImage();
+    }
+
+    // 区域平均按 32 位像素处理，含透明通道的图片使用预乘格式，避免透明像素的颜色混入
+    QImage source = image;
+    switch (source.format()) {
+    case QImage::Format_RGBX8888:
+    case QImage::Format_RGBA8888_Premultiplied:
+        break;
+    default:
+        source = normalized(source);
+        break;
+    }
+
+    QImage result(source.width() / 2, source.height() / 2, source.format());
+    if (result.isNull()) {
+        return QImage();
+    }
+
+    for (int y = 0; y < result.height(); y++) {
+        halveRow(source.constScanLine(y * 2), source.constScanLine(y * 2 + 1), result.scanLine(y), result.width());
+    }
+
+    result.setDotsPerMeterX(image.dotsPerMeterX());
+    result.setDotsPerMeterY(image.dotsPerMeterY());
+    return result;
+}
+
+}  // namespace LibUnionImage_NameSpace
@@ -0,0 +1,67 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef MIPMAPPYRAMID_H
+#define MIPMAPPYRAMID_H
+
+#include "unionimage.h"
+
+#include <QImage>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QVector>
+
+namespace LibUnionImage_NameSpace {
+
+/**
+ * @brief 图片的 Mipmap 金字塔
+ *      保留原始图片，按需逐级生成宽高减半的图片，每一级由上一级通过 2x2 区域平均(SIMD)生成。
+ *      请求指定大小的图片时，从不小于请求大小的最近一级缩放，
+ *      缩放比例不超过 2 倍，避免反复从原图缩放，且不会因覆盖原图而损失画质。
+ *      相同的图片数据通过 shared() 获取同一个金字塔，多个使用者共享已生成的各级图片。
+ * @threadsafe 生成各级图片时加锁，从某一级缩放至请求大小在锁外进行
+ */
+class UNIONIMAGESHARED_EXPORT MipmapPyramid
+{
+public:
+    MipmapPyramid() = default;
+    explicit MipmapPyramid(const QImage &image);
+
+    // 获取图片 \a image 的共享金字塔，图片数据相同(QImage::cacheKey())时返回同一个对象
+    static QSharedPointer<MipmapPyramid> shared(const QImage &image);
+    // 转换为生成各级图片使用的 32 位格式(RGB32 或 ARGB32_Premultiplied)，已是该格式时不复制
+    static QImage normalized(const QImage &image);
+
+    // 设置原始图片 \a image ，已生成的各级图片被清除
+    void setImage(const QImage &image);
+    void clear();
+
+    bool isNull() const;
+    // 原始图片
+    QImage original() const;
+    // 已生成的级数，包含原始图片
+    int levelCount() const;
+
+    // 获取大小为 \a requestedSize 的图片，无效大小时返回原始图片
+    QImage image(const QSize &requestedSize);
+    // 获取相对原图缩放比例不小于 \a scale 的最小一级图片
+    QImage levelForScale(qreal scale);
+    // 预先生成宽高均不小于 \a minSize 的各级图片
+    void buildLevels(const QSize &minSize);
+
+    // 2x2 区域平均将图片 \a image 的宽高减半，宽高为奇数时舍弃最后一列(行)
+    static QImage halve(const QImage &image);
+
+private:
+    Q_DISABLE_COPY(MipmapPyramid)
+    int levelIndex(const QSize &minSize);
+
+private:
+    mutable QMutex  m_mutex;
+    QVector<QImage> m_levels;   // 第 0 级为原始图片
+};
+
+}  // namespace LibUnionImage_NameSpace
+
+#endif // MIPMAPPYRAMID_H
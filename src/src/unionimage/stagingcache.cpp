@@ -0,0 +1,254 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "stagingcache.h"
+#include "ioscheduler.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <QUrl>
+#include <QtConcurrent>
+
+namespace LibUnionImage_NameSpace {
+
+// 拷贝中的临时文件后缀，完成后重命名
+static const QString s_partSuffix = ".part";
+
+StagingCache::StagingCache()
+{
+    m_cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/staging";
+    QDir().mkpath(m_cacheDir);
+    m_prefetchPool.setMaxThreadCount(1);
+
+    // 移除之前运行时残留的过期副本
+    evict(0);
+}
+
+StagingCache::LocalFile::LocalFile(const QString &path)
+    : m_path(StagingCache::instance()->pin(path))
+{
+}
+
+StagingCache::LocalFile::~LocalFile()
+{
+    if (!m_path.isEmpty()) {
+        StagingCache::instance()->unpin(m_path);
+    }
+}
+
+QString StagingCache::LocalFile::path() const
+{
+    return m_path;
+}
+
+StagingCache *StagingCache::instance()
+{
+    static StagingCache s_cache;
+    return &s_cache;
+}
+
+bool StagingCache::needStaging(const QString &path)
+{
+    switch (getPathType(path)) {
+    case imageViewerSpace::PathTypeSMB:
+    case imageViewerSpace::PathTypeMTP:
+    case imageViewerSpace::PathTypePTP:
+    case imageViewerSpace::PathTypeAPPLE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @return 文件 \a info 对应的缓存文件路径，保留文件后缀，解码时可按后缀判断格式
+ */
+QString StagingCache::cacheFilePath(const QFileInfo &info) const
+{
+    QByteArray key = QUrl::fromLocalFile(info.absoluteFilePath()).toEncoded();
+    key.append('\n').append(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    key.append('\n').append(QByteArray::number(info.size()));
+
+    QString fileName = QString::fromLatin1(QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex());
+    if (!info.suffix().isEmpty()) {
+        fileName += "." + info.suffix();
+    }
+    return m_cacheDir + "/" + fileName;
+}
+
+/**
+ * @brief 取得远程文件 \a path 的本地副本并持有，持有期间 evict() 不会移除该副本。
+ *      暂存完成至持有之间副本可能已被其他线程移除，此时重新暂存
+ * @return 本地副本路径，无需暂存、文件过大或拷贝失败时返回空字符串
+ */
+QString StagingCache::pin(const QString &path)
+{
+    for (int retry = 0; retry < 2; retry++) {
+        const QString target = stagedFile(path);
+        if (target.isEmpty()) {
+            return target;
+        }
+
+        QMutexLocker _locker(&m_evictMutex);
+        if (QFile::exists(target)) {
+            m_pins[target]++;
+            return target;
+        }
+    }
+    return QString();
+}
+
+void StagingCache::unpin(const QString &target)
+{
+    QMutexLocker _locker(&m_evictMutex);
+    auto itr = m_pins.find(target);
+    if (itr != m_pins.end() && --itr.value() <= 0) {
+        m_pins.erase(itr);
+    }
+}
+
+/**
+ * @brief 取得远程文件 \a path 的本地副本，已缓存时直接返回，否则阻塞拷贝。
+ *      相同文件的并发请求(包括后台预取)仅拷贝一次
+ * @return 本地副本路径，无需暂存、文件过大或拷贝失败时返回空字符串
+ */
+QString StagingCache::stagedFile(const QString &path)
+{
+    if (!needStaging(path)) {
+        return QString();
+    }
+
+    return m_flight.run(path, [this, &path]() {
+        return stage(path);
+    });
+}
+
+/**
+ * @brief 在后台依次暂存 \a paths 中需要暂存的文件，新的请求会取消之前尚未开始的暂存
+ */
+void StagingCache::prefetch(const QStringList &paths)
+{
+    m_prefetchPool.clear();
+    for (const QString &path : paths) {
+        if (!needStaging(path)) {
+            continue;
+        }
+
+        QtConcurrent::run(&m_prefetchPool, [this, path]() {
+            stagedFile(path);
+        });
+    }
+}
+
+QString StagingCache::stage(const QString &path)
+{
+    QFileInfo info(path);
+    if (!info.isFile() || info.size() <= 0 || info.size() > EMaxFileBytes) {
+        return QString();
+    }
+
+    const QString target = cacheFilePath(info);
+    if (QFile::exists(target)) {
+        // 更新修改时间，作为最近访问时间用于移除旧缓存
+        QFile file(target);
+        if (file.open(QIODevice::ReadWrite)) {
+            file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        }
+        return target;
+    }
+
+    evict(info.size());
+    if (!copyFile(path, target, info.size())) {
+        return QString();
+    }
+    return target;
+}
+
+/**
+ * @brief 按 EBlockSize 大块顺序将 \a source 拷贝至 \a target ，拷贝期间占用源文件所在设备的读取额度
+ */
+bool StagingCache::copyFile(const QString &source, const QString &target, qint64 size)
+{
+    IoScheduler::Guard ioGuard(source, size);
+
+    QFile input(source);
+    if (!input.open(QIODevice::ReadOnly)) {
+        qWarning() << "StagingCache: open source failed," << source << input.errorString();
+        return false;
+    }
+
+    const QString partPath = target + s_partSuffix;
+    QFile output(partPath);
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "StagingCache: open target failed," << partPath << output.errorString();
+        return false;
+    }
+
+    QByteArray buffer(EBlockSize, Qt::Uninitialized);
+    qint64 copied = 0;
+    forever {
+        const qint64 readBytes = input.read(buffer.data(), buffer.size());
+        if (readBytes < 0) {
+            qWarning() << "StagingCache: read failed," << source << input.errorString();
+            break;
+        }
+        if (0 == readBytes) {
+            break;
+        }
+        if (output.write(buffer.constData(), readBytes) != readBytes) {
+            qWarning() << "StagingCache: write failed," << partPath << output.errorString();
+            break;
+        }
+        copied += readBytes;
+    }
+    output.close();
+
+    // 读取不完整(设备断开或文件被修改)时丢弃
+    if (copied != size || !QFile::rename(partPath, target)) {
+        QFile::remove(partPath);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 移除最久未访问的缓存文件，保证加入 \a incomingBytes 后缓存总大小不超过 EMaxCacheBytes ，
+ *      并移除超过 EMaxFileAge 未访问的文件。正在读取(被持有)的文件不移除，仍计入缓存大小。
+ *      同时清理残留的临时文件(拷贝过程中程序退出)
+ */
+void StagingCache::evict(qint64 incomingBytes)
+{
+    QMutexLocker _locker(&m_evictMutex);
+
+    QDir dir(m_cacheDir);
+    const QDateTime now = QDateTime::currentDateTime();
+    // 按修改时间排序，最近访问的在前
+    QFileInfoList files = dir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot, QDir::Time);
+    qint64 totalBytes = incomingBytes;
+    for (const QFileInfo &file : files) {
+        const qint64 age = file.lastModified().secsTo(now);
+        // 残留超过一小时的临时文件
+        if (file.fileName().endsWith(s_partSuffix)) {
+            if (age > 3600) {
+                QFile::remove(file.absoluteFilePath());
+            }
+            continue;
+        }
+
+        totalBytes += file.size();
+        if (m_pins.contains(file.absoluteFilePath())) {
+            continue;
+        }
+        if (totalBytes > EMaxCacheBytes || age > EMaxFileAge) {
+            QFile::remove(file.absoluteFilePath());
+            totalBytes -= file.size();
+        }
+    }
+}
+
+}  // namespace LibUnionImage_NameSpace
@@ -0,0 +1,96 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef STAGINGCACHE_H
+#define STAGINGCACHE_H
+
+#include "unionimage.h"
+#include "utils/singleflight.h"
+
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+namespace LibUnionImage_NameSpace {
+
+/**
+ * @brief 远程路径图片的本地暂存缓存
+ *      gvfs 挂载的 SMB 共享及 MTP/PTP 设备通过 FUSE 访问，解码器频繁的小块随机读取每次都是一次网络或 USB 往返，
+ *      读取一张较大的 TIFF 可能需要数秒。此类将这些路径的文件按大块顺序拷贝到本地缓存目录，解码时读取本地副本。
+ *      缓存文件以 文件 URI + 修改时间 + 大小 作为标识，文件变更后自动失效；
+ *      缓存总大小超过上限时按最近访问时间移除旧文件，超过 EMaxFileAge 未访问的文件同样移除。
+ *      正在读取的副本通过 LocalFile 持有，持有期间不会被移除。
+ *      prefetch() 在后台按顺序暂存相邻的图片，切换图片时可直接从本地读取。
+ *
+ * @code
+ *  StagingCache::LocalFile staged(path);       // 不存在时拷贝
+ *  if (!staged.path().isEmpty()) {
+ *      reader.setFileName(staged.path());
+ *  }
+ * @endcode
+ * @threadsafe
+ */
+class UNIONIMAGESHARED_EXPORT StagingCache
+{
+public:
+    enum Constant {
+        EBlockSize = 4 * 1024 * 1024,           // 顺序拷贝的块大小 4MB
+        EMaxCacheBytes = 512 * 1024 * 1024,     // 缓存总大小上限 512MB
+        EMaxFileBytes = 128 * 1024 * 1024,      // 超过 128MB 的文件不暂存，直接读取
+        EMaxFileAge = 24 * 3600,                // 超过一天未访问的副本移除(秒)
+    };
+
+    /**
+     * @brief 远程文件的本地副本，构造时取得副本(不存在时阻塞拷贝)，对象存在期间副本不会被移除
+     */
+    class UNIONIMAGESHARED_EXPORT LocalFile
+    {
+    public:
+        explicit LocalFile(const QString &path);
+        ~LocalFile();
+
+        // 本地副本路径，无需暂存、文件过大或拷贝失败时为空
+        QString path() const;
+
+    private:
+        Q_DISABLE_COPY(LocalFile)
+
+        QString m_path;
+    };
+
+    static StagingCache *instance();
+
+    // \a path 是否为需要暂存的远程路径(SMB/MTP/PTP)
+    static bool needStaging(const QString &path);
+
+    // 在后台依次暂存 \a paths 中的远程文件，取消之前未开始的暂存
+    void prefetch(const QStringList &paths);
+
+private:
+    StagingCache();
+    Q_DISABLE_COPY(StagingCache)
+
+    QString cacheFilePath(const QFileInfo &info) const;
+    QString stagedFile(const QString &path);
+    QString stage(const QString &path);
+    bool copyFile(const QString &source, const QString &target, qint64 size);
+    void evict(qint64 incomingBytes);
+
+    QString pin(const QString &path);
+    void unpin(const QString &target);
+
+private:
+    QString                         m_cacheDir;         // 缓存目录
+    QMutex                          m_evictMutex;       // 移除及持有缓存文件时加锁
+    QHash<QString, int>             m_pins;             // 正在读取的缓存文件 - 持有数，由 m_evictMutex 保护
+    SingleFlight<QString, QString>  m_flight;           // 合并相同文件的并发暂存
+    QThreadPool                     m_prefetchPool;     // 后台预取，单线程顺序拷贝
+};
+
+}  // namespace LibUnionImage_NameSpace
+
+#endif // STAGINGCACHE_H
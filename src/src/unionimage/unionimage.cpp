@@ -21,9 +21,13 @@
 #include <QMimeDatabase>
 #include <QtSvg/QSvgRenderer>
 #include <QDir>
+#include <QFile>
 #include <QDebug>
+#include <QScopedPointer>
 
 #include "unionimage/imageutils.h"
+#include "unionimage/ioscheduler.h"
+#include "unionimage/stagingcache.h"
 
 #include <cstring>
 
@@ -616,12 +620,27 @@ UNIONIMAGESHARED_EXPORT bool creatNewImage(QImage &res, int width, int height, i
 QString PrivateDetectImageFormat(const QString &filepath);
 UNIONIMAGESHARED_EXPORT bool loadStaticImageFromFile(const QString &path, QImage &res, QString &errorMsg, const QString &format_bar)
 {
+    // SMB/MTP/PTP 等远程路径拷贝至本地后解码，避免解码器的随机读取逐次访问远程设备，解码期间持有本地副本
+    if (StagingCache::needStaging(path)) {
+        const StagingCache::LocalFile staged(path);
+        if (!staged.path().isEmpty()) {
+            return loadStaticImageFromFile(staged.path(), res, errorMsg, format_bar);
+        }
+    }
+
     QFileInfo file_info(path);
     if (file_info.size() == 0) {
         res = QImage();
         errorMsg = "error file!";
         return false;
     }
+    // 按文件所在设备限制并发读取，MTP/PTP 等设备每次仅读取一个文件。
+    // 远程设备仅在读取文件至页缓存期间占用设备额度，之后的元数据读取和解码不受设备并发上限限制；
+    // 本地文件不重复读取，解码器读取文件期间占用额度
+    QScopedPointer<IoScheduler::Guard> ioGuard;
+    if (!IoScheduler::readAhead(path, file_info.size())) {
+        ioGuard.reset(new IoScheduler::Guard(path, file_info.size()));
+    }
     QMap<QString, QString> dataMap = getAllMetaData(path);
     QString file_suffix_upper = dataMap.value("FileFormat").toUpper();
 
@@ -1279,64 +1298,246 @@ bool getThumbnail(QImage &res, const QString &path)
 }
 #endif
 
-#if 0
-class UnionMovieImagePrivate : public QObject
+// GIF 帧的处置方式，参见 GIF89a 规范 Graphic Control Extension
+enum GifDisposalMethod {
+    GifDisposalUnspecified = 0,     // 未指定，同 GifDisposalLeave
+    GifDisposalLeave = 1,           // 保留当前帧
+    GifDisposalBackground = 2,      // 恢复为背景(透明)
+    GifDisposalPrevious = 3,        // 恢复为绘制当前帧之前的画布
+};
+
+// 动图关键帧快照可使用的内存，关键帧间隔根据此大小计算
+const qint64 MOVIE_KEYFRAME_BUDGET = 32 * 1024 * 1024;
+
+/**
+ * @brief 读取 FreeImage 动图元数据 \a key ，不存在时返回 \a defaultValue
+ */
+template<typename T>
+T animationMetadata(FIBITMAP *dib, const char *key, T defaultValue)
+{
+    FITAG *tag = nullptr;
+    if (FreeImage_GetMetadata(FIMD_ANIMATION, dib, key, &tag) && tag && FreeImage_GetTagValue(tag)) {
+        return *static_cast<const T *>(FreeImage_GetTagValue(tag));
+    }
+    return defaultValue;
+}
+
+class UnionMovieImagePrivate
 {
-protected:
+public:
     explicit UnionMovieImagePrivate(UnionMovieImage *parent): q_ptr(parent)
     {
-        Q_UNUSED(padding);
     }
     ~UnionMovieImagePrivate()
     {
-//        CManagerAttributeService::getInstance()->setCouldRun(false);
-//        CManagerAttributeService::getInstance()->GifFreeFile();
+        reset();
     }
 
-
-    void setPathAndBegin(const QString &path)
+    void reset()
     {
-        Q_UNUSED(path)
-//        CManagerAttributeService::getInstance()->setfilePathWithSignalPlay(path);
-//        QObject::connect(CManagerAttributeService::getInstance(), &CManagerAttributeService::emitImageSignal, this, [ = ](QImage image, bool isFirst) {
-//            Q_UNUSED(isFirst);
-//            res = image;
-//        });
+        if (gif) {
+            FreeImage_CloseMultiBitmap(gif);
+            gif = nullptr;
+        }
+        delete reader;
+        reader = nullptr;
+
+        path.clear();
+        currentFormat = FIF_UNKNOWN;
+        size = QSize();
+        frames = 0;
+        currentIndex = 0;
+        delay = 0;
+        canvas = QImage();
+        previousCanvas = QImage();
+        disposeRect = QRect();
+        disposeMethod = GifDisposalUnspecified;
+        keyframes.clear();
+        keyframeInterval = 0;
     }
 
-    int getCurrent()
+    bool openGif()
     {
-        return currentIndex;
+        // 不使用 GIF_PLAYBACK ，其每帧都会从首帧重新合成，由此处增量合成
+        gif = FreeImage_OpenMultiBitmap(FIF_GIF, QFile::encodeName(path).constData(), FALSE, TRUE, TRUE, 0);
+        if (!gif) {
+            return false;
+        }
+
+        frames = FreeImage_GetPageCount(gif);
+        FIBITMAP *first = frames > 0 ? FreeImage_LockPage(gif, 0) : nullptr;
+        if (!first) {
+            return false;
+        }
+        WORD width = animationMetadata<WORD>(first, "LogicalWidth", static_cast<WORD>(FreeImage_GetWidth(first)));
+        WORD height = animationMetadata<WORD>(first, "LogicalHeight", static_cast<WORD>(FreeImage_GetHeight(first)));
+        FreeImage_UnlockPage(gif, first, FALSE);
+
+        size = QSize(width, height);
+        if (size.isEmpty()) {
+            return false;
+        }
+
+        // 在内存限制内尽量多地保存关键帧，小图片每帧均保存
+        qint64 frameBytes = qint64(size.width()) * size.height() * 4;
+        int maxKeyframes = static_cast<int>(qMax<qint64>(1, MOVIE_KEYFRAME_BUDGET / frameBytes));
+        keyframeInterval = qMax(1, (frames + maxKeyframes - 1) / maxKeyframes);
+        return true;
     }
 
-    void reset()
+    bool openReader()
     {
-//        CManagerAttributeService::getInstance()->setCouldRun(false);
-//        CManagerAttributeService::getInstance()->GifFreeFile();
+        reader = new QImageReader(path);
+        if (!reader->canRead()) {
+            return false;
+        }
 
-        delete r;
-        r = nullptr;
-        errMsg = "";
-        res = QImage();
-        currentFormat = FIF_UNKNOWN;
+        frames = reader->imageCount();
+        size = reader->size();
+        return true;
+    }
+
+    void restartReader()
+    {
+        // QImageReader 仅支持顺序读取，重新打开文件从首帧开始
+        reader->setFileName(QString());
+        reader->setFileName(path);
         currentIndex = 0;
-        frames = 0;
     }
 
-    void setIndex(int i)
+    /**
+     * @brief 处理上一帧的处置方式后，将帧 \a index 合成到画布上，
+     *      要求之前的帧已按顺序合成
+     */
+    QImage composeGifFrame(int index)
     {
-        currentIndex = i;
+        if (0 == index || canvas.isNull()) {
+            canvas = QImage(size, QImage::Format_ARGB32_Premultiplied);
+            canvas.fill(Qt::transparent);
+            disposeMethod = GifDisposalUnspecified;
+        }
+
+        QPainter painter(&canvas);
+        switch (disposeMethod) {
+        case GifDisposalBackground:
+            painter.setCompositionMode(QPainter::CompositionMode_Clear);
+            painter.fillRect(disposeRect, Qt::transparent);
+            break;
+        case GifDisposalPrevious:
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+            painter.drawImage(disposeRect.topLeft(), previousCanvas);
+            break;
+        default:
+            break;
+        }
+        painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+        FIBITMAP *page = FreeImage_LockPage(gif, index);
+        if (!page) {
+            delay = 100;
+            return canvas;
+        }
+
+        int left = animationMetadata<WORD>(page, "FrameLeft", 0);
+        int top = animationMetadata<WORD>(page, "FrameTop", 0);
+        int disposal = animationMetadata<BYTE>(page, "DisposalMethod", GifDisposalUnspecified);
+        int frameTime = static_cast<int>(animationMetadata<LONG>(page, "FrameTime", 100));
+        // 转换为 32 位时将透明色转换为 alpha 通道
+        FIBITMAP *page32 = FreeImage_ConvertTo32Bits(page);
+        FreeImage_UnlockPage(gif, page, FALSE);
+        QImage frame = FIBitmap2QImage(page32);
+        FreeImage_Unload(page32);
+
+        QRect frameRect = QRect(QPoint(left, top), frame.size()).intersected(canvas.rect());
+        if (GifDisposalPrevious == disposal) {
+            previousCanvas = canvas.copy(frameRect);
+        }
+        painter.drawImage(QPoint(left, top), frame);
+        painter.end();
+
+        disposeRect = frameRect;
+        disposeMethod = disposal;
+
+        // 每隔 keyframeInterval 帧保存合成后的画布状态，跳转时从最近的关键帧继续合成
+        if (0 == (index + 1) % keyframeInterval && !keyframes.contains(index)) {
+            keyframes.insert(index, GifKeyframe{canvas, previousCanvas, disposeRect, disposeMethod});
+        }
+        // 与浏览器一致，过短的帧间隔按 100ms 处理
+        delay = frameTime <= 10 ? 100 : frameTime;
+        return canvas;
     }
+
+    /**
+     * @brief 跳转到 GIF 帧 \a index ，从当前位置或 \a index 之前最近的关键帧开始合成，
+     *      避免每次跳转都从首帧开始合成
+     */
+    void seekGif(int index)
+    {
+        int start = index >= currentIndex ? currentIndex : 0;
+        auto itr = keyframes.lowerBound(index);
+        if (itr != keyframes.constBegin() && (--itr).key() + 1 > start) {
+            const GifKeyframe &keyframe = itr.value();
+            canvas = keyframe.canvas;
+            previousCanvas = keyframe.previousCanvas;
+            disposeRect = keyframe.disposeRect;
+            disposeMethod = keyframe.disposeMethod;
+            start = itr.key() + 1;
+        }
+        currentIndex = start;
+
+        while (currentIndex < index) {
+            readNext();
+        }
+    }
+
+    QImage readNext()
+    {
+        QImage image;
+        if (FIF_GIF == currentFormat) {
+            if (currentIndex >= frames) {
+                currentIndex = 0;
+            }
+            image = composeGifFrame(currentIndex);
+        } else if (reader) {
+            if ((frames > 0 && currentIndex >= frames) || !reader->canRead()) {
+                restartReader();
+            }
+            image = reader->read();
+            delay = qMax(0, reader->nextImageDelay());
+        }
+
+        currentIndex++;
+        return image;
+    }
+
 private:
     UnionMovieImage *const q_ptr;
     Q_DECLARE_PUBLIC(UnionMovieImage)
-    QImageReader *r = nullptr;
-    QString errMsg = "";
-    QImage res;
+
+public:
+    QString path;
     FREE_IMAGE_FORMAT currentFormat = FIF_UNKNOWN;
-    int currentIndex = 0;
+    FIMULTIBITMAP *gif = nullptr;       // GIF 多帧图像
+    QImageReader *reader = nullptr;     // WebP/MNG 读取
+    QSize size;                         // 画布大小
     int frames = 0;
-    char padding[4];
+    int currentIndex = 0;               // 下一帧帧号
+    int delay = 0;                      // 最近读取帧的展示时长
+
+    QImage canvas;                      // GIF 合成画布
+    QImage previousCanvas;              // GifDisposalPrevious 需要恢复的画布区域
+    QRect disposeRect;                  // 上一帧区域
+    int disposeMethod = GifDisposalUnspecified;     // 上一帧的处置方式
+
+    // 关键帧，合成帧后的画布状态
+    struct GifKeyframe {
+        QImage  canvas;
+        QImage  previousCanvas;
+        QRect   disposeRect;
+        int     disposeMethod;
+    };
+    QMap<int, GifKeyframe> keyframes;   // 关键帧 QMap<帧号, 合成该帧后的状态>
+    int keyframeInterval = 0;           // 关键帧间隔，按内存限制计算
 };
 
 UnionMovieImage::UnionMovieImage(): d_ptr(new UnionMovieImagePrivate(this))
@@ -1350,65 +1551,98 @@ UnionMovieImage::~UnionMovieImage()
     delete d;
 }
 
-void UnionMovieImage::setFileName(const QString &path)
+bool UnionMovieImage::setFileName(const QString &path)
 {
     Q_D(UnionMovieImage);
     d->reset();
-    QString errMsg;
+
     QFileInfo file_info(path);
     QString file_suffix_upper = file_info.suffix().toUpper();
-    QByteArray temp_path;
-    temp_path.append(path.toUtf8());
-    FREE_IMAGE_FORMAT f = FreeImage_GetFileType(temp_path.data());
-    if (!union_image_private.m_movie_formats.contains(file_suffix_upper) || !union_image_private.m_movie_formats.values().contains(f)) {
-        errMsg = "static Image";
+    FREE_IMAGE_FORMAT f = FreeImage_GetFileType(QFile::encodeName(path).constData());
+    if (!union_image_private.m_movie_formats.contains(file_suffix_upper)) {
+        // static Image
+        return false;
+    }
+
+    d->path = path;
+    bool ret = false;
+    if (FIF_GIF == f) {
+        d->currentFormat = FIF_GIF;
+        ret = d->openGif();
     } else {
-        switch (f) {
-        case FIF_GIF: {
-            d->setPathAndBegin(path);
-            d->currentFormat = FIF_GIF;
-        }
-        break;
-        case FIF_WEBP:
-        case FIF_MNG: {
-            d->r = new QImageReader;
-            d->r->setFileName(path);
-            if (d->r->canRead()) {
-                d->currentFormat = FIF_MNG;
-                d->frames = d->r->imageCount();
-            }
-        }
-        break;
-        default:
-            break;
-        }
+        // WebP/MNG 或 FreeImage 无法识别的格式使用 Qt 插件读取
+        d->currentFormat = f;
+        ret = d->openReader();
     }
+
+    if (!ret) {
+        qWarning() << "UnionMovieImage: open movie image failed," << path;
+        d->reset();
+    }
+    return ret;
+}
+
+bool UnionMovieImage::isValid() const
+{
+    Q_D(const UnionMovieImage);
+    return d->gif || d->reader;
+}
+
+int UnionMovieImage::frameCount() const
+{
+    Q_D(const UnionMovieImage);
+    return d->frames;
+}
+
+QSize UnionMovieImage::size() const
+{
+    Q_D(const UnionMovieImage);
+    return d->size;
+}
+
+int UnionMovieImage::currentIndex() const
+{
+    Q_D(const UnionMovieImage);
+    return d->currentIndex;
+}
+
+int UnionMovieImage::frameDelay() const
+{
+    Q_D(const UnionMovieImage);
+    return d->delay;
 }
 
 QImage UnionMovieImage::next()
 {
     Q_D(UnionMovieImage);
-    switch (d->currentFormat) {
-    case FIF_GIF: {
-        return d->res;
-    }
-    case FIF_WEBP:
-    case FIF_MNG: {
-        int temp = d->currentIndex;
-        d->setIndex(temp + 1);
-        if (temp + 1 >= d->frames) {
-            d->setIndex(0);
-        }
-        d->res = d->r->read();
-        d->r->jumpToNextImage();
-        break;
+    if (!isValid()) {
+        return QImage();
     }
-    default:
-        break;
+    return d->readNext();
+}
+
+bool UnionMovieImage::jumpToFrame(int index)
+{
+    Q_D(UnionMovieImage);
+    if (!isValid() || index < 0 || (d->frames > 0 && index >= d->frames)) {
+        return false;
     }
-    return d->res;
+
+    if (FIF_GIF == d->currentFormat) {
+        d->seekGif(index);
+        return true;
+    }
+
+    // QImageReader 由插件内部合成且仅支持顺序读取，向前跳转时需从首帧重新开始
+    if (index < d->currentIndex) {
+        d->restartReader();
+    }
+
+    while (d->currentIndex < index) {
+        d->readNext();
+    }
+    return true;
 }
-#endif
 
 imageViewerSpace::ImageType getImageType(const QString &imagepath)
 {
@@ -203,6 +203,9 @@ class UnionMovieImagePrivate;
  * @brief The UnionDynamicImage class
  * @author DJH
  * 用来读取动态图片,使用下标来获取动图的每一帧
+ * GIF 通过 FreeImage 读取原始帧，按帧的处置方式(Disposal Method)在画布上增量合成；
+ * WebP/MNG 通过 QImageReader 顺序读取，由图像插件合成。
+ * @note 非线程安全，应在同一线程中使用
  */
 class UNIONIMAGESHARED_EXPORT UnionMovieImage
 {
@@ -210,7 +213,21 @@ public:
     explicit UnionMovieImage();
     ~UnionMovieImage();
 
-    void setFileName(const QString &path);
+    /**
+     * @brief setFileName 设置动图文件
+     * @return 是否为可读取的动图
+     */
+    bool setFileName(const QString &path);
+    bool isValid() const;
+
+    // 动图的帧数及画布大小
+    int frameCount() const;
+    QSize size() const;
+
+    // 下一次 next() 返回的帧号
+    int currentIndex() const;
+    // 最近一次 next() 返回的帧的展示时长，单位 ms
+    int frameDelay() const;
 
     /**
      * @brief next
@@ -219,6 +236,13 @@ public:
      */
     QImage next();
 
+    /**
+     * @brief jumpToFrame 跳转到帧 \a index ，下一次 next() 返回该帧
+     * GIF 从最近的关键帧(按内存限制定期保存的合成画布)继续合成，无需从首帧开始
+     * @return 是否跳转成功
+     */
+    bool jumpToFrame(int index);
+
 private:
     UnionMovieImagePrivate *const d_ptr;
     Q_DECLARE_PRIVATE(UnionMovieImage)
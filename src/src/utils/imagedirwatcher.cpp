@@ -0,0 +1,237 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "imagedirwatcher.h"
+
+#include <QTimer>
+#include <QSocketNotifier>
+#include <QDir>
+#include <QFile>
+#include <QDebug>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+// 文件夹观察的事件类型
+static const uint32_t s_watchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                                    | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+ImageDirWatcher::ImageDirWatcher(QObject *parent)
+    : QObject(parent)
+{
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (-1 == m_inotifyFd) {
+        qWarning() << "ImageDirWatcher: inotify init failed," << strerror(errno);
+        return;
+    }
+
+    m_notifier = new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+    // Qt5.15 中 activated 信号存在重载，使用字符串形式关联
+    connect(m_notifier, SIGNAL(activated(int)), this, SLOT(onReadyRead()));
+
+    m_coalesceTimer = new QTimer(this);
+    m_coalesceTimer->setSingleShot(true);
+    m_coalesceTimer->setInterval(ECoalesceInterval);
+    connect(m_coalesceTimer, &QTimer::timeout, this, &ImageDirWatcher::flushChanges);
+}
+
+ImageDirWatcher::~ImageDirWatcher()
+{
+    if (-1 != m_inotifyFd) {
+        ::close(m_inotifyFd);
+        m_inotifyFd = -1;
+    }
+}
+
+/**
+ * @brief 设置当前观察的文件夹 \a dir ，将移除之前观察的文件夹，未发送的变更将被丢弃。
+ * @return 是否成功添加观察
+ */
+bool ImageDirWatcher::setDirectory(const QString &dir)
+{
+    if (dir == m_dir && -1 != m_watchDescriptor) {
+        return true;
+    }
+
+    clear();
+    if (dir.isEmpty() || -1 == m_inotifyFd) {
+        return false;
+    }
+
+    QByteArray localDir = QFile::encodeName(dir);
+    m_watchDescriptor = inotify_add_watch(m_inotifyFd, localDir.constData(), s_watchMask);
+    if (-1 == m_watchDescriptor) {
+        qWarning() << "ImageDirWatcher: add watch failed," << dir << strerror(errno);
+        return false;
+    }
+
+    m_dir = dir;
+    return true;
+}
+
+QString ImageDirWatcher::directory() const
+{
+    return m_dir;
+}
+
+void ImageDirWatcher::clear()
+{
+    if (-1 != m_watchDescriptor) {
+        inotify_rm_watch(m_inotifyFd, m_watchDescriptor);
+        m_watchDescriptor = -1;
+    }
+
+    m_dir.clear();
+    m_pendingChanges.clear();
+    if (m_coalesceTimer) {
+        m_coalesceTimer->stop();
+    }
+}
+
+/**
+ * @brief 读取 inotify 事件，记录变更的文件名，通过定时器延迟合并发送
+ */
+void ImageDirWatcher::onReadyRead()
+{
+    // 事件缓冲区，需要按 inotify_event 对齐
+    alignas(struct inotify_event) char buffer[16 * 1024];
+    bool invalidated = false;
+
+    forever {
+        ssize_t len = ::read(m_inotifyFd, buffer, sizeof(buffer));
+        if (len <= 0) {
+            // EAGAIN 表示事件读取完成
+            break;
+        }
+
+        for (char *ptr = buffer; ptr < buffer + len;) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // 事件队列溢出，增量信息已不可信
+                invalidated = true;
+                continue;
+            }
+
+            if (event->wd != m_watchDescriptor) {
+                continue;
+            }
+
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                // 文件夹被移除后，内核自动移除观察
+                if (event->mask & IN_IGNORED) {
+                    m_watchDescriptor = -1;
+                }
+                invalidated = true;
+                continue;
+            }
+
+            // 子文件夹变更无需处理
+            if ((event->mask & IN_ISDIR) || 0 == event->len) {
+                continue;
+            }
+
+            const QString fileName = QFile::decodeName(event->name);
+            if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                recordChange(fileName, Added);
+            } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                recordChange(fileName, Removed);
+            } else if (event->mask & IN_CLOSE_WRITE) {
+                recordChange(fileName, Modified);
+            }
+        }
+    }
+
+    if (invalidated) {
+        // 丢弃增量信息，由外部重新遍历文件夹
+        QString dir = m_dir;
+        m_pendingChanges.clear();
+        m_coalesceTimer->stop();
+        Q_EMIT directoryInvalidated(dir);
+        return;
+    }
+
+    if (m_pendingChanges.isEmpty()) {
+        return;
+    }
+
+    // 持续产生事件时，保证最长延迟时间内发送一次变更
+    if (m_pendingElapsed.elapsed() >= EMaxLatency) {
+        flushChanges();
+    } else {
+        m_coalesceTimer->start();
+    }
+}
+
+/**
+ * @brief 合并文件 \a fileName 的变更类型 \a type ，例如创建后写入仍为新增，新增后删除则忽略
+ */
+void ImageDirWatcher::recordChange(const QString &fileName, ChangeType type)
+{
+    if (m_pendingChanges.isEmpty()) {
+        m_pendingElapsed.start();
+    }
+
+    auto itr = m_pendingChanges.find(fileName);
+    if (itr == m_pendingChanges.end()) {
+        m_pendingChanges.insert(fileName, type);
+        return;
+    }
+
+    switch (itr.value()) {
+    case Added:
+        if (Removed == type) {
+            // 临时文件，新增后被移除
+            m_pendingChanges.erase(itr);
+        }
+        break;
+    case Removed:
+        if (Added == type || Modified == type) {
+            // 文件被替换
+            itr.value() = Modified;
+        }
+        break;
+    case Modified:
+        if (Removed == type) {
+            itr.value() = Removed;
+        }
+        break;
+    }
+}
+
+/**
+ * @brief 发送合并后的文件变更信息
+ */
+void ImageDirWatcher::flushChanges()
+{
+    m_coalesceTimer->stop();
+    if (m_pendingChanges.isEmpty()) {
+        return;
+    }
+
+    QStringList added;
+    QStringList removed;
+    QStringList modified;
+    const QDir dir(m_dir);
+    for (auto itr = m_pendingChanges.constBegin(); itr != m_pendingChanges.constEnd(); ++itr) {
+        const QString filePath = dir.absoluteFilePath(itr.key());
+        switch (itr.value()) {
+        case Added:
+            added.append(filePath);
+            break;
+        case Removed:
+            removed.append(filePath);
+            break;
+        case Modified:
+            modified.append(filePath);
+            break;
+        }
+    }
+    m_pendingChanges.clear();
+
+    Q_EMIT filesChanged(added, removed, modified);
+}
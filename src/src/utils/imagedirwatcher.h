@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef IMAGEDIRWATCHER_H
+#define IMAGEDIRWATCHER_H
+
+#include <QObject>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QStringList>
+
+class QTimer;
+class QSocketNotifier;
+
+/**
+ * @brief 基于 inotify 的图片文件夹观察类
+ *      每个文件夹仅占用一个 inotify watch ，不再为每个图片文件单独添加观察，
+ *      避免图片数量超过系统限制( fs.inotify.max_user_watches )后观察失效。
+ *      接收到的 IN_CREATE/IN_DELETE/IN_MOVED_FROM/IN_MOVED_TO/IN_CLOSE_WRITE 事件
+ *      会在短时间内合并，批量通过 filesChanged() 发送增量信息，避免大量文件拷贝时反复遍历文件夹。
+ */
+class ImageDirWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    enum Interval {
+        ECoalesceInterval = 200,    // 事件合并间隔 200ms ，在此期间无新事件时发送变更
+        EMaxLatency = 1000,         // 持续产生事件时，最长 1000ms 发送一次变更
+    };
+
+    explicit ImageDirWatcher(QObject *parent = nullptr);
+    ~ImageDirWatcher() override;
+
+    // 设置/取得当前观察的文件夹，传入空路径时取消观察
+    bool setDirectory(const QString &dir);
+    QString directory() const;
+
+    // 清空所有观察及缓存的事件
+    void clear();
+
+Q_SIGNALS:
+    // 合并后的文件变更信息(完整路径)，新增、移除、内容变更
+    void filesChanged(const QStringList &added, const QStringList &removed, const QStringList &modified);
+    // 事件队列溢出或文件夹自身被移动、删除，需要重新遍历文件夹
+    void directoryInvalidated(const QString &dir);
+
+private Q_SLOTS:
+    void onReadyRead();
+
+private:
+    // 文件变更类型，合并事件时使用
+    enum ChangeType {
+        Added,
+        Removed,
+        Modified,
+    };
+
+    void recordChange(const QString &fileName, ChangeType type);
+    void flushChanges();
+
+private:
+    int                         m_inotifyFd = -1;           // inotify 文件描述符
+    int                         m_watchDescriptor = -1;     // 当前文件夹的 watch
+    QString                     m_dir;                      // 当前观察的文件夹
+    QSocketNotifier             *m_notifier = nullptr;      // inotify 可读通知
+    QTimer                      *m_coalesceTimer = nullptr; // 事件合并定时器
+    QElapsedTimer               m_pendingElapsed;           // 首个未发送事件至今的时间
+    QHash<QString, ChangeType>  m_pendingChanges;           // 待发送的变更 QHash<文件名, 变更类型>
+};
+
+#endif // IMAGEDIRWATCHER_H
@@ -0,0 +1,71 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef SINGLEFLIGHT_H
+#define SINGLEFLIGHT_H
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSharedPointer>
+#include <QWaitCondition>
+
+#include <functional>
+
+/**
+ * @brief 相同标识的并发请求合并执行
+ *      首个请求 \a key 的线程在锁外执行耗时操作(如图片解码)，执行期间其它请求相同 \a key 的线程
+ *      等待该次执行完成并共享结果，不重复执行；不同 \a key 的请求互不阻塞。
+ *      仅合并同时进行的请求，不缓存结果，结果缓存由调用方处理。
+ *
+ * @code
+ *  SingleFlight<QString, QImage> flight;
+ *  QImage image = flight.run(path, [&]() { return loadImage(path); });
+ * @endcode
+ */
+template <typename Key, typename Value>
+class SingleFlight
+{
+public:
+    /**
+     * @brief 执行 \a func 获取 \a key 对应的结果，\a key 正在执行时等待并返回该次执行的结果
+     */
+    Value run(const Key &key, const std::function<Value()> &func)
+    {
+        QMutexLocker locker(&m_mutex);
+        QSharedPointer<Call> call = m_calls.value(key);
+        if (call) {
+            while (!call->done) {
+                call->finished.wait(&m_mutex);
+            }
+            return call->value;
+        }
+
+        call.reset(new Call);
+        m_calls.insert(key, call);
+        locker.unlock();
+
+        Value value = func();
+
+        locker.relock();
+        call->value = value;
+        call->done = true;
+        m_calls.remove(key);
+        call->finished.wakeAll();
+        return value;
+    }
+
+private:
+    // 正在执行的请求，等待的线程持有引用，执行完成后从表中移除
+    struct Call {
+        Value           value;
+        bool            done = false;
+        QWaitCondition  finished;
+    };
+
+    QMutex                              m_mutex;
+    QHash<Key, QSharedPointer<Call>>    m_calls;
+};
+
+#endif // SINGLEFLIGHT_H
@@ -0,0 +1,228 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "ocrinterface.h"
+#include "sharedimagereader.h"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * @brief 关闭文件描述符的辅助类
+ */
+class ScopedFd
+{
+public:
+    explicit ScopedFd(int fd)
+        : m_fd(fd)
+    {
+    }
+
+    ~ScopedFd()
+    {
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+    }
+
+    int get() const
+    {
+        return m_fd;
+    }
+
+private:
+    int m_fd;
+};
+
+/**
+ * @brief 生成 \a width x \a height 的 \a format 格式测试图片，各像素取值不同
+ */
+QImage testImage(int width, int height, QImage::Format format)
+{
+    QImage image(width, height, QImage::Format_ARGB32);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            image.setPixel(x, y, qRgba(x * 7, y * 13, (x + y) * 3, 0x80 + x));
+        }
+    }
+    return image.convertToFormat(format);
+}
+
+OcrSharedImageHeader validHeader(const QImage &image)
+{
+    OcrSharedImageHeader header;
+    header.magic = OcrSharedImageHeader::EMagic;
+    header.version = OcrSharedImageHeader::EVersion;
+    header.width = image.width();
+    header.height = image.height();
+    header.bytesPerLine = image.bytesPerLine();
+    header.format = static_cast<qint32>(image.format());
+    return header;
+}
+
+/**
+ * @brief 创建内容为 \a header 及 \a image 前 \a pixelBytes 字节像素数据的 memfd ，用于构造无效数据
+ */
+int writeMemfd(const OcrSharedImageHeader &header, const QImage &image, size_t pixelBytes)
+{
+    int fd = memfd_create("gts-ocrsharedimage", MFD_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    const bool written = write(fd, &header, sizeof(header)) == static_cast<ssize_t>(sizeof(header))
+                         && (0 == pixelBytes || write(fd, image.constBits(), pixelBytes) == static_cast<ssize_t>(pixelBytes));
+    if (!written) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief 按 \a header 写入 \a image 的全部像素数据后读取，返回读取的图片
+ */
+QImage readWithHeader(const OcrSharedImageHeader &header, const QImage &image)
+{
+    ScopedFd fd(writeMemfd(header, image, static_cast<size_t>(image.sizeInBytes())));
+    EXPECT_GE(fd.get(), 0);
+    return readSharedImage(fd.get());
+}
+
+}  // namespace
+
+TEST(OcrSharedImage, roundTrip)
+{
+    // 奇数宽度的 24 位、16 位及 8 位图片每行含填充字节
+    const QImage::Format formats[] = {
+        QImage::Format_RGB32,
+        QImage::Format_ARGB32,
+        QImage::Format_ARGB32_Premultiplied,
+        QImage::Format_RGB888,
+        QImage::Format_Grayscale8,
+        QImage::Format_RGB16,
+    };
+    for (QImage::Format format : formats) {
+        const QImage source = testImage(37, 11, format);
+        ScopedFd fd(OcrInterface::createImageMemfd(source));
+        ASSERT_GE(fd.get(), 0);
+
+        const QImage image = readSharedImage(fd.get());
+        EXPECT_EQ(source.format(), image.format()) << "format " << format;
+        EXPECT_TRUE(source == image) << "format " << format;
+    }
+}
+
+TEST(OcrSharedImage, indexedImageConverted)
+{
+    const QImage source = testImage(9, 5, QImage::Format_Indexed8);
+    ScopedFd fd(OcrInterface::createImageMemfd(source));
+    ASSERT_GE(fd.get(), 0);
+
+    const QImage image = readSharedImage(fd.get());
+    ASSERT_FALSE(image.isNull());
+    EXPECT_NE(QImage::Format_Indexed8, image.format());
+    EXPECT_TRUE(source.convertToFormat(image.format()) == image);
+}
+
+TEST(OcrSharedImage, memfdSealed)
+{
+    const QImage source = testImage(4, 4, QImage::Format_RGB32);
+    ScopedFd fd(OcrInterface::createImageMemfd(source));
+    ASSERT_GE(fd.get(), 0);
+
+    const int seals = fcntl(fd.get(), F_GET_SEALS);
+    EXPECT_TRUE(seals & F_SEAL_WRITE);
+    EXPECT_TRUE(seals & F_SEAL_SHRINK);
+    EXPECT_NE(0, ftruncate(fd.get(), 0));
+}
+
+TEST(OcrSharedImage, nullImage)
+{
+    EXPECT_LT(OcrInterface::createImageMemfd(QImage()), 0);
+    EXPECT_TRUE(readSharedImage(-1).isNull());
+}
+
+TEST(OcrSharedImage, truncatedData)
+{
+    const QImage source = testImage(13, 7, QImage::Format_RGB888);
+    const OcrSharedImageHeader header = validHeader(source);
+    const size_t pixelBytes = static_cast<size_t>(source.sizeInBytes());
+
+    // 数据不足描述信息长度
+    ScopedFd empty(memfd_create("gts-ocrsharedimage", MFD_CLOEXEC));
+    ASSERT_GE(empty.get(), 0);
+    ASSERT_EQ(4, write(empty.get(), &header, 4));
+    EXPECT_TRUE(readSharedImage(empty.get()).isNull());
+
+    // 仅有描述信息，以及像素数据缺少最后一个字节
+    for (size_t bytes : {size_t(0), pixelBytes / 2, pixelBytes - 1}) {
+        ScopedFd fd(writeMemfd(header, source, bytes));
+        ASSERT_GE(fd.get(), 0);
+        EXPECT_TRUE(readSharedImage(fd.get()).isNull()) << "pixel bytes " << bytes;
+    }
+
+    // 数据完整时可读取，确认以上失败仅由长度导致
+    ScopedFd complete(writeMemfd(header, source, pixelBytes));
+    ASSERT_GE(complete.get(), 0);
+    EXPECT_TRUE(source == readSharedImage(complete.get()));
+}
+
+TEST(OcrSharedImage, invalidHeader)
+{
+    const QImage source = testImage(8, 6, QImage::Format_RGB32);
+
+    OcrSharedImageHeader header = validHeader(source);
+    header.magic = ~quint32(OcrSharedImageHeader::EMagic);
+    EXPECT_TRUE(readWithHeader(header, source).isNull()) << "magic";
+
+    header = validHeader(source);
+    header.version = OcrSharedImageHeader::EVersion + 1;
+    EXPECT_TRUE(readWithHeader(header, source).isNull()) << "version";
+
+    header = validHeader(source);
+    header.width = 0;
+    EXPECT_TRUE(readWithHeader(header, source).isNull()) << "zero width";
+
+    header = validHeader(source);
+    header.height = -1;
+    EXPECT_TRUE(readWithHeader(header, source).isNull()) << "negative height";
+
+    header = validHeader(source);
+    header.bytesPerLine = source.bytesPerLine() - 1;
+    EXPECT_TRUE(readWithHeader(header, source).isNull()) << "short bytesPerLine";
+
+    header = validHeader(source);
+    header.bytesPerLine = -source.bytesPerLine();
+    EXPECT_TRUE(readWithHeader(header, source).isNull()) << "negative bytesPerLine";
+
+    // 每行字节数大于实际数据时总长度不足
+    header = validHeader(source);
+    header.bytesPerLine = source.bytesPerLine() * 2;
+    EXPECT_TRUE(readWithHeader(header, source).isNull()) << "large bytesPerLine";
+
+    header = validHeader(source);
+    header.width = source.width() * 2;
+    EXPECT_TRUE(readWithHeader(header, source).isNull()) << "width exceeds bytesPerLine";
+
+    const qint32 invalidFormats[] = {
+        QImage::Format_Invalid,
+        QImage::Format_Mono,
+        QImage::Format_MonoLSB,
+        QImage::Format_Indexed8,
+        QImage::NImageFormats,
+        -1,
+    };
+    for (qint32 format : invalidFormats) {
+        header = validHeader(source);
+        header.format = format;
+        EXPECT_TRUE(readWithHeader(header, source).isNull()) << "format " << format;
+    }
+}
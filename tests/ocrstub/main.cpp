@@ -0,0 +1,27 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "ocrstubservice.h"
+
+#include <QDBusConnection>
+#include <QDebug>
+#include <QGuiApplication>
+
+// 用法： ocr-stub-service [输出目录]
+// 在会话总线注册 com.deepin.Ocr 后打开看图进行识别，收到的图片信息输出到终端
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+    const QString outputDir = app.arguments().value(1);
+
+    OcrStubService service(outputDir);
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.registerService("com.deepin.Ocr")
+            || !bus.registerObject("/com/deepin/Ocr", &service, QDBusConnection::ExportAllSlots)) {
+        qWarning() << "ocr-stub-service: register service failed," << bus.lastError().message();
+        return 1;
+    }
+
+    return app.exec();
+}
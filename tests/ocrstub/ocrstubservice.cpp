@@ -0,0 +1,52 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "ocrstubservice.h"
+#include "sharedimagereader.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QImage>
+
+OcrStubService::OcrStubService(const QString &outputDir, QObject *parent)
+    : QObject(parent)
+    , m_outputDir(outputDir)
+{
+}
+
+void OcrStubService::openFile(const QString &filePath)
+{
+    received(__FUNCTION__, QImage(filePath), filePath);
+}
+
+void OcrStubService::openImage(const QByteArray &data)
+{
+    openImageAndName(data, QString());
+}
+
+/**
+ * @brief 旧接口，数据为 base64 编码的 qCompress 压缩 PNG
+ */
+void OcrStubService::openImageAndName(const QByteArray &data, const QString &imageName)
+{
+    received(__FUNCTION__, QImage::fromData(qUncompress(QByteArray::fromBase64(data)), "PNG"), imageName);
+}
+
+void OcrStubService::openImageFd(const QDBusUnixFileDescriptor &fd, const QString &imageName)
+{
+    received(__FUNCTION__, readSharedImage(fd.fileDescriptor()), imageName);
+}
+
+void OcrStubService::received(const QString &method, const QImage &image, const QString &imageName)
+{
+    qInfo() << method << imageName << image.size() << image.format();
+    if (image.isNull() || m_outputDir.isEmpty()) {
+        return;
+    }
+
+    const QString fileName = QDir(m_outputDir).filePath(QString("%1_%2.png").arg(method).arg(m_count++));
+    if (!image.save(fileName)) {
+        qWarning() << "OcrStubService: save image failed," << fileName;
+    }
+}
@@ -0,0 +1,37 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef OCRSTUBSERVICE_H
+#define OCRSTUBSERVICE_H
+
+#include <QDBusUnixFileDescriptor>
+#include <QObject>
+
+/**
+ * @brief 本地 OCR 调试服务，实现看图调用的 com.deepin.Ocr 接口，用于未安装 OCR 服务时手动调试，
+ *      仅读取传入的图片并输出图片信息，指定输出目录时将收到的图片保存为 PNG 文件
+ */
+class OcrStubService : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "com.deepin.Ocr")
+
+public:
+    explicit OcrStubService(const QString &outputDir, QObject *parent = nullptr);
+
+public Q_SLOTS:
+    void openFile(const QString &filePath);
+    void openImage(const QByteArray &data);
+    void openImageAndName(const QByteArray &data, const QString &imageName);
+    void openImageFd(const QDBusUnixFileDescriptor &fd, const QString &imageName);
+
+private:
+    void received(const QString &method, const QImage &image, const QString &imageName);
+
+private:
+    QString m_outputDir;    // 保存收到的图片的目录，为空时不保存
+    int     m_count = 0;    // 收到的图片数
+};
+
+#endif // OCRSTUBSERVICE_H
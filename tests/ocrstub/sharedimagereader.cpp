@@ -0,0 +1,65 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "sharedimagereader.h"
+#include "ocrinterface.h"
+
+#include <QDebug>
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * @brief 映射 \a fd 并按 OcrSharedImageHeader 校验：标识、版本、大小及格式有效，
+ *      每行字节数不小于该格式所需且数据长度足够，通过后复制像素数据，返回的图片不引用映射的内存
+ */
+QImage readSharedImage(int fd)
+{
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(OcrSharedImageHeader))) {
+        return QImage();
+    }
+
+    const size_t totalBytes = static_cast<size_t>(info.st_size);
+    void *mapped = mmap(nullptr, totalBytes, PROT_READ, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == mapped) {
+        qWarning() << "readSharedImage: mmap failed," << strerror(errno);
+        return QImage();
+    }
+
+    const uchar *data = static_cast<const uchar *>(mapped);
+    OcrSharedImageHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    QImage image;
+    const bool validHeader = header.magic == OcrSharedImageHeader::EMagic
+                             && header.version == OcrSharedImageHeader::EVersion
+                             && header.width > 0 && header.height > 0 && header.bytesPerLine > 0
+                             && header.format > QImage::Format_Invalid && header.format < QImage::NImageFormats
+                             && header.format != QImage::Format_Indexed8 && header.format != QImage::Format_Mono
+                             && header.format != QImage::Format_MonoLSB;
+    if (validHeader) {
+        const size_t pixelBytes = static_cast<size_t>(header.bytesPerLine) * static_cast<size_t>(header.height);
+        image = QImage(header.width, header.height, static_cast<QImage::Format>(header.format));
+        if (image.isNull() || image.bytesPerLine() > header.bytesPerLine
+                || totalBytes - sizeof(header) < pixelBytes) {
+            image = QImage();
+        } else {
+            const uchar *pixels = data + sizeof(header);
+            const size_t rowBytes = static_cast<size_t>(image.bytesPerLine());
+            for (int y = 0; y < header.height; y++) {
+                std::memcpy(image.scanLine(y), pixels + static_cast<size_t>(y) * header.bytesPerLine, rowBytes);
+            }
+        }
+    }
+
+    munmap(mapped, totalBytes);
+    if (image.isNull()) {
+        qWarning() << "readSharedImage: invalid shared image";
+    }
+    return image;
+}
@@ -0,0 +1,18 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef SHAREDIMAGEREADER_H
+#define SHAREDIMAGEREADER_H
+
+#include <QImage>
+
+/**
+ * @brief 服务端读取 openImageFd 传入的共享内存图片，校验 OcrSharedImageHeader 后复制像素数据，
+ *      为 OCR 服务实现 openImageFd 的参考
+ * @param fd 传入的文件描述符，调用后仍由调用方关闭
+ * @return 读取的图片，数据无效时返回空图片
+ */
+QImage readSharedImage(int fd);
+
+#endif // SHAREDIMAGEREADER_H
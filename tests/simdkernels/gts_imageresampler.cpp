@@ -0,0 +1,153 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+// 内核函数均为文件内静态函数，直接包含实现文件进行测试
+#include "unionimage/imageresampler.cpp"
+
+#include "simdtestdata.h"
+
+using namespace LibUnionImage_NameSpace;
+
+namespace {
+
+struct ScaleCase {
+    int                     srcLength;
+    int                     dstLength;
+    ImageResampler::Filter  filter;
+};
+
+// 覆盖单个采样、奇数个采样(SIMD 成对处理权重后剩余一个)及放大时 Lanczos 的负权重
+const ScaleCase s_scaleCases[] = {
+    {1, 1, ImageResampler::Box},
+    {7, 3, ImageResampler::Box},
+    {9, 4, ImageResampler::Triangle},
+    {40, 9, ImageResampler::Triangle},
+    {5, 11, ImageResampler::Triangle},
+    {17, 5, ImageResampler::Lanczos},
+    {6, 13, ImageResampler::Lanczos},
+};
+
+const int s_maxPixels = 67;
+
+/**
+ * @brief 水平重采样的标量参考实现，与 horizontalRow 中无 SIMD 指令时的分支一致
+ */
+void horizontalRowReference(const quint32 *in, quint32 *out, int width, const Contributors &table)
+{
+    for (int x = 0; x < width; x++) {
+        const uchar *pixels = reinterpret_cast<const uchar *>(in + table.start[x]);
+        const qint16 *weights = table.weights.constData() + x * table.maxCount;
+        uchar *dst = reinterpret_cast<uchar *>(out + x);
+        for (int c = 0; c < 4; c++) {
+            int sum = s_rounding;
+            for (int j = 0; j < table.count[x]; j++) {
+                sum += pixels[j * 4 + c] * weights[j];
+            }
+            dst[c] = clampChannel(sum);
+        }
+    }
+}
+
+/**
+ * @brief 对 \a scaleCase 的每个输出行，以 \a channels 个通道的随机源数据分别调用 \a kernel 及
+ *      verticalRowScalar ，比较输出结果
+ */
+template <typename Kernel>
+void compareVertical(const ScaleCase &scaleCase, int channels, SimdTestData::Pattern pattern, Kernel kernel)
+{
+    const Contributors table = computeContributors(scaleCase.srcLength, scaleCase.dstLength, scaleCase.filter);
+
+    // 每行独立分配且不留余量，越界读取可被 ASan 检测
+    std::vector<std::vector<uchar>> source(scaleCase.srcLength);
+    for (std::vector<uchar> &row : source) {
+        row = SimdTestData::bytes(channels, pattern);
+    }
+
+    for (int i = 0; i < scaleCase.dstLength; i++) {
+        std::vector<const uchar *> rows;
+        for (int k = 0; k < table.count[i]; k++) {
+            rows.push_back(source[table.start[i] + k].data());
+        }
+        const qint16 *weights = table.weights.constData() + i * table.maxCount;
+
+        std::vector<uchar> expected(channels, SimdTestData::s_sentinel);
+        std::vector<uchar> actual(channels, SimdTestData::s_sentinel);
+        verticalRowScalar(rows.data(), weights, table.count[i], expected.data(), 0, channels);
+        kernel(rows.data(), weights, table.count[i], actual.data(), channels);
+
+        ASSERT_EQ(expected, actual) << "src " << scaleCase.srcLength << " dst " << scaleCase.dstLength
+                                    << " filter " << scaleCase.filter << " row " << i
+                                    << " channels " << channels;
+    }
+}
+
+template <typename Kernel>
+void compareVerticalAll(Kernel kernel)
+{
+    for (const ScaleCase &scaleCase : s_scaleCases) {
+        for (int pixels = 1; pixels <= s_maxPixels; pixels++) {
+            compareVertical(scaleCase, pixels * 4, SimdTestData::Random, kernel);
+            compareVertical(scaleCase, pixels * 4, SimdTestData::Extremes, kernel);
+        }
+    }
+}
+
+}  // namespace
+
+TEST(ImageResamplerKernel, horizontalRowMatchesScalar)
+{
+    for (const ScaleCase &scaleCase : s_scaleCases) {
+        const Contributors table = computeContributors(scaleCase.srcLength, scaleCase.dstLength, scaleCase.filter);
+        for (SimdTestData::Pattern pattern : {SimdTestData::Random, SimdTestData::Extremes}) {
+            std::vector<quint32> in = SimdTestData::words(scaleCase.srcLength, pattern);
+            std::vector<quint32> expected(scaleCase.dstLength);
+            std::vector<quint32> actual(scaleCase.dstLength);
+            horizontalRowReference(in.data(), expected.data(), scaleCase.dstLength, table);
+            horizontalRow(in.data(), actual.data(), scaleCase.dstLength, table);
+
+            ASSERT_EQ(expected, actual) << "src " << scaleCase.srcLength << " dst " << scaleCase.dstLength
+                                        << " filter " << scaleCase.filter;
+        }
+    }
+}
+
+TEST(ImageResamplerKernel, verticalRowMatchesScalar)
+{
+    compareVerticalAll(verticalRow);
+}
+
+#if defined(__SSE2__)
+TEST(ImageResamplerKernel, verticalRowSse2MatchesScalar)
+{
+    compareVerticalAll([](const uchar *const *rows, const qint16 *weights, int count, uchar *out, int channels) {
+        const int done = verticalRowSse2(rows, weights, count, out, 0, channels);
+        ASSERT_EQ(channels - channels % 16, done);
+        verticalRowScalar(rows, weights, count, out, done, channels);
+    });
+}
+
+TEST(ImageResamplerKernel, verticalRowAvx2MatchesScalar)
+{
+    if (!hasAvx2()) {
+        GTEST_SKIP() << "CPU does not support AVX2";
+    }
+
+    compareVerticalAll([](const uchar *const *rows, const qint16 *weights, int count, uchar *out, int channels) {
+        const int done = verticalRowAvx2(rows, weights, count, out, 0, channels);
+        ASSERT_EQ(channels - channels % 32, done);
+        verticalRowScalar(rows, weights, count, out, done, channels);
+    });
+}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+TEST(ImageResamplerKernel, verticalRowNeonMatchesScalar)
+{
+    compareVerticalAll([](const uchar *const *rows, const qint16 *weights, int count, uchar *out, int channels) {
+        const int done = verticalRowNeon(rows, weights, count, out, 0, channels);
+        ASSERT_EQ(channels - channels % 16, done);
+        verticalRowScalar(rows, weights, count, out, done, channels);
+    });
+}
+#endif
@@ -0,0 +1,36 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+// 内核函数均为文件内静态函数，直接包含实现文件进行测试
+#include "unionimage/mipmappyramid.cpp"
+
+#include "simdtestdata.h"
+
+using namespace LibUnionImage_NameSpace;
+
+TEST(MipmapPyramidKernel, halveRowMatchesScalar)
+{
+    // 输出像素数覆盖 SIMD 整块(4 个像素)及 1~3 个像素的尾部
+    for (int width = 0; width <= 37; width++) {
+        for (SimdTestData::Pattern pattern : {SimdTestData::Random, SimdTestData::Extremes}) {
+            const std::vector<uchar> row0 = SimdTestData::bytes(width * 8, pattern);
+            const std::vector<uchar> row1 = SimdTestData::bytes(width * 8, pattern);
+
+            std::vector<uchar> expected(width * 4);
+            for (int x = 0; x < width; x++) {
+                for (int c = 0; c < 4; c++) {
+                    const int sum = row0[x * 8 + c] + row0[x * 8 + c + 4] + row1[x * 8 + c] + row1[x * 8 + c + 4];
+                    expected[x * 4 + c] = static_cast<uchar>((sum + 2) >> 2);
+                }
+            }
+
+            std::vector<uchar> actual(width * 4, SimdTestData::s_sentinel);
+            halveRow(row0.data(), row1.data(), actual.data(), width);
+
+            ASSERT_EQ(expected, actual) << "width " << width;
+        }
+    }
+}
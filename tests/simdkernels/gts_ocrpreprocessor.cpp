@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+// 内核函数均为文件内静态函数，直接包含实现文件进行测试
+#include "ocr/ocrpreprocessor.cpp"
+
+#include "simdtestdata.h"
+
+TEST(OcrPreprocessorKernel, accumulateRowMatchesScalar)
+{
+    // 字节数覆盖 SIMD 整块(16 字节)及奇数长度的尾部
+    for (int bytes = 0; bytes <= 70; bytes++) {
+        for (SimdTestData::Pattern pattern : {SimdTestData::Random, SimdTestData::Extremes}) {
+            const std::vector<uchar> row = SimdTestData::bytes(bytes, pattern);
+            // 累加器取随机值，包含接近上限的值以验证 16 位回绕与标量一致
+            std::vector<quint16> expected = SimdTestData::values<quint16>(bytes, pattern);
+            std::vector<quint16> actual = expected;
+
+            for (int i = 0; i < bytes; i++) {
+                expected[i] = static_cast<quint16>(expected[i] + row[i]);
+            }
+            accumulateRow(row.data(), actual.data(), bytes);
+
+            ASSERT_EQ(expected, actual) << "bytes " << bytes;
+        }
+    }
+}
@@ -0,0 +1,97 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+// 内核函数均为文件内静态函数，直接包含实现文件进行测试
+#include "rawiohandler.cpp"
+
+#include "simdtestdata.h"
+
+namespace {
+
+// 像素数覆盖 SIMD 整块、尾部，以及 SSSE3 路径为避免越界读取而交由标量处理的最后几个像素
+const int s_maxWidth = 37;
+
+std::vector<quint32> swizzleRgb8Reference(const std::vector<uchar> &src, int width)
+{
+    std::vector<quint32> result(width);
+    for (int x = 0; x < width; x++) {
+        result[x] = qRgb(src[x * 3], src[x * 3 + 1], src[x * 3 + 2]);
+    }
+    return result;
+}
+
+#ifdef RAW_HAS_16BIT_OUTPUT
+std::vector<quint16> swizzleRgb16Reference(const std::vector<quint16> &src, int width)
+{
+    std::vector<quint16> result(width * 4);
+    for (int x = 0; x < width; x++) {
+        result[x * 4] = src[x * 3];
+        result[x * 4 + 1] = src[x * 3 + 1];
+        result[x * 4 + 2] = src[x * 3 + 2];
+        result[x * 4 + 3] = 0xFFFF;
+    }
+    return result;
+}
+#endif
+
+}  // namespace
+
+TEST(RawIOHandlerKernel, swizzleRgb8RowMatchesScalar)
+{
+    for (int width = 0; width <= s_maxWidth; width++) {
+        // 源数据不留余量，越界读取可被 ASan 检测
+        const std::vector<uchar> src = SimdTestData::bytes(width * 3);
+        std::vector<quint32> actual(width, 0xCDCDCDCD);
+        swizzleRgb8Row(src.data(), reinterpret_cast<uchar *>(actual.data()), width);
+
+        ASSERT_EQ(swizzleRgb8Reference(src, width), actual) << "width " << width;
+    }
+}
+
+#ifdef RAW_HAS_16BIT_OUTPUT
+TEST(RawIOHandlerKernel, swizzleRgb16RowMatchesScalar)
+{
+    for (int width = 0; width <= s_maxWidth; width++) {
+        const std::vector<quint16> src = SimdTestData::values<quint16>(width * 3, SimdTestData::Random);
+        std::vector<quint16> actual(width * 4, 0xCDCD);
+        swizzleRgb16Row(src.data(), actual.data(), width);
+
+        ASSERT_EQ(swizzleRgb16Reference(src, width), actual) << "width " << width;
+    }
+}
+#endif
+
+#ifdef RAW_HAS_SSSE3_PATH
+TEST(RawIOHandlerKernel, swizzleRgbSsse3MatchesScalar)
+{
+    if (!cpuHasSsse3()) {
+        GTEST_SKIP() << "CPU does not support SSSE3";
+    }
+
+    for (int width = 0; width <= s_maxWidth; width++) {
+        const std::vector<uchar> src8 = SimdTestData::bytes(width * 3);
+        std::vector<quint32> actual8(width, 0xCDCDCDCD);
+        const int done8 = swizzleRgb8RowSsse3(src8.data(), reinterpret_cast<uchar *>(actual8.data()), width);
+        // 每次读取 16 字节，最后 2 个像素必须留给标量处理
+        ASSERT_LE(done8, qMax(0, width - 2));
+        ASSERT_GT(done8 + 4 + 2, width);
+
+        const std::vector<quint32> expected8 = swizzleRgb8Reference(src8, width);
+        ASSERT_TRUE(std::equal(expected8.begin(), expected8.begin() + done8, actual8.begin())) << "width " << width;
+
+#ifdef RAW_HAS_16BIT_OUTPUT
+        const std::vector<quint16> src16 = SimdTestData::values<quint16>(width * 3, SimdTestData::Random);
+        std::vector<quint16> actual16(width * 4, 0xCDCD);
+        const int done16 = swizzleRgb16RowSsse3(src16.data(), actual16.data(), width);
+        ASSERT_LE(done16, qMax(0, width - 1));
+        ASSERT_GT(done16 + 2 + 1, width);
+
+        const std::vector<quint16> expected16 = swizzleRgb16Reference(src16, width);
+        ASSERT_TRUE(std::equal(expected16.begin(), expected16.begin() + done16 * 4, actual16.begin())) << "width " << width;
+#endif
+    }
+}
+#endif
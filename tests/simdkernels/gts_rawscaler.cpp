@@ -0,0 +1,50 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+// 内核函数均为文件内静态函数，直接包含实现文件进行测试
+#include "rawscaler.cpp"
+
+#include "simdtestdata.h"
+
+namespace {
+
+/**
+ * @brief 以 \a n 个 T 类型通道值调用 accumulateRow ，与逐个累加的标量结果比较
+ */
+template <typename T>
+void compareAccumulate(int n, SimdTestData::Pattern pattern)
+{
+    const std::vector<T> src = SimdTestData::values<T>(n, pattern);
+    std::vector<quint32> expected = SimdTestData::words(n);
+    std::vector<quint32> actual = expected;
+
+    for (int i = 0; i < n; i++) {
+        expected[i] += src[i];
+    }
+    accumulateRow(src.data(), actual.data(), n);
+
+    ASSERT_EQ(expected, actual) << "channels " << n;
+}
+
+}  // namespace
+
+TEST(RawScalerKernel, accumulateRow8MatchesScalar)
+{
+    // 通道数覆盖 SIMD 整块(16 个通道)及奇数长度的尾部
+    for (int n = 0; n <= 70; n++) {
+        compareAccumulate<quint8>(n, SimdTestData::Random);
+        compareAccumulate<quint8>(n, SimdTestData::Extremes);
+    }
+}
+
+TEST(RawScalerKernel, accumulateRow16MatchesScalar)
+{
+    // 通道数覆盖 SIMD 整块(8 个通道)及奇数长度的尾部
+    for (int n = 0; n <= 40; n++) {
+        compareAccumulate<quint16>(n, SimdTestData::Random);
+        compareAccumulate<quint16>(n, SimdTestData::Extremes);
+    }
+}
@@ -0,0 +1,62 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef SIMDTESTDATA_H
+#define SIMDTESTDATA_H
+
+#include <QtGlobal>
+
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+/**
+ * @brief SIMD 内核测试数据，使用固定种子生成，失败时可复现
+ */
+namespace SimdTestData {
+
+enum Pattern {
+    Random,     // 均匀分布的随机值
+    Extremes,   // 仅取最小/最大值，用于验证溢出及饱和处理
+};
+
+// 输出缓冲区的初始值，用于发现未写入的位置
+static const uchar s_sentinel = 0xCD;
+
+template <typename T>
+inline std::vector<T> values(int count, Pattern pattern)
+{
+    static std::mt19937 engine(20230801u);
+    std::uniform_int_distribution<quint64> distribution(0, std::numeric_limits<T>::max());
+
+    std::vector<T> result(static_cast<size_t>(count));
+    for (T &value : result) {
+        value = static_cast<T>(distribution(engine));
+        if (Extremes == pattern) {
+            value = (value & 1) ? std::numeric_limits<T>::max() : 0;
+        }
+    }
+    return result;
+}
+
+inline std::vector<uchar> bytes(int count, Pattern pattern = Random)
+{
+    return values<uchar>(count, pattern);
+}
+
+// 32 位像素按字节生成，Extremes 时各通道独立取值
+inline std::vector<quint32> words(int count, Pattern pattern = Random)
+{
+    const std::vector<uchar> data = bytes(count * 4, pattern);
+    std::vector<quint32> result(static_cast<size_t>(count));
+    if (!data.empty()) {
+        memcpy(result.data(), data.data(), data.size());
+    }
+    return result;
+}
+
+}  // namespace SimdTestData
+
+#endif // SIMDTESTDATA_H